@@ -23,6 +23,7 @@
 #include <curl/curl.h>
 
 #include "MultiSync.h"
+#include "MultiSyncStream.h"
 
 #include "Plugins.h"
 #include "command.h"
@@ -707,6 +708,10 @@ Json::Value MultiSync::GetSyncStats() {
     result["masterIP"] = m_syncMaster;
     result["masterHostname"] = masterHostname;
 
+    if (MultiSyncStream::INSTANCE.IsSending() || MultiSyncStream::INSTANCE.IsReceiving()) {
+        result["frameStream"] = MultiSyncStream::INSTANCE.GetStats();
+    }
+
     return result;
 }
 
@@ -718,6 +723,9 @@ void MultiSync::ResetSyncStats() {
     }
 
     m_syncStats.clear();
+    slock.unlock();
+
+    MultiSyncStream::INSTANCE.ResetStats();
 }
 
 void MultiSync::Discover() {
@@ -1905,6 +1913,18 @@ bool MultiSync::FillInInterfaces() {
     freeifaddrs(interfaces);
     return change;
 }
+
+std::map<std::string, uint32_t> MultiSync::GetInterfaceAddresses() {
+    std::map<std::string, uint32_t> result;
+    std::unique_lock<std::mutex> lock(m_socketLock);
+    for (auto& a : m_interfaces) {
+        if (a.second.address) {
+            result[a.first] = a.second.address;
+        }
+    }
+    return result;
+}
+
 bool MultiSync::RemoveInterface(const std::string& interface) {
     std::unique_lock<std::mutex> lock(m_socketLock);
     auto it = m_interfaces.find(interface);
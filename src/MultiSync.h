@@ -271,6 +271,9 @@ public:
 
     int OpenControlSockets();
 
+    // interface name -> address of the interfaces MultiSync runs over
+    std::map<std::string, uint32_t> GetInterfaceAddresses();
+
     static std::string GetTypeString(MultiSyncSystemType type, bool local = false);
     static MultiSyncSystemType ModelStringToType(std::string model);
 
@@ -0,0 +1,898 @@
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include "fpp-pch.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <random>
+
+#ifndef NO_ZSTD
+#include <zstd.h>
+#endif
+
+#include "MultiSyncStream.h"
+
+#include "MultiSync.h"
+#include "NetworkMonitor.h"
+#include "Sequence.h"
+#include "Trace.h"
+#include "channeloutput/ChannelOutputSetup.h"
+
+// how long streamed data is output for if the stream stops without
+// the master sending a blank
+#define STREAM_DATA_TIMEOUT 1000
+// frames held before the oldest is released regardless of its time
+#define STREAM_MAX_PENDING_FRAMES 32
+#define STREAM_RCV_MSGS 32
+// copies of the end of stream packet sent to each group
+#define STREAM_END_COPIES 2
+
+MultiSyncStream MultiSyncStream::INSTANCE;
+
+// 239.70.81.<block>, the block number carries into the third octet
+static in_addr_t StreamGroupAddress(uint32_t block) {
+    return htonl((239u << 24) | (70u << 16) | ((81u + (block >> 8)) << 8) | (block & 0xFF));
+}
+
+// ifAddr is the address of the interface to send out of, INADDR_ANY to
+// leave it to the routing table
+static int OpenSendSocket(in_addr_t ifAddr) {
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        LogErr(VB_SYNC, "Error opening MultiSync stream socket: %s\n", strerror(errno));
+        return -1;
+    }
+    char loopch = 0;
+    if (setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, (char*)&loopch, sizeof(loopch)) < 0) {
+        LogErr(VB_SYNC, "Error setting IP_MULTICAST_LOOP on MultiSync stream socket: %s\n", strerror(errno));
+    }
+    if (ifAddr != htonl(INADDR_ANY)) {
+        struct in_addr addr;
+        addr.s_addr = ifAddr;
+        if (setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, &addr, sizeof(addr)) < 0) {
+            LogErr(VB_SYNC, "Error setting IP_MULTICAST_IF on MultiSync stream socket: %s\n", strerror(errno));
+            close(sock);
+            return -1;
+        }
+    }
+    int sndBuf = 4 * 1024 * 1024;
+    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &sndBuf, sizeof(sndBuf));
+    return sock;
+}
+
+MultiSyncStream::MultiSyncStream() {
+}
+
+MultiSyncStream::~MultiSyncStream() {
+    Shutdown();
+}
+
+void MultiSyncStream::Init() {
+    if (getFPPmode() == REMOTE_MODE) {
+        m_receiving = getSettingInt("MultiSyncStreamReceive", 0);
+    } else {
+        m_sending = multiSync->isMultiSyncEnabled() && getSettingInt("MultiSyncStreamFrames", 0);
+    }
+    if (!m_sending && !m_receiving) {
+        return;
+    }
+
+    std::function<void(NetworkMonitor::NetEventType, int, const std::string&)> f = [this](NetworkMonitor::NetEventType i, int up, const std::string& s) {
+        if ((i == NetworkMonitor::NetEventType::NEW_ADDR && up) || i == NetworkMonitor::NetEventType::DEL_ADDR) {
+            m_networkChanged = true;
+            m_sendSignal.notify_all();
+        }
+    };
+
+    if (m_sending) {
+        m_sock = OpenSendSocket(htonl(INADDR_ANY));
+        if (m_sock < 0) {
+            m_sending = false;
+            return;
+        }
+        m_session = std::random_device()();
+
+        m_fecCount = std::clamp(getSettingInt("MultiSyncStreamFEC", 4), 0, STREAM_MAX_FEC);
+        for (uint32_t b = 0; b < (FPPD_MAX_CHANNELS >> STREAM_BLOCK_SHIFT); b++) {
+            struct sockaddr_in addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(FPP_STREAM_PORT);
+            addr.sin_addr.s_addr = StreamGroupAddress(b);
+            m_groupAddrs.push_back(addr);
+        }
+#ifndef NO_ZSTD
+        m_cctx = ZSTD_createCCtx();
+        m_compressBuffer.resize(ZSTD_compressBound(STREAM_SLICE_CHANNELS));
+#endif
+        LogInfo(VB_SYNC, "Streaming sequence frames to MultiSync remotes, parity every %d packets\n", m_fecCount);
+        m_networkChanged = true;
+        m_running = true;
+        m_thread = new std::thread(&MultiSyncStream::SendThread, this);
+    } else {
+        m_delay = std::clamp(getSettingInt("MultiSyncStreamDelay", 50), 0, 1000);
+#ifndef NO_ZSTD
+        m_dctx = ZSTD_createDCtx();
+#endif
+        SetupReceive();
+        if (m_sock < 0) {
+            m_receiving = false;
+            return;
+        }
+        if (pipe(m_wakePipe) < 0) {
+            LogErr(VB_SYNC, "Error creating MultiSync stream wake pipe: %s\n", strerror(errno));
+            m_wakePipe[0] = m_wakePipe[1] = -1;
+        } else {
+            fcntl(m_wakePipe[0], F_SETFL, O_NONBLOCK);
+            fcntl(m_wakePipe[1], F_SETFL, O_NONBLOCK);
+        }
+        m_running = true;
+        m_thread = new std::thread(&MultiSyncStream::ReceiveThread, this);
+    }
+    m_networkCallbackId = NetworkMonitor::INSTANCE.registerCallback(f);
+}
+
+void MultiSyncStream::Shutdown() {
+    if (m_networkCallbackId >= 0) {
+        NetworkMonitor::INSTANCE.removeCallback(m_networkCallbackId);
+        m_networkCallbackId = -1;
+    }
+    if (m_thread) {
+        m_running = false;
+        m_sendSignal.notify_all();
+        m_thread->join();
+        delete m_thread;
+        m_thread = nullptr;
+    }
+    if (m_sock >= 0) {
+        close(m_sock);
+        m_sock = -1;
+    }
+    for (auto& s : m_sendSocks) {
+        close(s.second.second);
+    }
+    m_sendSocks.clear();
+    for (int x = 0; x < 2; x++) {
+        if (m_wakePipe[x] >= 0) {
+            close(m_wakePipe[x]);
+            m_wakePipe[x] = -1;
+        }
+    }
+#ifndef NO_ZSTD
+    if (m_cctx) {
+        ZSTD_freeCCtx((ZSTD_CCtx*)m_cctx);
+        m_cctx = nullptr;
+    }
+    if (m_dctx) {
+        ZSTD_freeDCtx((ZSTD_DCtx*)m_dctx);
+        m_dctx = nullptr;
+    }
+#endif
+    m_sending = false;
+    m_receiving = false;
+}
+
+/*
+ * Master
+ */
+void MultiSyncStream::SendFrame(const uint8_t* data, uint32_t channelCount, int stepTime) {
+    if (!m_sending || !channelCount) {
+        return;
+    }
+    channelCount = std::min(channelCount, (uint32_t)FPPD_MAX_CHANNELS);
+
+    std::unique_lock<std::mutex> lock(m_sendLock);
+    if (m_pendingReady) {
+        m_framesReplaced++;
+    }
+    m_pending.resize(channelCount);
+    memcpy(&m_pending[0], data, channelCount);
+    m_pendingTimestamp = (uint32_t)GetTimeMS();
+    m_pendingStepTime = stepTime;
+    m_pendingReady = true;
+    lock.unlock();
+    m_sendSignal.notify_one();
+}
+
+void MultiSyncStream::Blank() {
+    if (m_sending) {
+        std::unique_lock<std::mutex> lock(m_sendLock);
+        m_pendingEnd = true;
+        lock.unlock();
+        m_sendSignal.notify_one();
+    } else if (m_receiving) {
+        m_blankRequested = true;
+        if (m_wakePipe[1] >= 0) {
+            char c = 0;
+            if (write(m_wakePipe[1], &c, 1) < 0) {
+                // the pipe is full, the thread is already being woken
+            }
+        }
+    }
+}
+
+void MultiSyncStream::SendThread() {
+    TraceManager::INSTANCE.SetThreadName("MultiSyncStream");
+
+    std::unique_lock<std::mutex> lock(m_sendLock);
+    while (m_running) {
+        if (m_networkChanged.exchange(false)) {
+            lock.unlock();
+            UpdateSendSockets();
+            lock.lock();
+            continue;
+        }
+        if (m_pendingReady) {
+            std::swap(m_pending, m_working);
+            m_frameTimestamp = m_pendingTimestamp;
+            m_frameStepTime = m_pendingStepTime;
+            m_pendingReady = false;
+            lock.unlock();
+
+            SendQueuedFrame();
+
+            lock.lock();
+        } else if (m_pendingEnd) {
+            // after the last queued frame so remotes don't output it after the blank
+            m_pendingEnd = false;
+            lock.unlock();
+
+            SendEnd();
+
+            lock.lock();
+        } else {
+            m_sendSignal.wait_for(lock, std::chrono::milliseconds(100));
+        }
+    }
+}
+
+// Sends out of each of MultiSync's interfaces so the stream reaches remotes
+// on every network the master syncs, not just the one with the route.
+void MultiSyncStream::UpdateSendSockets() {
+    std::map<std::string, uint32_t> interfaces = multiSync->GetInterfaceAddresses();
+    for (auto it = m_sendSocks.begin(); it != m_sendSocks.end();) {
+        auto i = interfaces.find(it->first);
+        if (i == interfaces.end() || i->second != it->second.first) {
+            LogDebug(VB_SYNC, "MultiSync stream no longer sending on %s\n", it->first.c_str());
+            close(it->second.second);
+            it = m_sendSocks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto& i : interfaces) {
+        if (m_sendSocks.find(i.first) != m_sendSocks.end()) {
+            continue;
+        }
+        int sock = OpenSendSocket(i.second);
+        if (sock >= 0) {
+            LogDebug(VB_SYNC, "MultiSync stream sending on %s\n", i.first.c_str());
+            m_sendSocks[i.first] = std::pair<uint32_t, int>(i.second, sock);
+        }
+    }
+}
+
+void MultiSyncStream::SendQueuedFrame() {
+    FPP_TRACE_SPAN("MultiSyncStream::SendFrame");
+    m_frame++;
+    m_fecGroup = 0;
+    m_packetLens.clear();
+    m_packetBlocks.clear();
+
+    uint32_t total = m_working.size();
+    for (uint32_t start = 0; start < total; start += STREAM_BLOCK_CHANNELS) {
+        uint32_t end = std::min(total, start + STREAM_BLOCK_CHANNELS);
+        int groupStart = m_packetLens.size();
+        uint32_t ch = start;
+        while (ch < end) {
+            ch += AddSlice(ch, end - ch);
+            if (!m_fecCount) {
+                AddParity(m_packetLens.size() - 1, 1);
+                groupStart = m_packetLens.size();
+            } else if ((int)m_packetLens.size() - groupStart == m_fecCount) {
+                AddParity(groupStart, m_fecCount);
+                groupStart = m_packetLens.size();
+            }
+        }
+        // parity groups never span blocks as remotes may only see one of them
+        if ((int)m_packetLens.size() > groupStart) {
+            AddParity(groupStart, m_packetLens.size() - groupStart);
+        }
+    }
+    m_lastBlockCount = (total + STREAM_BLOCK_CHANNELS - 1) >> STREAM_BLOCK_SHIFT;
+    FlushPackets();
+    m_framesSent++;
+}
+
+// Tells the remotes on every group of the last frame that the stream ended,
+// the marker is numbered after that frame so anything still in flight for
+// the old frames is dropped.
+void MultiSyncStream::SendEnd() {
+    if (!m_lastBlockCount) {
+        return;
+    }
+    m_frame++;
+    m_frameTimestamp = (uint32_t)GetTimeMS();
+    m_packetLens.clear();
+    m_packetBlocks.clear();
+    for (int c = 0; c < STREAM_END_COPIES; c++) {
+        for (uint32_t b = 0; b < m_lastBlockCount; b++) {
+            StreamPkt* pkt = (StreamPkt*)NewPacket(b);
+            pkt->flags = STREAM_FLAG_END;
+        }
+    }
+    m_lastBlockCount = 0;
+    FlushPackets();
+    m_endsSent++;
+}
+
+uint8_t* MultiSyncStream::NewPacket(uint32_t block) {
+    m_packetLens.push_back(sizeof(StreamPkt));
+    m_packetBlocks.push_back(block);
+    size_t need = m_packetLens.size() * STREAM_MAX_PACKET;
+    if (m_packets.size() < need) {
+        m_packets.resize(need + 64 * STREAM_MAX_PACKET);
+    }
+    uint8_t* p = &m_packets[(m_packetLens.size() - 1) * STREAM_MAX_PACKET];
+    memset(p, 0, sizeof(StreamPkt));
+
+    StreamPkt* pkt = (StreamPkt*)p;
+    pkt->fpps[0] = 'F';
+    pkt->fpps[1] = 'P';
+    pkt->fpps[2] = 'P';
+    pkt->fpps[3] = 'S';
+    pkt->version = FPP_STREAM_VERSION;
+    pkt->session = m_session;
+    pkt->stepTime = m_frameStepTime;
+    pkt->frame = m_frame;
+    pkt->timestamp = m_frameTimestamp;
+    return p;
+}
+
+// Adds a packet for as many channels from start as fit, trying the largest
+// slice first and halving it until the compressed data fits in a packet.
+// Returns the number of channels used.
+uint32_t MultiSyncStream::AddSlice(uint32_t start, uint32_t len) {
+    const uint8_t* src = &m_working[start];
+    len = std::min(len, (uint32_t)STREAM_SLICE_CHANNELS);
+
+    const uint8_t* data = src;
+    uint16_t dataLen = 0;
+    uint8_t flags = 0;
+    while (true) {
+#ifndef NO_ZSTD
+        size_t csize = ZSTD_compressCCtx((ZSTD_CCtx*)m_cctx, &m_compressBuffer[0], m_compressBuffer.size(), src, len, 1);
+        if (!ZSTD_isError(csize) && csize <= STREAM_MAX_DATA && csize < len) {
+            data = &m_compressBuffer[0];
+            dataLen = csize;
+            flags = STREAM_SLICE_COMPRESSED;
+            break;
+        }
+#endif
+        if (len <= STREAM_MAX_DATA) {
+            dataLen = len;
+            break;
+        }
+        len = std::max(len / 2, (uint32_t)STREAM_MAX_DATA);
+    }
+
+    uint8_t* p = NewPacket(start >> STREAM_BLOCK_SHIFT);
+    StreamPkt* pkt = (StreamPkt*)p;
+    pkt->slice.flags = flags;
+    pkt->slice.startChannel = start;
+    pkt->slice.channelCount = len;
+    pkt->slice.dataLen = dataLen;
+    memcpy(p + sizeof(StreamPkt), data, dataLen);
+    m_packetLens.back() = sizeof(StreamPkt) + dataLen;
+    m_channelsSent += len;
+    return len;
+}
+
+// Numbers the count packets from first as a parity group and, if parity is
+// on, adds the parity packet after them.
+void MultiSyncStream::AddParity(int first, int count) {
+    uint16_t group = m_fecGroup++;
+    int region = 0;
+    for (int x = 0; x < count; x++) {
+        StreamPkt* pkt = (StreamPkt*)&m_packets[(first + x) * STREAM_MAX_PACKET];
+        pkt->fecGroup = group;
+        pkt->fecIndex = x;
+        pkt->fecCount = m_fecCount ? count : 0;
+        region = std::max(region, m_packetLens[first + x] - STREAM_HEADER_LEN);
+    }
+    if (!m_fecCount) {
+        return;
+    }
+
+    uint8_t* p = NewPacket(m_packetBlocks[first]);
+    StreamPkt* parity = (StreamPkt*)p;
+    parity->fecGroup = group;
+    parity->fecIndex = count;
+    parity->fecCount = count;
+    uint8_t* out = p + STREAM_HEADER_LEN;
+    memset(out, 0, region);
+    for (int x = 0; x < count; x++) {
+        const uint8_t* in = &m_packets[(first + x) * STREAM_MAX_PACKET + STREAM_HEADER_LEN];
+        int len = m_packetLens[first + x] - STREAM_HEADER_LEN;
+        for (int i = 0; i < len; i++) {
+            out[i] ^= in[i];
+        }
+    }
+    m_packetLens.back() = STREAM_HEADER_LEN + region;
+    m_parityPackets++;
+}
+
+void MultiSyncStream::FlushPackets() {
+    int count = m_packetLens.size();
+    m_iovecs.resize(count);
+    m_msgs.resize(count);
+    size_t bytes = 0;
+    for (int x = 0; x < count; x++) {
+        m_iovecs[x].iov_base = &m_packets[x * STREAM_MAX_PACKET];
+        m_iovecs[x].iov_len = m_packetLens[x];
+        memset(&m_msgs[x], 0, sizeof(struct mmsghdr));
+        m_msgs[x].msg_hdr.msg_name = &m_groupAddrs[m_packetBlocks[x]];
+        m_msgs[x].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        m_msgs[x].msg_hdr.msg_iov = &m_iovecs[x];
+        m_msgs[x].msg_hdr.msg_iovlen = 1;
+        bytes += m_packetLens[x];
+    }
+
+    std::vector<int> socks;
+    for (auto& s : m_sendSocks) {
+        socks.push_back(s.second.second);
+    }
+    if (socks.empty()) {
+        socks.push_back(m_sock);
+    }
+    for (auto sock : socks) {
+        int sent = 0;
+        while (sent < count) {
+            int oc = sendmmsg(sock, &m_msgs[sent], count - sent, 0);
+            if (oc <= 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                m_sendErrors++;
+                LogDebug(VB_SYNC, "Error sending MultiSync stream packets: %s   (%d/%d)\n", strerror(errno), sent, count);
+                break;
+            }
+            sent += oc;
+        }
+        m_packetsSent += sent;
+        m_bytesSent += bytes;
+    }
+}
+
+/*
+ * Remote
+ */
+void MultiSyncStream::SetupReceive() {
+    m_sock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (m_sock < 0) {
+        LogErr(VB_SYNC, "Error opening MultiSync stream socket: %s\n", strerror(errno));
+        return;
+    }
+    int optval = 1;
+    if (setsockopt(m_sock, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)) < 0) {
+        LogErr(VB_SYNC, "Error turning on SO_REUSEPORT for MultiSync stream: %s\n", strerror(errno));
+    }
+    // a frame arrives as a burst of packets, give the kernel room to hold it
+    int rcvBuf = 4 * 1024 * 1024;
+    setsockopt(m_sock, SOL_SOCKET, SO_RCVBUF, &rcvBuf, sizeof(rcvBuf));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(FPP_STREAM_PORT);
+    if (bind(m_sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        LogErr(VB_SYNC, "Error binding MultiSync stream socket: %s\n", strerror(errno));
+        close(m_sock);
+        m_sock = -1;
+        return;
+    }
+
+    uint32_t maxChannel = 0;
+    for (auto& r : GetOutputRanges(false)) {
+        if (r.first >= FPPD_MAX_CHANNELS) {
+            continue;
+        }
+        uint32_t len = std::min(r.second, (uint32_t)FPPD_MAX_CHANNELS - r.first);
+        m_ranges.push_back(std::pair<uint32_t, uint32_t>(r.first, len));
+        maxChannel = std::max(maxChannel, r.first + len);
+        for (uint32_t b = r.first >> STREAM_BLOCK_SHIFT; b <= ((r.first + len - 1) >> STREAM_BLOCK_SHIFT); b++) {
+            m_blocks.insert(b);
+        }
+    }
+    m_frameData.resize(maxChannel);
+    m_sliceBuffer.resize(STREAM_SLICE_CHANNELS);
+
+    JoinGroups();
+    LogInfo(VB_SYNC, "Receiving MultiSync frame stream for %d ranges in %d groups, %dms jitter buffer\n",
+            (int)m_ranges.size(), (int)m_blocks.size(), m_delay);
+}
+
+// Joins the groups on each of MultiSync's interfaces, like the MultiSync
+// control group.  Called again when the network changes, groups that are
+// already joined on an interface are skipped by the kernel.
+void MultiSyncStream::JoinGroups() {
+    std::map<std::string, uint32_t> interfaces = multiSync->GetInterfaceAddresses();
+    if (interfaces.empty()) {
+        interfaces[""] = htonl(INADDR_ANY);
+    }
+    for (auto& i : interfaces) {
+        for (auto b : m_blocks) {
+            struct ip_mreq mreq;
+            memset(&mreq, 0, sizeof(mreq));
+            mreq.imr_multiaddr.s_addr = StreamGroupAddress(b);
+            mreq.imr_interface.s_addr = i.second;
+            if (setsockopt(m_sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0 && errno != EADDRINUSE) {
+                LogWarn(VB_SYNC, "Could not join MultiSync stream group for channels %d-%d on %s: %s\n",
+                        (b << STREAM_BLOCK_SHIFT) + 1, (b + 1) << STREAM_BLOCK_SHIFT,
+                        i.first.empty() ? "any interface" : i.first.c_str(), strerror(errno));
+            }
+        }
+    }
+}
+
+void MultiSyncStream::ReceiveThread() {
+    TraceManager::INSTANCE.SetThreadName("MultiSyncStream");
+
+    std::vector<uint8_t> buffers(STREAM_RCV_MSGS * STREAM_MAX_PACKET);
+    struct mmsghdr msgs[STREAM_RCV_MSGS];
+    struct iovec iovecs[STREAM_RCV_MSGS];
+    for (int x = 0; x < STREAM_RCV_MSGS; x++) {
+        iovecs[x].iov_base = &buffers[x * STREAM_MAX_PACKET];
+        iovecs[x].iov_len = STREAM_MAX_PACKET;
+    }
+
+    while (m_running) {
+        int timeout = 100;
+        if (!m_frames.empty()) {
+            int64_t wait = (int64_t)m_frames.begin()->second.releaseAt - (int64_t)GetTimeMS();
+            timeout = std::clamp(wait, (int64_t)0, (int64_t)timeout);
+        }
+        struct pollfd pfd[2];
+        pfd[0].fd = m_sock;
+        pfd[0].events = POLLIN;
+        pfd[0].revents = 0;
+        pfd[1].fd = m_wakePipe[0];
+        pfd[1].events = POLLIN;
+        pfd[1].revents = 0;
+        int rc = poll(pfd, m_wakePipe[0] >= 0 ? 2 : 1, timeout);
+        if (rc > 0 && (pfd[1].revents & POLLIN)) {
+            char buf[16];
+            while (read(m_wakePipe[0], buf, sizeof(buf)) > 0) {
+            }
+        }
+        if (m_blankRequested.exchange(false)) {
+            EndStream(GetTimeMS());
+        }
+        if (m_networkChanged.exchange(false)) {
+            JoinGroups();
+        }
+        if (rc > 0 && (pfd[0].revents & POLLIN)) {
+            int count = STREAM_RCV_MSGS;
+            while (count == STREAM_RCV_MSGS) {
+                memset(msgs, 0, sizeof(msgs));
+                for (int x = 0; x < STREAM_RCV_MSGS; x++) {
+                    msgs[x].msg_hdr.msg_iov = &iovecs[x];
+                    msgs[x].msg_hdr.msg_iovlen = 1;
+                }
+                count = recvmmsg(m_sock, msgs, STREAM_RCV_MSGS, MSG_DONTWAIT, nullptr);
+                uint64_t now = GetTimeMS();
+                for (int x = 0; x < count; x++) {
+                    ProcessPacket(&buffers[x * STREAM_MAX_PACKET], msgs[x].msg_len, now);
+                }
+            }
+        }
+        ReleaseFrames(GetTimeMS());
+    }
+}
+
+void MultiSyncStream::ProcessPacket(uint8_t* buf, int len, uint64_t now) {
+    StreamPkt* pkt = (StreamPkt*)buf;
+    if (len < (int)sizeof(StreamPkt) || memcmp(pkt->fpps, "FPPS", 4) || pkt->version != FPP_STREAM_VERSION ||
+        pkt->fecCount > STREAM_MAX_FEC || pkt->fecIndex > pkt->fecCount) {
+        m_badPackets++;
+        return;
+    }
+    bool parity = pkt->fecCount && pkt->fecIndex == pkt->fecCount;
+    if (!parity && len < (int)sizeof(StreamPkt) + pkt->slice.dataLen) {
+        m_badPackets++;
+        return;
+    }
+    m_packetsReceived++;
+
+    if (!m_haveSession || pkt->session != m_remoteSession) {
+        if (m_haveSession) {
+            // master restarted, its frame numbers start over
+            m_frames.clear();
+            m_haveReleased = false;
+            m_anchored = false;
+            m_resyncs++;
+        }
+        m_haveSession = true;
+        m_remoteSession = pkt->session;
+        m_maxFrame = pkt->frame;
+    }
+
+    if (pkt->flags & STREAM_FLAG_END) {
+        // the marker is sent more than once, only act on the first
+        if (!m_haveReleased || (int32_t)(pkt->frame - m_lastReleased) > 0) {
+            EndStream(now);
+            m_lastReleased = pkt->frame;
+            m_maxFrame = pkt->frame;
+        }
+        return;
+    }
+
+    if (m_haveReleased) {
+        int32_t diff = (int32_t)(pkt->frame - m_lastReleased);
+        if (diff <= 0) {
+            if (diff > -STREAM_MAX_PENDING_FRAMES * 4) {
+                m_latePackets++;
+                return;
+            }
+            // frame counter went back without a new session, start over
+            m_frames.clear();
+            m_haveReleased = false;
+            m_anchored = false;
+            m_resyncs++;
+        }
+    }
+    if ((int32_t)(pkt->frame - m_maxFrame) > 0) {
+        m_maxFrame = pkt->frame;
+    }
+
+    auto it = m_frames.find(pkt->frame);
+    if (it == m_frames.end()) {
+        PendingFrame& frame = m_frames[pkt->frame];
+        frame.stepTime = pkt->stepTime ? pkt->stepTime : 50;
+        frame.releaseAt = Schedule(pkt->timestamp, now) + m_delay;
+        it = m_frames.find(pkt->frame);
+    }
+    auto& group = it->second.groups[pkt->fecGroup];
+    if (group.empty()) {
+        group.resize(pkt->fecCount + 1);
+    } else if ((int)group.size() != pkt->fecCount + 1) {
+        m_badPackets++;
+        return;
+    }
+    group[pkt->fecIndex].assign(buf, buf + len);
+}
+
+// Works out when a frame sent at the master's timestamp should be output.
+// Network delay only ever makes packets later, so the earliest arrival seen
+// is used as the reference and the smallest lateness over each window is
+// folded back in to follow the two clocks drifting apart.
+uint64_t MultiSyncStream::Schedule(uint32_t timestamp, uint64_t now) {
+    int64_t expected = (int64_t)m_anchorLocal + (int32_t)(timestamp - m_anchorTimestamp);
+    if (!m_anchored || std::llabs((int64_t)now - expected) > 1000) {
+        if (m_anchored) {
+            m_resyncs++;
+        }
+        m_anchored = true;
+        m_anchorTimestamp = timestamp;
+        m_anchorLocal = now;
+        m_windowStart = now;
+        m_windowMinLate = INT64_MAX;
+        return now;
+    }
+    int64_t late = (int64_t)now - expected;
+    if (late < 0) {
+        m_anchorLocal += late;
+        expected = now;
+        late = 0;
+    }
+    m_windowMinLate = std::min(m_windowMinLate, late);
+    if (now - m_windowStart >= 5000) {
+        m_anchorLocal += m_windowMinLate;
+        expected += m_windowMinLate;
+        m_windowStart = now;
+        m_windowMinLate = INT64_MAX;
+    }
+    return expected;
+}
+
+void MultiSyncStream::ReleaseFrames(uint64_t now) {
+    while (!m_frames.empty()) {
+        auto it = m_frames.begin();
+        if (it->second.releaseAt > now && m_frames.size() <= STREAM_MAX_PENDING_FRAMES) {
+            break;
+        }
+        if (sequence->IsSequenceRunning()) {
+            // playing our own copy of the sequence, leave it alone
+            m_framesSkipped++;
+        } else {
+            FPP_TRACE_SPAN("MultiSyncStream::ReleaseFrame");
+            bool applied = false;
+            for (auto& g : it->second.groups) {
+                auto& packets = g.second;
+                int dataCount = packets.size() > 1 ? packets.size() - 1 : 1;
+                int missing = -1;
+                int missingCount = 0;
+                for (int x = 0; x < dataCount; x++) {
+                    if (packets[x].empty()) {
+                        missing = x;
+                        missingCount++;
+                    }
+                }
+                if (missingCount == 1 && packets.size() > 1 && RecoverGroup(packets, missing)) {
+                    m_slicesRecovered++;
+                    missingCount = 0;
+                }
+                m_slicesLost += missingCount;
+                for (int x = 0; x < dataCount; x++) {
+                    if (!packets[x].empty()) {
+                        applied |= ApplySlice(packets[x]);
+                    }
+                }
+            }
+            if (applied) {
+                uint64_t expires = now + std::max(STREAM_DATA_TIMEOUT, it->second.stepTime * 4);
+                for (auto& r : m_ranges) {
+                    sequence->SetBridgeData(&m_frameData[r.first], r.first, r.second, expires);
+                }
+                m_appliedUntil = expires;
+                m_lastStepTime = it->second.stepTime;
+            }
+            m_framesReleased++;
+        }
+        m_lastReleased = it->first;
+        m_haveReleased = true;
+        m_frames.erase(it);
+    }
+}
+
+// The master ended the stream or the output was blanked.  Drops the frames
+// still waiting and everything up to the newest frame seen, and if stream
+// data may still be output, replaces it with zeros that expire shortly
+// after so the last frame doesn't sit on the outputs until it times out.
+void MultiSyncStream::EndStream(uint64_t now) {
+    m_frames.clear();
+    if (m_haveSession) {
+        m_lastReleased = m_maxFrame;
+        m_haveReleased = true;
+    }
+    if (m_appliedUntil > now) {
+        std::fill(m_frameData.begin(), m_frameData.end(), 0);
+        uint64_t expires = now + std::max(200, m_lastStepTime * 4);
+        for (auto& r : m_ranges) {
+            sequence->SetBridgeData(&m_frameData[r.first], r.first, r.second, expires);
+        }
+        m_appliedUntil = 0;
+    }
+    m_streamEnds++;
+}
+
+bool MultiSyncStream::RecoverGroup(std::vector<std::vector<uint8_t>>& packets, int missing) {
+    const std::vector<uint8_t>& parity = packets.back();
+    if (parity.empty()) {
+        return false;
+    }
+    std::vector<uint8_t> out = parity;
+    for (int x = 0; x < (int)packets.size() - 1; x++) {
+        if (x == missing) {
+            continue;
+        }
+        int len = std::min(packets[x].size(), out.size());
+        for (int i = STREAM_HEADER_LEN; i < len; i++) {
+            out[i] ^= packets[x][i];
+        }
+    }
+    StreamPkt* pkt = (StreamPkt*)&out[0];
+    size_t len = sizeof(StreamPkt) + pkt->slice.dataLen;
+    if (out.size() < len) {
+        return false;
+    }
+    out.resize(len);
+    pkt->fecIndex = missing;
+    packets[missing] = std::move(out);
+    return true;
+}
+
+bool MultiSyncStream::ApplySlice(const std::vector<uint8_t>& buf) {
+    const StreamPkt* pkt = (const StreamPkt*)&buf[0];
+    const uint8_t* data = &buf[sizeof(StreamPkt)];
+    uint32_t start = pkt->slice.startChannel;
+    uint32_t count = pkt->slice.channelCount;
+    if (start >= m_frameData.size() || count > STREAM_SLICE_CHANNELS) {
+        return false;
+    }
+    bool wanted = false;
+    for (auto& r : m_ranges) {
+        if (r.first < start + count && start < r.first + r.second) {
+            wanted = true;
+            break;
+        }
+    }
+    if (!wanted) {
+        return false;
+    }
+
+    uint32_t len = std::min(count, (uint32_t)m_frameData.size() - start);
+    if (pkt->slice.flags & STREAM_SLICE_COMPRESSED) {
+#ifndef NO_ZSTD
+        size_t r = ZSTD_decompressDCtx((ZSTD_DCtx*)m_dctx, &m_sliceBuffer[0], count, data, pkt->slice.dataLen);
+        if (ZSTD_isError(r) || r != count) {
+            m_badPackets++;
+            return false;
+        }
+        memcpy(&m_frameData[start], &m_sliceBuffer[0], len);
+#else
+        return false;
+#endif
+    } else {
+        if (pkt->slice.dataLen < count) {
+            m_badPackets++;
+            return false;
+        }
+        memcpy(&m_frameData[start], data, len);
+    }
+    return true;
+}
+
+Json::Value MultiSyncStream::GetStats() {
+    Json::Value result;
+    result["sending"] = m_sending;
+    result["receiving"] = m_receiving;
+    if (m_sending) {
+        result["parityEvery"] = m_fecCount;
+        result["framesSent"] = (Json::UInt64)m_framesSent;
+        result["framesReplaced"] = (Json::UInt64)m_framesReplaced;
+        result["packetsSent"] = (Json::UInt64)m_packetsSent;
+        result["parityPackets"] = (Json::UInt64)m_parityPackets;
+        result["bytesSent"] = (Json::UInt64)m_bytesSent;
+        result["channelsSent"] = (Json::UInt64)m_channelsSent;
+        result["sendErrors"] = (Json::UInt64)m_sendErrors;
+        result["endsSent"] = (Json::UInt64)m_endsSent;
+    }
+    if (m_receiving) {
+        result["jitterBuffer"] = m_delay;
+        result["packetsReceived"] = (Json::UInt64)m_packetsReceived;
+        result["badPackets"] = (Json::UInt64)m_badPackets;
+        result["latePackets"] = (Json::UInt64)m_latePackets;
+        result["framesReleased"] = (Json::UInt64)m_framesReleased;
+        result["framesSkipped"] = (Json::UInt64)m_framesSkipped;
+        result["slicesRecovered"] = (Json::UInt64)m_slicesRecovered;
+        result["slicesLost"] = (Json::UInt64)m_slicesLost;
+        result["resyncs"] = (Json::UInt64)m_resyncs;
+        result["streamEnds"] = (Json::UInt64)m_streamEnds;
+    }
+    return result;
+}
+
+void MultiSyncStream::ResetStats() {
+    m_framesSent = 0;
+    m_framesReplaced = 0;
+    m_packetsSent = 0;
+    m_parityPackets = 0;
+    m_bytesSent = 0;
+    m_channelsSent = 0;
+    m_sendErrors = 0;
+    m_endsSent = 0;
+
+    m_packetsReceived = 0;
+    m_badPackets = 0;
+    m_latePackets = 0;
+    m_framesReleased = 0;
+    m_framesSkipped = 0;
+    m_slicesRecovered = 0;
+    m_slicesLost = 0;
+    m_resyncs = 0;
+    m_streamEnds = 0;
+}
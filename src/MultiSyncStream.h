@@ -0,0 +1,227 @@
+#pragma once
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SysSocket.h"
+#include <netinet/in.h>
+
+/*
+ * Streams the channel data of the running sequence from a MultiSync master
+ * to remotes that don't have a copy of the FSEQ file.
+ *
+ * Each frame is cut into slices of at most 64K channels (a "block") which
+ * are zstd compressed when that helps.  Every block is sent to its own
+ * multicast group (239.70.81.<block>) so remotes only join the groups that
+ * cover their output ranges and IGMP snooping switches keep the rest of the
+ * show off their ports.  Within a block, every fecCount slices are followed
+ * by an XOR parity packet so any single lost packet in a group can be
+ * rebuilt without a round trip to the master.
+ *
+ * Remotes hold frames in a small jitter buffer, scheduled from the master's
+ * send timestamps, then hand them to the output through the bridge data
+ * path.  Nothing is applied while the remote is playing the sequence itself.
+ *
+ * Both sides use MultiSync's interfaces, the master sends the stream out of
+ * each of them and remotes join the groups on each of them, again whenever
+ * the network changes.  When the master blanks it sends an end of stream
+ * marker so remotes drop what is still buffered and blank the stream's
+ * ranges instead of outputting the last frames after the blank.  Every
+ * master start picks a random session id so remotes don't mistake the new
+ * stream's frames for late ones.
+ */
+
+#define FPP_STREAM_PORT 32328
+#define FPP_STREAM_VERSION 2
+
+// channels per multicast group
+#define STREAM_BLOCK_SHIFT 16
+#define STREAM_BLOCK_CHANNELS (1 << STREAM_BLOCK_SHIFT)
+// largest slice that is tried before splitting
+#define STREAM_SLICE_CHANNELS 8192
+#define STREAM_MAX_PACKET 1400
+#define STREAM_MAX_FEC 16
+
+#define STREAM_SLICE_COMPRESSED 0x01
+
+// the master blanked, no slice data, frame is the frame after the last one
+#define STREAM_FLAG_END 0x01
+
+typedef struct __attribute__((packed)) {
+    uint8_t flags;         // STREAM_SLICE_*
+    uint32_t startChannel; // first channel, 0 based
+    uint32_t channelCount; // channels in the slice once uncompressed
+    uint16_t dataLen;      // bytes of data following the header
+} StreamSlice;
+
+typedef struct __attribute__((packed)) {
+    char fpps[4];       // 'FPPS'
+    uint8_t version;    // FPP_STREAM_VERSION
+    uint8_t fecIndex;   // index within the parity group, fecCount for the parity packet
+    uint8_t fecCount;   // data packets in the parity group, 0 if there is no parity
+    uint8_t flags;      // STREAM_FLAG_*
+    uint16_t session;   // random, picked every time the master starts
+    uint16_t fecGroup;  // parity group number within the frame
+    uint16_t stepTime;  // ms per frame on the master
+    uint32_t frame;     // stream frame counter
+    uint32_t timestamp; // master clock (ms) when the frame was queued
+
+    // The parity packet carries the XOR of the slice headers and data of
+    // every packet in the group, the data padded to the longest packet.
+    StreamSlice slice;
+} StreamPkt;
+
+#define STREAM_HEADER_LEN ((int)(sizeof(StreamPkt) - sizeof(StreamSlice)))
+#define STREAM_MAX_DATA (STREAM_MAX_PACKET - (int)sizeof(StreamPkt))
+
+class MultiSyncStream {
+public:
+    static MultiSyncStream INSTANCE;
+
+    MultiSyncStream();
+    ~MultiSyncStream();
+
+    void Init();
+    void Shutdown();
+
+    bool IsSending() const { return m_sending; }
+    bool IsReceiving() const { return m_receiving; }
+
+    // Master side, queue a frame to be streamed.  The frame is copied and
+    // sent from the stream thread, if the previous frame hasn't been sent
+    // yet it is replaced.
+    void SendFrame(const uint8_t* data, uint32_t channelCount, int stepTime);
+
+    // The output was blanked.  The master sends an end of stream after the
+    // last queued frame, a remote drops its jitter buffer and blanks the
+    // stream's ranges.
+    void Blank();
+
+    Json::Value GetStats();
+    void ResetStats();
+
+private:
+    void SendThread();
+    void SendQueuedFrame();
+    void SendEnd();
+    void UpdateSendSockets();
+    uint8_t* NewPacket(uint32_t block);
+    uint32_t AddSlice(uint32_t start, uint32_t len);
+    void AddParity(int first, int count);
+    void FlushPackets();
+
+    void ReceiveThread();
+    void SetupReceive();
+    void JoinGroups();
+    void EndStream(uint64_t now);
+    void ProcessPacket(uint8_t* buf, int len, uint64_t now);
+    uint64_t Schedule(uint32_t timestamp, uint64_t now);
+    void ReleaseFrames(uint64_t now);
+    bool RecoverGroup(std::vector<std::vector<uint8_t>>& packets, int missing);
+    bool ApplySlice(const std::vector<uint8_t>& pkt);
+
+    bool m_sending = false;
+    bool m_receiving = false;
+    std::atomic_bool m_running{ false };
+    std::thread* m_thread = nullptr;
+    int m_sock = -1;
+    int m_networkCallbackId = -1;
+    // set from the network monitor, the stream thread updates its sockets
+    // or group memberships from MultiSync's interfaces
+    std::atomic_bool m_networkChanged{ false };
+
+    // master
+    std::mutex m_sendLock;
+    std::condition_variable m_sendSignal;
+    std::vector<uint8_t> m_pending;
+    std::vector<uint8_t> m_working;
+    bool m_pendingReady = false;
+    bool m_pendingEnd = false;
+    uint16_t m_session = 0;
+    uint32_t m_lastBlockCount = 0;
+    // interface name -> address and the socket sending out of it, m_sock
+    // is used when MultiSync has no interfaces
+    std::map<std::string, std::pair<uint32_t, int>> m_sendSocks;
+    uint32_t m_pendingTimestamp = 0;
+    int m_pendingStepTime = 50;
+    int m_fecCount = 4;
+    uint32_t m_frame = 0;
+    uint32_t m_frameTimestamp = 0;
+    int m_frameStepTime = 50;
+    uint16_t m_fecGroup = 0;
+    void* m_cctx = nullptr;
+    std::vector<uint8_t> m_compressBuffer;
+    std::vector<uint8_t> m_packets;
+    std::vector<int> m_packetLens;
+    std::vector<uint32_t> m_packetBlocks;
+    std::vector<struct sockaddr_in> m_groupAddrs;
+    std::vector<struct iovec> m_iovecs;
+    std::vector<struct mmsghdr> m_msgs;
+
+    // remote
+    class PendingFrame {
+    public:
+        uint64_t releaseAt = 0;
+        int stepTime = 50;
+        // fecGroup -> packets, fecCount data packets then parity
+        std::map<uint16_t, std::vector<std::vector<uint8_t>>> groups;
+    };
+    std::map<uint32_t, PendingFrame> m_frames;
+    std::vector<std::pair<uint32_t, uint32_t>> m_ranges;
+    std::set<uint32_t> m_blocks;
+    std::atomic_bool m_blankRequested{ false };
+    int m_wakePipe[2] = { -1, -1 };
+    bool m_haveSession = false;
+    uint16_t m_remoteSession = 0;
+    uint32_t m_maxFrame = 0;
+    int m_lastStepTime = 50;
+    // stream data has been handed to the output and may not have expired
+    uint64_t m_appliedUntil = 0;
+    std::vector<uint8_t> m_frameData;
+    std::vector<uint8_t> m_sliceBuffer;
+    void* m_dctx = nullptr;
+    int m_delay = 50;
+    bool m_haveReleased = false;
+    uint32_t m_lastReleased = 0;
+    bool m_anchored = false;
+    uint32_t m_anchorTimestamp = 0;
+    uint64_t m_anchorLocal = 0;
+    int64_t m_windowMinLate = 0;
+    uint64_t m_windowStart = 0;
+
+    std::atomic_uint64_t m_framesSent{ 0 };
+    std::atomic_uint64_t m_framesReplaced{ 0 };
+    std::atomic_uint64_t m_packetsSent{ 0 };
+    std::atomic_uint64_t m_parityPackets{ 0 };
+    std::atomic_uint64_t m_bytesSent{ 0 };
+    std::atomic_uint64_t m_channelsSent{ 0 };
+    std::atomic_uint64_t m_sendErrors{ 0 };
+    std::atomic_uint64_t m_endsSent{ 0 };
+
+    std::atomic_uint64_t m_packetsReceived{ 0 };
+    std::atomic_uint64_t m_badPackets{ 0 };
+    std::atomic_uint64_t m_latePackets{ 0 };
+    std::atomic_uint64_t m_framesReleased{ 0 };
+    std::atomic_uint64_t m_framesSkipped{ 0 };
+    std::atomic_uint64_t m_slicesRecovered{ 0 };
+    std::atomic_uint64_t m_slicesLost{ 0 };
+    std::atomic_uint64_t m_resyncs{ 0 };
+    std::atomic_uint64_t m_streamEnds{ 0 };
+};
@@ -21,8 +21,10 @@
 #include <unistd.h>
 
 #include "MultiSync.h"
+#include "MultiSyncStream.h"
 #include "Player.h"
 #include "Plugins.h"
+#include "Trace.h"
 #include "effects.h"
 #include "fppd.h"
 #include "channeloutput/ChannelOutputSetup.h"
@@ -44,6 +46,7 @@ Sequence::Sequence() :
     m_seqMSElapsed(0),
     m_seqMSRemaining(0),
     m_seqFile(nullptr),
+    m_seqChannelCount(0),
     m_seqStarting(0),
     m_seqPaused(0),
     m_seqSingleStep(0),
@@ -58,7 +61,14 @@ Sequence::Sequence() :
     m_lastFrameData(nullptr),
     m_dataProcessed(false),
     m_seqFilename(""),
-    m_bridgeData(nullptr) {
+    m_bridgeSlotCount(0),
+    m_bridgeSlotsVersion(0),
+    m_bridgeWriteSeq(0),
+    m_bridgeExpires(0),
+    m_bridgeMergeVersion(~0u) {
+    for (auto& i : m_bridgeSlotIndex) {
+        i = -1;
+    }
     memset(m_seqData, 0, sizeof(m_seqData));
     for (int x = 0; x < 4; x++) {
         m_seqData[FPPD_OFF_CHANNEL + x] = 0;
@@ -85,8 +95,11 @@ Sequence::~Sequence() {
     if (m_seqFile) {
         delete m_seqFile;
     }
-    if (m_bridgeData) {
-        free(m_bridgeData);
+    for (int x = 0; x < m_bridgeSlotCount; x++) {
+        delete m_bridgeSlots[x].load();
+    }
+    for (auto& s : m_retiredBridgeSlots) {
+        delete s.second;
     }
 }
 void Sequence::clearCaches() {
@@ -135,6 +148,7 @@ void ReadSequenceDataThread(Sequence* sequence) {
     sequence->ReadFramesLoop();
 }
 void Sequence::ReadFramesLoop() {
+    TraceManager::INSTANCE.SetThreadName("SequenceReader");
     std::unique_lock<std::mutex> lock(frameCacheLock);
     while (true) {
         if (m_shuttingDown) {
@@ -154,6 +168,7 @@ void Sequence::ReadFramesLoop() {
                 if (m_doneRead || file == nullptr) {
                     //memset(fd->data, 0, maxChanToRead);
                 } else {
+                    FPP_TRACE_SPAN_ARG("Sequence::getFrame", frame);
                     fd = m_seqFile->getFrame(frame);
                 }
                 long long unlock = GetTimeMS();
@@ -288,7 +303,15 @@ int Sequence::OpenSequenceFile(const std::string& filename, int startFrame, int
             m_lastFrameRead = -1;
     }
 
-    seqFile->prepareRead(GetOutputRanges(), startFrame < 0 ? 0 : startFrame);
+    if (MultiSyncStream::INSTANCE.IsSending()) {
+        // remotes may need any of the channels, not just the ones we output
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+        ranges.push_back(std::pair<uint32_t, uint32_t>(0, seqFile->getChannelCount()));
+        seqFile->prepareRead(ranges, startFrame < 0 ? 0 : startFrame);
+    } else {
+        seqFile->prepareRead(GetOutputRanges(), startFrame < 0 ? 0 : startFrame);
+    }
+    m_seqChannelCount = seqFile->getChannelCount();
     // Calculate duration
     m_seqMSRemaining = seqFile->getNumFrames() * seqFile->getStepTime();
     m_seqMSDuration = m_seqMSRemaining;
@@ -405,12 +428,12 @@ void Sequence::BlankSequenceData(bool clearBridge) {
     for (auto& a : GetOutputRanges()) {
         memset(&m_seqData[a.first], 0, a.second);
     }
-    if (m_bridgeData && clearBridge) {
-        for (auto& a : GetOutputRanges()) {
-            memset(&m_bridgeData[a.first], 0, a.second);
+    if (clearBridge) {
+        m_bridgeExpires = 0;
+        int count = m_bridgeSlotCount.load(std::memory_order_acquire);
+        for (int x = 0; x < count; x++) {
+            m_bridgeSlots[x].load(std::memory_order_acquire)->Expire(false);
         }
-        std::unique_lock<std::mutex> lock(m_bridgeRangesLock);
-        m_bridgeRanges.clear();
     }
 
     m_dataProcessed = false;
@@ -440,6 +463,7 @@ void Sequence::SingleStepSequenceBack(void) {
 
 void Sequence::ReadSequenceData(bool forceFirstFrame) {
     LogExcess(VB_SEQUENCE, "ReadSequenceData()\n");
+    FPP_TRACE_SPAN("Sequence::ReadSequenceData");
     std::unique_lock<std::recursive_mutex> seqLock(m_sequenceLock);
     if (!forceFirstFrame && m_seqStarting) {
         return;
@@ -540,6 +564,7 @@ void Sequence::ReadSequenceData(bool forceFirstFrame) {
 
 void Sequence::ProcessSequenceData(int ms, int checkControlChannels) {
     static unsigned int controlChannel = (unsigned int)getSettingInt("PresetControlChannel");
+    FPP_TRACE_SPAN_ARG("Sequence::ProcessSequenceData", ms);
 
     if (m_dataProcessed) {
         // we shouldn't normally be reprocessing the same data, so
@@ -549,65 +574,21 @@ void Sequence::ProcessSequenceData(int ms, int checkControlChannels) {
             m_lastFrameData->readFrame((uint8_t*)m_seqData, FPPD_MAX_CHANNELS);
     }
 
-    std::unique_lock<std::mutex> bridgesLock(m_bridgeRangesLock);
-    if (m_bridgeData && !m_bridgeRanges.empty()) {
-        // copy the latest bridge data to the sequence data
-        uint64_t nt = GetTimeMS();
-        std::map<uint32_t, uint32_t> rngs;
-        for (auto& a : m_bridgeRanges) {
-            BridgeRangeData& rd = a.second;
-            auto it = rd.expires.begin();
-            uint32_t len = 0;
-            while (it != rd.expires.end()) {
-                if (it->second < nt) {
-                    rd.expires.erase(it);
-                    it = rd.expires.begin();
-                } else {
-                    len = std::max(len, it->first);
-                    ++it;
-                }
-            }
-            if (len > 0) {
-                rngs[rd.startChannel] = len;
-            }
-        }
-        auto it = m_bridgeRanges.begin();
-        while (it != m_bridgeRanges.end()) {
-            if (it->second.expires.empty()) {
-                m_bridgeRanges.erase(it);
-                it = m_bridgeRanges.begin();
-            } else {
-                ++it;
-            }
-        }
+    if (!m_dataProcessed && MultiSyncStream::INSTANCE.IsSending() && IsSequenceRunning()) {
+        MultiSyncStream::INSTANCE.SendFrame((uint8_t*)m_seqData, m_seqChannelCount, m_seqStepTime);
+    }
 
-        uint32_t curStart = 0xFFFFFFFF;
-        uint32_t nextStart = 0xFFFFFFFF;
-        for (auto& a : rngs) {
-            if (curStart == 0xFFFFFFFF) {
-                curStart = a.first;
-                nextStart = a.first + a.second;
-            } else if (a.first > nextStart) {
-                memcpy(&m_seqData[curStart], &m_bridgeData[curStart], nextStart - curStart);
-                curStart = a.first;
-                nextStart = a.first + a.second;
-            } else if (a.first == nextStart) {
-                nextStart += a.second;
-            } else {
-                nextStart += a.second - (nextStart - a.first);
-            }
-        }
-        if (curStart != 0xFFFFFFFF) {
-            memcpy(&m_seqData[curStart], &m_bridgeData[curStart], nextStart - curStart);
-        }
+    if (hasBridgeData()) {
+        MergeBridgeData();
     }
-    bridgesLock.unlock();
     PluginManager::INSTANCE.modifySequenceData(ms, (uint8_t*)m_seqData);
 
-    if (IsEffectRunning())
+    if (IsEffectRunning() && !SkipOptionalFrameStage(OptionalFrameStage::OverlayEffects)) {
+        FPP_TRACE_SPAN("Sequence::OverlayEffects");
         OverlayEffects(m_seqData);
+    }
 
-    if (SDLOutput::IsOverlayingVideo()) {
+    if (SDLOutput::IsOverlayingVideo() && !SkipOptionalFrameStage(OptionalFrameStage::VideoOverlay)) {
         SDLOutput::ProcessVideoOverlay(ms);
     }
     if (PixelOverlayManager::INSTANCE.hasActiveOverlays()) {
@@ -645,6 +626,7 @@ void Sequence::SendBlankingData(void) {
 
     if (multiSync->isMultiSyncEnabled())
         multiSync->SendBlankingDataPacket();
+    MultiSyncStream::INSTANCE.Blank();
 
     BlankSequenceData(true);
 
@@ -699,26 +681,292 @@ void Sequence::CloseSequenceFile(void) {
     }
 }
 
+Sequence::BridgeSlot::BridgeSlot(uint32_t start, uint32_t cap) :
+    startChannel(start),
+    capacity(cap) {
+    for (int x = 0; x < 2; x++) {
+        owned[x] = (uint8_t*)calloc(1, cap);
+        buffers[x] = owned[x];
+        lens[x] = 0;
+    }
+}
+Sequence::BridgeSlot::~BridgeSlot() {
+    free(owned[0]);
+    free(owned[1]);
+}
+
+// Readers use the buffer selected by generation / 2.  A writer fills the
+// other buffer and then moves the generation on to publish it, so a reader
+// only has to retry if the writer has started on the buffer it is reading,
+// at generation + 3 or later.
+void Sequence::BridgeSlot::Write(uint8_t* data, uint32_t len, uint64_t expireMS, uint64_t seq) {
+    Lock();
+    writeSeq.store(seq, std::memory_order_relaxed);
+    uint32_t g = generation.load(std::memory_order_relaxed);
+    int b = ((g >> 1) + 1) & 1;
+    generation.store(g + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(owned[b], data, len);
+    buffers[b].store(owned[b], std::memory_order_relaxed);
+    lens[b].store(len, std::memory_order_relaxed);
+    expires.store(expireMS, std::memory_order_relaxed);
+    generation.store(g + 2, std::memory_order_release);
+    Unlock();
+}
+
+// Zero copy, the caller's buffer becomes the back buffer and is published.
+// Nothing is written to the buffer readers may be using.
+void Sequence::BridgeSlot::Publish(uint8_t* data, uint32_t len, uint64_t expireMS, uint64_t seq) {
+    Lock();
+    writeSeq.store(seq, std::memory_order_relaxed);
+    uint32_t g = generation.load(std::memory_order_relaxed);
+    int b = ((g >> 1) + 1) & 1;
+    buffers[b].store(data, std::memory_order_relaxed);
+    lens[b].store(len, std::memory_order_relaxed);
+    expires.store(expireMS, std::memory_order_relaxed);
+    generation.store(g + 2, std::memory_order_release);
+    Unlock();
+}
+
+// stop outputting the slot, with release, also drop any zero copy buffers
+void Sequence::BridgeSlot::Expire(bool release) {
+    Lock();
+    expires.store(0, std::memory_order_relaxed);
+    if (release) {
+        for (int x = 0; x < 2; x++) {
+            buffers[x].store(owned[x], std::memory_order_relaxed);
+            lens[x].store(0, std::memory_order_relaxed);
+        }
+        generation.fetch_add(4, std::memory_order_release);
+    }
+    Unlock();
+}
+
+bool Sequence::BridgeSlot::Read(uint8_t* seqData, uint64_t now) {
+    if (expires.load(std::memory_order_relaxed) < now) {
+        return false;
+    }
+    for (int retry = 0; retry < 8; retry++) {
+        uint32_t g = generation.load(std::memory_order_acquire);
+        int f = (g >> 1) & 1;
+        uint8_t* data = buffers[f].load(std::memory_order_relaxed);
+        uint32_t len = lens[f].load(std::memory_order_relaxed);
+        memcpy(&seqData[startChannel], data, len);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((generation.load(std::memory_order_relaxed) - (g & ~1u)) < 3) {
+            return true;
+        }
+    }
+    // the writers keep lapping us, hold them off for one last copy of the
+    // front buffer rather than output a torn one
+    Lock();
+    int f = (generation.load(std::memory_order_relaxed) >> 1) & 1;
+    memcpy(&seqData[startChannel], buffers[f].load(std::memory_order_relaxed), lens[f].load(std::memory_order_relaxed));
+    Unlock();
+    return true;
+}
+
+// index of the slot for startChannel or -1 with bucket set to the free
+// bucket for it.  Without m_bridgeSlotsLock this can miss a slot while the
+// table is being rebuilt, never return the wrong one.
+int Sequence::FindBridgeSlot(uint32_t startChannel, uint32_t& bucket) {
+    bucket = (startChannel * 2654435761u) & (BRIDGE_SLOT_HASH_SIZE - 1);
+    while (true) {
+        int idx = m_bridgeSlotIndex[bucket].load(std::memory_order_acquire);
+        if (idx < 0 || m_bridgeSlots[idx].load(std::memory_order_acquire)->startChannel == startChannel) {
+            return idx;
+        }
+        bucket = (bucket + 1) & (BRIDGE_SLOT_HASH_SIZE - 1);
+    }
+}
+
+// called with m_bridgeSlotsLock held, frees slots that were retired long
+// enough ago that no writer or reader can still have them
+void Sequence::RetireBridgeSlot(BridgeSlot* slot, uint64_t now) {
+    auto it = m_retiredBridgeSlots.begin();
+    while (it != m_retiredBridgeSlots.end()) {
+        if (it->first + BRIDGE_SLOT_RETIRE_MS < now) {
+            delete it->second;
+            it = m_retiredBridgeSlots.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (slot) {
+        slot->Expire(false);
+        m_retiredBridgeSlots.push_back(std::make_pair(now, slot));
+    }
+}
+
+// called with m_bridgeSlotsLock held once every slot is in use, finds the
+// slot that expired the longest ago (at least BRIDGE_SLOT_RECLAIM_MS),
+// retires it and drops it from the lookup table.  Returns its index for
+// the new range or -1 if everything is still in use.
+int Sequence::ReclaimBridgeSlot(uint64_t now) {
+    int count = m_bridgeSlotCount.load(std::memory_order_relaxed);
+    int best = -1;
+    uint64_t oldest = now > BRIDGE_SLOT_RECLAIM_MS ? now - BRIDGE_SLOT_RECLAIM_MS : 0;
+    for (int x = 0; x < count; x++) {
+        uint64_t e = m_bridgeSlots[x].load(std::memory_order_relaxed)->Expires();
+        if (e < oldest) {
+            oldest = e;
+            best = x;
+        }
+    }
+    if (best < 0) {
+        return -1;
+    }
+    BridgeSlot* old = m_bridgeSlots[best].load(std::memory_order_relaxed);
+    LogDebug(VB_SEQUENCE, "Reclaiming bridge slot for channel %d\n", old->startChannel);
+    RetireBridgeSlot(old, now);
+
+    // open addressing can't just empty a bucket, rebuild the table without
+    // the reclaimed slot.  Lookups without the lock may miss while this is
+    // going on and then look again under the lock.
+    for (auto& i : m_bridgeSlotIndex) {
+        i.store(-1, std::memory_order_relaxed);
+    }
+    for (int x = 0; x < count; x++) {
+        if (x != best) {
+            uint32_t bucket;
+            FindBridgeSlot(m_bridgeSlots[x].load(std::memory_order_relaxed)->startChannel, bucket);
+            m_bridgeSlotIndex[bucket].store(x, std::memory_order_release);
+        }
+    }
+    return best;
+}
+
+Sequence::BridgeSlot* Sequence::GetBridgeSlot(uint32_t startChannel, uint32_t len) {
+    uint32_t bucket;
+    int idx = FindBridgeSlot(startChannel, bucket);
+    if (idx >= 0) {
+        BridgeSlot* slot = m_bridgeSlots[idx].load(std::memory_order_acquire);
+        if (len <= slot->capacity) {
+            return slot;
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(m_bridgeSlotsLock);
+    idx = FindBridgeSlot(startChannel, bucket);
+    if (idx >= 0) {
+        BridgeSlot* slot = m_bridgeSlots[idx].load(std::memory_order_acquire);
+        if (len > slot->capacity) {
+            // a longer range at the same start, replace the slot but keep the
+            // old one around as another writer may be using it
+            RetireBridgeSlot(slot, GetTimeMS());
+            slot = new BridgeSlot(startChannel, len);
+            m_bridgeSlots[idx].store(slot, std::memory_order_release);
+            m_bridgeSlotsVersion.fetch_add(1, std::memory_order_release);
+        }
+        return slot;
+    }
+    int count = m_bridgeSlotCount.load(std::memory_order_relaxed);
+    if (count >= MAX_BRIDGE_SLOTS) {
+        idx = ReclaimBridgeSlot(GetTimeMS());
+        if (idx < 0) {
+            static bool warned = false;
+            if (!warned) {
+                LogWarn(VB_SEQUENCE, "Too many bridge ranges, ignoring data for channel %d\n", startChannel);
+                warned = true;
+            }
+            return nullptr;
+        }
+        FindBridgeSlot(startChannel, bucket);
+        BridgeSlot* slot = new BridgeSlot(startChannel, std::max(len, (uint32_t)512));
+        m_bridgeSlots[idx].store(slot, std::memory_order_release);
+        m_bridgeSlotIndex[bucket].store(idx, std::memory_order_release);
+        m_bridgeSlotsVersion.fetch_add(1, std::memory_order_release);
+        return slot;
+    }
+    BridgeSlot* slot = new BridgeSlot(startChannel, std::max(len, (uint32_t)512));
+    m_bridgeSlots[count].store(slot, std::memory_order_release);
+    m_bridgeSlotIndex[bucket].store(count, std::memory_order_release);
+    m_bridgeSlotCount.store(count + 1, std::memory_order_release);
+    m_bridgeSlotsVersion.fetch_add(1, std::memory_order_release);
+    return slot;
+}
+
+// copy the latest bridge data to the sequence data, overlapping ranges are
+// applied in the order they were written so the newest data wins
+void Sequence::MergeBridgeData() {
+    FPP_TRACE_SPAN("Sequence::MergeBridgeData");
+    uint32_t version = m_bridgeSlotsVersion.load(std::memory_order_acquire);
+    if (version != m_bridgeMergeVersion) {
+        int count = m_bridgeSlotCount.load(std::memory_order_acquire);
+        m_bridgeMergeOrder.resize(count);
+        for (int x = 0; x < count; x++) {
+            m_bridgeMergeOrder[x].second = m_bridgeSlots[x].load(std::memory_order_acquire);
+        }
+        m_bridgeMergeVersion = version;
+    }
+    for (auto& s : m_bridgeMergeOrder) {
+        s.first = s.second->WriteSeq();
+    }
+    // ranges tend to arrive in the same order every frame so last frame's
+    // order is nearly sorted already, an insertion sort is close to linear
+    for (size_t x = 1; x < m_bridgeMergeOrder.size(); x++) {
+        auto cur = m_bridgeMergeOrder[x];
+        size_t y = x;
+        while (y > 0 && m_bridgeMergeOrder[y - 1].first > cur.first) {
+            m_bridgeMergeOrder[y] = m_bridgeMergeOrder[y - 1];
+            --y;
+        }
+        m_bridgeMergeOrder[y] = cur;
+    }
+    uint64_t nt = GetTimeMS();
+    for (auto& s : m_bridgeMergeOrder) {
+        s.second->Read((uint8_t*)m_seqData, nt);
+    }
+}
+
+void Sequence::BridgeDataSet(uint64_t expireMS) {
+    uint64_t e = m_bridgeExpires.load(std::memory_order_relaxed);
+    while (expireMS > e && !m_bridgeExpires.compare_exchange_weak(e, expireMS)) {
+    }
+    setDataNotProcessed();
+}
+
 void Sequence::SetBridgeData(uint8_t* data, int startChannel, int len, uint64_t expireMS) {
     if (m_prioritize_sequence_over_bridge && this->IsSequenceRunning()) {
         return;
     }
+    if (startChannel < 0 || startChannel >= FPPD_MAX_CHANNELS || len <= 0) {
+        return;
+    }
+    len = std::min(len, FPPD_MAX_CHANNELS - startChannel);
 
-    if (!m_bridgeData) {
-        m_bridgeData = (uint8_t*)calloc(1, FPPD_MAX_CHANNEL_NUM);
+    BridgeSlot* slot = GetBridgeSlot(startChannel, len);
+    if (slot) {
+        slot->Write(data, len, expireMS, m_bridgeWriteSeq.fetch_add(1, std::memory_order_relaxed));
+        BridgeDataSet(expireMS);
     }
-    memcpy(&m_bridgeData[startChannel], data, len);
+}
 
-    std::unique_lock<std::mutex> lock(m_bridgeRangesLock);
-    auto& a = m_bridgeRanges[startChannel];
-    a.startChannel = startChannel;
-    a.expires[len] = expireMS;
-    lock.unlock();
+bool Sequence::SetBridgeSlot(uint8_t* data, int startChannel, int len, uint64_t expireMS) {
+    if (m_prioritize_sequence_over_bridge && this->IsSequenceRunning()) {
+        return false;
+    }
+    if (startChannel < 0 || startChannel >= FPPD_MAX_CHANNELS || len <= 0) {
+        return false;
+    }
+    len = std::min(len, FPPD_MAX_CHANNELS - startChannel);
 
-    setDataNotProcessed();
+    BridgeSlot* slot = GetBridgeSlot(startChannel, len);
+    if (!slot) {
+        return false;
+    }
+    slot->Publish(data, len, expireMS, m_bridgeWriteSeq.fetch_add(1, std::memory_order_relaxed));
+    BridgeDataSet(expireMS);
+    return true;
+}
+
+void Sequence::ClearBridgeSlots() {
+    int count = m_bridgeSlotCount.load(std::memory_order_acquire);
+    for (int x = 0; x < count; x++) {
+        m_bridgeSlots[x].load(std::memory_order_acquire)->Expire(true);
+    }
 }
 
 bool Sequence::hasBridgeData() {
-    std::unique_lock<std::mutex> lock(m_bridgeRangesLock);
-    return !m_bridgeRanges.empty();
+    return m_bridgeExpires.load(std::memory_order_relaxed) >= (uint64_t)GetTimeMS();
 }
@@ -19,6 +19,7 @@
 #include <list>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #include "fseq/FSEQFile.h"
 
@@ -31,6 +32,15 @@
 #define FPPD_WHITE_CHANNEL (FPPD_MAX_CHANNELS + 4)
 #define FPPD_MAX_CHANNEL_NUM (FPPD_WHITE_CHANNEL + 4)
 
+// distinct bridge start channels (universes, DDP ranges) that can be tracked
+#define MAX_BRIDGE_SLOTS 8192
+#define BRIDGE_SLOT_HASH_SIZE 16384
+// once all slots are used, a slot that expired this long ago (ms) can be
+// given to a new range
+#define BRIDGE_SLOT_RECLAIM_MS 5000
+// replaced slots are freed this long (ms) after nothing can find them
+#define BRIDGE_SLOT_RETIRE_MS 5000
+
 class Sequence {
 public:
     Sequence();
@@ -67,25 +77,84 @@ public:
     void BlankSequenceData(bool clearBridge = false);
 
     void SetBridgeData(uint8_t* data, int startChannel, int len, uint64_t expireMS);
+    // Zero copy version of SetBridgeData, the range is read straight from
+    // slot until another slot is set for it.  The output thread may still
+    // be reading a slot until two more slots have been set for the range.
+    // Returns false if the bridge data is being ignored and the slot wasn't
+    // taken.
+    bool SetBridgeSlot(uint8_t* slot, int startChannel, int len, uint64_t expireMS);
+    void ClearBridgeSlots();
 
 private:
     void SetLastFrameData(FSEQFile::FrameData* data);
     bool m_prioritize_sequence_over_bridge;
 
-    class BridgeRangeData {
+    // Bridge data is kept in a slot per start channel.  Each slot is double
+    // buffered and published with a generation counter (odd while a writer
+    // fills the back buffer) so the output thread reads a consistent copy
+    // of every range without taking a lock.  The lookup table is read
+    // without a lock, a miss falls back to looking again under
+    // m_bridgeSlotsLock, which is held while slots are added, replaced or
+    // reclaimed.  Every write takes a sequence number and overlapping
+    // ranges are applied oldest write first.
+    class BridgeSlot {
     public:
-        BridgeRangeData() :
-            startChannel(0) {}
-
-        uint32_t startChannel;
-        // map of len -> ms when it expires, in MOST cases, this will be a single len (like 512 for e1.31)
-        std::map<uint32_t, uint64_t> expires;
+        BridgeSlot(uint32_t start, uint32_t cap);
+        ~BridgeSlot();
+
+        void Write(uint8_t* data, uint32_t len, uint64_t expireMS, uint64_t seq);
+        void Publish(uint8_t* data, uint32_t len, uint64_t expireMS, uint64_t seq);
+        void Expire(bool release);
+        // copies the data into seqData, false if it has expired
+        bool Read(uint8_t* seqData, uint64_t now);
+
+        uint64_t WriteSeq() const { return writeSeq.load(std::memory_order_relaxed); }
+        uint64_t Expires() const { return expires.load(std::memory_order_relaxed); }
+
+        const uint32_t startChannel;
+        const uint32_t capacity;
+
+    private:
+        void Lock() {
+            while (writing.test_and_set(std::memory_order_acquire)) {
+            }
+        }
+        void Unlock() { writing.clear(std::memory_order_release); }
+
+        std::atomic_uint32_t generation{ 0 };
+        std::atomic<uint8_t*> buffers[2];
+        std::atomic_uint32_t lens[2];
+        std::atomic_uint64_t expires{ 0 };
+        std::atomic_uint64_t writeSeq{ 0 };
+        std::atomic_flag writing = ATOMIC_FLAG_INIT;
+        uint8_t* owned[2];
     };
-    std::map<uint64_t, BridgeRangeData> m_bridgeRanges;
-    std::mutex m_bridgeRangesLock;
-    uint8_t* m_bridgeData;
+    BridgeSlot* GetBridgeSlot(uint32_t startChannel, uint32_t len);
+    int FindBridgeSlot(uint32_t startChannel, uint32_t& bucket);
+    int ReclaimBridgeSlot(uint64_t now);
+    void RetireBridgeSlot(BridgeSlot* slot, uint64_t now);
+    void BridgeDataSet(uint64_t expireMS);
+    void MergeBridgeData();
+
+    std::atomic<BridgeSlot*> m_bridgeSlots[MAX_BRIDGE_SLOTS];
+    std::atomic_int m_bridgeSlotCount;
+    std::atomic_int m_bridgeSlotIndex[BRIDGE_SLOT_HASH_SIZE];
+    // held while adding, replacing or reclaiming slots
+    std::mutex m_bridgeSlotsLock;
+    // slots that were replaced and when, a writer or the output thread may
+    // still be using them for a moment
+    std::vector<std::pair<uint64_t, BridgeSlot*>> m_retiredBridgeSlots;
+    // bumped whenever a slot is added or replaced
+    std::atomic_uint32_t m_bridgeSlotsVersion;
+    std::atomic_uint64_t m_bridgeWriteSeq;
+    std::atomic_uint64_t m_bridgeExpires;
+    // output thread only, the slots in the order they were last written,
+    // kept between frames as the order rarely changes much
+    std::vector<std::pair<uint64_t, BridgeSlot*>> m_bridgeMergeOrder;
+    uint32_t m_bridgeMergeVersion;
 
     FSEQFile* m_seqFile;
+    uint32_t m_seqChannelCount;
 
     volatile int m_seqStarting;
     int m_seqPaused;
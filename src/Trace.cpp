@@ -0,0 +1,218 @@
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include "fpp-pch.h"
+
+#include <cinttypes>
+#include <unistd.h>
+
+#include "Trace.h"
+
+TraceManager TraceManager::INSTANCE;
+
+static thread_local uint32_t traceThreadId = 0;
+
+TraceManager::TraceManager() :
+    enabled(false),
+    writeIdx(0),
+    events(nullptr),
+    nextThreadId(1) {
+}
+TraceManager::~TraceManager() {
+    enabled = false;
+    if (events) {
+        delete[] events;
+    }
+}
+
+uint32_t TraceManager::GetThreadId() {
+    if (traceThreadId == 0) {
+        traceThreadId = nextThreadId.fetch_add(1);
+    }
+    return traceThreadId;
+}
+
+void TraceManager::Start() {
+    if (!events) {
+        std::unique_lock<std::mutex> lock(namesLock);
+        if (!events) {
+            events = new TraceEvent[RING_SIZE];
+            for (uint32_t x = 0; x < RING_SIZE; x++) {
+                events[x].seq = 0;
+            }
+        }
+    }
+    LogInfo(VB_GENERAL, "Starting trace capture\n");
+    enabled = true;
+}
+void TraceManager::Stop() {
+    LogInfo(VB_GENERAL, "Stopping trace capture (%u events recorded)\n", writeIdx.load());
+    enabled = false;
+}
+void TraceManager::Clear() {
+    if (events) {
+        for (uint32_t x = 0; x < RING_SIZE; x++) {
+            events[x].seq = 0;
+        }
+    }
+    writeIdx = 0;
+}
+
+void TraceManager::Record(const char* name, int64_t startUS, int64_t durUS, int64_t arg) {
+    if (!events) {
+        return;
+    }
+    uint32_t idx = writeIdx.fetch_add(1, std::memory_order_relaxed);
+    TraceEvent& ev = events[idx & (RING_SIZE - 1)];
+    // seq of 0 marks the slot as being written so readers will skip it
+    ev.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    ev.tid = GetThreadId();
+    ev.name = name;
+    ev.start = startUS;
+    ev.duration = durUS;
+    ev.arg = arg;
+    ev.seq.store(idx + 1, std::memory_order_release);
+}
+
+const char* TraceManager::InternName(const std::string& name) {
+    std::unique_lock<std::mutex> lock(namesLock);
+    // std::set never moves its nodes so the c_str stays valid
+    return names.insert(name).first->c_str();
+}
+
+void TraceManager::SetThreadName(const std::string& name) {
+    uint32_t tid = GetThreadId();
+    std::unique_lock<std::mutex> lock(namesLock);
+    threadNames[tid] = name;
+}
+
+static void AppendJSONString(std::string& out, const char* s) {
+    out += '"';
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            out += '\\';
+            out += *s;
+        } else if ((unsigned char)*s < 0x20) {
+            out += ' ';
+        } else {
+            out += *s;
+        }
+    }
+    out += '"';
+}
+
+std::string TraceManager::GetTraceJSON() {
+    std::string out;
+    out.reserve(128 * 1024);
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    int pid = getpid();
+    char buf[256];
+    bool first = true;
+    {
+        std::unique_lock<std::mutex> lock(namesLock);
+        for (auto& t : threadNames) {
+            snprintf(buf, sizeof(buf), "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":",
+                     first ? "" : ",", pid, t.first);
+            out += buf;
+            AppendJSONString(out, t.second.c_str());
+            out += "}}";
+            first = false;
+        }
+    }
+
+    if (events) {
+        uint32_t end = writeIdx.load(std::memory_order_acquire);
+        uint32_t begin = end > RING_SIZE ? end - RING_SIZE : 0;
+        for (uint32_t idx = begin; idx != end; idx++) {
+            TraceEvent& ev = events[idx & (RING_SIZE - 1)];
+            uint32_t seq = ev.seq.load(std::memory_order_acquire);
+            if (seq != idx + 1) {
+                continue;
+            }
+            uint32_t tid = ev.tid;
+            const char* name = ev.name;
+            int64_t start = ev.start;
+            int64_t duration = ev.duration;
+            int64_t arg = ev.arg;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (ev.seq.load(std::memory_order_relaxed) != seq || name == nullptr) {
+                // overwritten while we were reading it
+                continue;
+            }
+            snprintf(buf, sizeof(buf), "%s{\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%" PRId64 ",\"dur\":%" PRId64 ",\"name\":",
+                     first ? "" : ",", pid, tid, start, duration);
+            out += buf;
+            AppendJSONString(out, name);
+            if (arg >= 0) {
+                snprintf(buf, sizeof(buf), ",\"args\":{\"v\":%" PRId64 "}", arg);
+                out += buf;
+            }
+            out += "}";
+            first = false;
+        }
+    }
+    out += "]}\n";
+    return out;
+}
+
+bool TraceManager::DumpToFile(const std::string& filename) {
+    bool wasEnabled = IsEnabled();
+    enabled = false;
+    std::string json = GetTraceJSON();
+    enabled = wasEnabled;
+    if (!PutFileContents(filename, json)) {
+        LogErr(VB_GENERAL, "Could not write trace data to %s\n", filename.c_str());
+        return false;
+    }
+    LogInfo(VB_GENERAL, "Wrote trace data to %s\n", filename.c_str());
+    return true;
+}
+
+class TraceCaptureCommand : public Command {
+public:
+    TraceCaptureCommand() :
+        Command("Trace Capture", "Start/Stop capture of playback pipeline timing traces.  Dump writes Chrome trace-event JSON to the logs directory.") {
+        args.push_back(CommandArg("Action", "string", "Action").setContentList({ "Start", "Stop", "Clear", "Dump" }).setDefaultValue("Start"));
+    }
+    virtual ~TraceCaptureCommand() {}
+
+    virtual std::unique_ptr<Command::Result> run(const std::vector<std::string>& args) override {
+        std::string action = args.empty() ? "Start" : args[0];
+        if (action == "Start") {
+            TraceManager::INSTANCE.Start();
+        } else if (action == "Stop") {
+            TraceManager::INSTANCE.Stop();
+        } else if (action == "Clear") {
+            TraceManager::INSTANCE.Clear();
+        } else if (action == "Dump") {
+            char fname[64];
+            time_t t = time(nullptr);
+            struct tm tm;
+            localtime_r(&t, &tm);
+            strftime(fname, sizeof(fname), "/logs/fppd-trace-%Y%m%d-%H%M%S.json", &tm);
+            std::string filename = FPP_DIR_MEDIA(fname);
+            if (!TraceManager::INSTANCE.DumpToFile(filename)) {
+                return std::make_unique<Command::ErrorResult>("Could not write " + filename);
+            }
+            return std::make_unique<Command::Result>(filename);
+        } else {
+            return std::make_unique<Command::ErrorResult>("Invalid Action: " + action);
+        }
+        return std::make_unique<Command::Result>("Trace Capture " + action);
+    }
+};
+
+void TraceManager::Initialize() {
+    CommandManager::INSTANCE.addCommand(new TraceCaptureCommand());
+}
@@ -0,0 +1,106 @@
+#pragma once
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+
+/*
+ * Lightweight span tracer for the playback pipeline.  Spans are recorded
+ * into a fixed size ring buffer and can be dumped in the Chrome trace-event
+ * JSON format (loadable in chrome://tracing or ui.perfetto.dev).  When
+ * tracing is disabled, recording a span costs a single relaxed atomic load.
+ */
+class TraceManager {
+public:
+    static TraceManager INSTANCE;
+
+    static constexpr uint32_t RING_SIZE = 65536; // must be a power of 2
+
+    TraceManager();
+    ~TraceManager();
+
+    void Initialize();
+
+    bool IsEnabled() const { return enabled.load(std::memory_order_relaxed); }
+    void Start();
+    void Stop();
+    void Clear();
+
+    // name must remain valid for the life of the process, use InternName
+    // for dynamically built names
+    void Record(const char* name, int64_t startUS, int64_t durUS, int64_t arg = -1);
+    const char* InternName(const std::string& name);
+
+    // names the calling thread in the trace output
+    void SetThreadName(const std::string& name);
+
+    std::string GetTraceJSON();
+    bool DumpToFile(const std::string& filename);
+
+    static int64_t Now() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    class TraceEvent {
+    public:
+        std::atomic<uint32_t> seq;
+        uint32_t tid;
+        const char* name;
+        int64_t start;
+        int64_t duration;
+        int64_t arg;
+    };
+
+    uint32_t GetThreadId();
+
+    std::atomic_bool enabled;
+    std::atomic<uint32_t> writeIdx;
+    TraceEvent* events;
+
+    std::mutex namesLock;
+    std::set<std::string> names;
+    std::map<uint32_t, std::string> threadNames;
+    std::atomic<uint32_t> nextThreadId;
+};
+
+class TraceSpan {
+public:
+    TraceSpan(const char* n, int64_t a = -1) :
+        name(n),
+        arg(a),
+        start(TraceManager::INSTANCE.IsEnabled() ? TraceManager::Now() : 0) {}
+    ~TraceSpan() {
+        if (start && TraceManager::INSTANCE.IsEnabled()) {
+            TraceManager::INSTANCE.Record(name, start, TraceManager::Now() - start, arg);
+        }
+    }
+    void setArg(int64_t a) { arg = a; }
+
+    TraceSpan(TraceSpan const&) = delete;
+    void operator=(TraceSpan const& x) = delete;
+
+private:
+    const char* name;
+    int64_t arg;
+    int64_t start;
+};
+
+#define FPP_TRACE_CONCAT2(a, b) a##b
+#define FPP_TRACE_CONCAT(a, b) FPP_TRACE_CONCAT2(a, b)
+#define FPP_TRACE_SPAN(name) TraceSpan FPP_TRACE_CONCAT(_traceSpan, __LINE__)(name)
+#define FPP_TRACE_SPAN_ARG(name, arg) TraceSpan FPP_TRACE_CONCAT(_traceSpan, __LINE__)(name, arg)
@@ -13,6 +13,7 @@
 #include "fpp-pch.h"
 
 #include <arpa/inet.h>
+#include <ifaddrs.h>
 #include <net/if.h>
 #include <netinet/in.h>
 #include <sys/ioctl.h>
@@ -72,13 +73,62 @@ const char ArtNetSyncPacket[] = {
 };
 
 static struct iovec ArtNetSyncIovecs = { (void*)ArtNetSyncPacket, ARTNET_SYNC_PACKET_LENGTH };
-static struct sockaddr_in ArtNetSyncAddress;
+static std::vector<struct sockaddr_in> ArtNetSyncAddresses;
+
+// directed broadcast address of an interface, false if it doesn't exist
+// or has no IPv4 address
+static bool GetInterfaceBroadcast(const std::string& name, struct in_addr& result) {
+    struct ifaddrs* interfaces = nullptr;
+    if (getifaddrs(&interfaces)) {
+        return false;
+    }
+    bool found = false;
+    for (struct ifaddrs* i = interfaces; i && !found; i = i->ifa_next) {
+        if (!i->ifa_addr || i->ifa_addr->sa_family != AF_INET || name != i->ifa_name) {
+            continue;
+        }
+        in_addr_t ip = ((struct sockaddr_in*)i->ifa_addr)->sin_addr.s_addr;
+        in_addr_t mask = i->ifa_netmask ? ((struct sockaddr_in*)i->ifa_netmask)->sin_addr.s_addr : 0xFFFFFFFF;
+        result.s_addr = ip | ~mask;
+        found = true;
+    }
+    freeifaddrs(interfaces);
+    return found;
+}
+
+void ArtNetOutputData::SetSyncTargets(const std::string& targets) {
+    ArtNetSyncAddresses.clear();
+    std::vector<std::string> items = split(targets.empty() ? std::string("255.255.255.255") : targets, ',');
+    for (auto& item : items) {
+        TrimWhiteSpace(item);
+        if (item.empty()) {
+            continue;
+        }
+        struct sockaddr_in addr;
+        memset((char*)&addr, 0, sizeof(sockaddr_in));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(ARTNET_DEST_PORT);
+        if (inet_pton(AF_INET, item.c_str(), &addr.sin_addr) != 1 && !GetInterfaceBroadcast(item, addr.sin_addr)) {
+            LogWarn(VB_CHANNELOUT, "Invalid ArtSync target '%s', not an IPv4 address or an interface with an IPv4 address\n", item.c_str());
+            continue;
+        }
+        ArtNetSyncAddresses.push_back(addr);
+    }
+    if (ArtNetSyncAddresses.empty()) {
+        LogWarn(VB_CHANNELOUT, "No valid ArtSync targets in '%s', ArtSync will not be sent\n", targets.c_str());
+    }
+}
 
 static const std::string ARTNETTYPE = "ArtNet";
 
 const std::string& ArtNetOutputData::GetOutputTypeString() const {
     return ARTNETTYPE;
 }
+void ArtNetOutputData::GetStats(Json::Value& result) {
+    UDPOutputData::GetStats(result);
+    result["universe"] = universe;
+    result["universeCount"] = universeCount;
+}
 
 ArtNetOutputData::ArtNetOutputData(const Json::Value& config) :
     UDPOutputData(config),
@@ -88,10 +138,9 @@ ArtNetOutputData::ArtNetOutputData(const Json::Value& config) :
     anAddress.sin_family = AF_INET;
     anAddress.sin_port = htons(ARTNET_DEST_PORT);
 
-    memset((char*)&ArtNetSyncAddress, 0, sizeof(sockaddr_in));
-    ArtNetSyncAddress.sin_family = AF_INET;
-    ArtNetSyncAddress.sin_port = htons(ARTNET_DEST_PORT);
-    ArtNetSyncAddress.sin_addr.s_addr = inet_addr("255.255.255.255");
+    if (ArtNetSyncAddresses.empty()) {
+        SetSyncTargets("");
+    }
 
     universe = config["id"].asInt();
     priority = config["priority"].asInt();
@@ -164,7 +213,7 @@ void ArtNetOutputData::PrepareData(unsigned char* channelData, UDPOutputMessages
         //as per the ArtNet protocol
         if (messages.GetSocket(ARTNET_DEST_PORT) == -1) {
             // we MAY be bridging ArtNet so we need to use that same socket
-            messages.ForceSocket(ARTNET_DEST_PORT, CreateArtNetSocket());
+            messages.ForceSocket(ARTNET_DEST_PORT, CreateArtNetSocket(), false);
         }
 
         unsigned char* cur = channelData + startChannel - 1;
@@ -207,22 +256,26 @@ void ArtNetOutputData::PrepareData(unsigned char* channelData, UDPOutputMessages
 }
 void ArtNetOutputData::PostPrepareData(unsigned char* channelData, UDPOutputMessages& msgs) {
     if (valid && active) {
-        for (auto msg : msgs[ARTNET_DEST_PORT]) {
-            if (msg.msg_hdr.msg_iov == &ArtNetSyncIovecs) {
-                //already added, skip
-                return;
-            }
+        std::vector<struct mmsghdr>& late = msgs[LATE_ARTNET_MESSAGES_KEY];
+        if (!late.empty()) {
+            //already added, skip
+            return;
+        }
+        // sent after the data, but also needs the ArtNet source port
+        if (msgs.GetSocket(LATE_ARTNET_MESSAGES_KEY) == -1) {
+            msgs.ForceSocket(LATE_ARTNET_MESSAGES_KEY, CreateArtNetSocket(), false);
+        }
+        for (auto& addr : ArtNetSyncAddresses) {
+            struct mmsghdr msg;
+            memset(&msg, 0, sizeof(msg));
+
+            msg.msg_hdr.msg_name = &addr;
+            msg.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            msg.msg_hdr.msg_iov = &ArtNetSyncIovecs;
+            msg.msg_hdr.msg_iovlen = 1;
+            msg.msg_len = ARTNET_SYNC_PACKET_LENGTH;
+            late.push_back(msg);
         }
-
-        struct mmsghdr msg;
-        memset(&msg, 0, sizeof(msg));
-
-        msg.msg_hdr.msg_name = &ArtNetSyncAddress;
-        msg.msg_hdr.msg_namelen = sizeof(sockaddr_in);
-        msg.msg_hdr.msg_iov = &ArtNetSyncIovecs;
-        msg.msg_hdr.msg_iovlen = 1;
-        msg.msg_len = ARTNET_SYNC_PACKET_LENGTH;
-        msgs[ARTNET_DEST_PORT].push_back(msg);
     }
 }
 
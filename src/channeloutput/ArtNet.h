@@ -33,12 +33,18 @@ public:
     virtual void GetRequiredChannelRange(int& min, int& max) override;
 
     virtual const std::string& GetOutputTypeString() const override;
+    virtual void GetStats(Json::Value& result) override;
 
     int universe;
     int universeCount;
     int priority;
     char sequenceNumber;
 
+    // where ArtSync is sent, comma separated list of IPs (unicast or
+    // broadcast) and/or interface names (that interface's broadcast
+    // address), 255.255.255.255 if empty
+    static void SetSyncTargets(const std::string& targets);
+
     sockaddr_in anAddress;
 
     std::vector<struct iovec> anIovecs;
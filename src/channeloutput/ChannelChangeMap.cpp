@@ -0,0 +1,139 @@
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include "fpp-pch.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "ChannelChangeMap.h"
+
+ChannelChangeMap::ChannelChangeMap() :
+    blockCount(0),
+    blockGenerations(nullptr),
+    lastFrame(nullptr),
+    generation(0),
+    dirtyBlocks(0) {
+}
+ChannelChangeMap::~ChannelChangeMap() {
+    if (blockGenerations) {
+        free(blockGenerations);
+    }
+    if (lastFrame) {
+        free(lastFrame);
+    }
+}
+
+void ChannelChangeMap::Init(const std::vector<std::pair<uint32_t, uint32_t>>& ranges) {
+    if (blockGenerations) {
+        free(blockGenerations);
+        blockGenerations = nullptr;
+    }
+    if (lastFrame) {
+        free(lastFrame);
+        lastFrame = nullptr;
+    }
+    blockRanges.clear();
+    generation = 0;
+    dirtyBlocks = 0;
+
+    uint32_t maxBlock = 0;
+    for (auto& r : ranges) {
+        uint32_t b = r.first / BLOCK_SIZE;
+        uint32_t e = (r.first + r.second + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        if (e > (FPPD_MAX_CHANNELS / BLOCK_SIZE)) {
+            e = FPPD_MAX_CHANNELS / BLOCK_SIZE;
+        }
+        if (b < e) {
+            blockRanges.push_back(std::pair<uint32_t, uint32_t>(b, e));
+            maxBlock = std::max(maxBlock, e);
+        }
+    }
+    blockCount = maxBlock;
+    if (blockCount) {
+        blockGenerations = (uint32_t*)calloc(blockCount, sizeof(uint32_t));
+        lastFrame = (unsigned char*)aligned_alloc(BLOCK_SIZE, blockCount * BLOCK_SIZE);
+        memset(lastFrame, 0, blockCount * BLOCK_SIZE);
+    }
+}
+
+// compares a block against the previous frame, copying it if changed
+static inline bool UpdateBlock(const unsigned char* cur, unsigned char* last) {
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    uint8x16_t c0 = vld1q_u8(cur);
+    uint8x16_t c1 = vld1q_u8(cur + 16);
+    uint8x16_t c2 = vld1q_u8(cur + 32);
+    uint8x16_t c3 = vld1q_u8(cur + 48);
+    uint8x16_t d = vorrq_u8(vorrq_u8(veorq_u8(c0, vld1q_u8(last)), veorq_u8(c1, vld1q_u8(last + 16))),
+                            vorrq_u8(veorq_u8(c2, vld1q_u8(last + 32)), veorq_u8(c3, vld1q_u8(last + 48))));
+    uint64x2_t d64 = vreinterpretq_u64_u8(d);
+    if ((vgetq_lane_u64(d64, 0) | vgetq_lane_u64(d64, 1)) == 0) {
+        return false;
+    }
+    vst1q_u8(last, c0);
+    vst1q_u8(last + 16, c1);
+    vst1q_u8(last + 32, c2);
+    vst1q_u8(last + 48, c3);
+    return true;
+#elif defined(__SSE2__)
+    __m128i c0 = _mm_loadu_si128((const __m128i*)cur);
+    __m128i c1 = _mm_loadu_si128((const __m128i*)(cur + 16));
+    __m128i c2 = _mm_loadu_si128((const __m128i*)(cur + 32));
+    __m128i c3 = _mm_loadu_si128((const __m128i*)(cur + 48));
+    __m128i e = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(c0, _mm_load_si128((const __m128i*)last)),
+                                            _mm_cmpeq_epi8(c1, _mm_load_si128((const __m128i*)(last + 16)))),
+                              _mm_and_si128(_mm_cmpeq_epi8(c2, _mm_load_si128((const __m128i*)(last + 32))),
+                                            _mm_cmpeq_epi8(c3, _mm_load_si128((const __m128i*)(last + 48)))));
+    if (_mm_movemask_epi8(e) == 0xFFFF) {
+        return false;
+    }
+    _mm_store_si128((__m128i*)last, c0);
+    _mm_store_si128((__m128i*)(last + 16), c1);
+    _mm_store_si128((__m128i*)(last + 32), c2);
+    _mm_store_si128((__m128i*)(last + 48), c3);
+    return true;
+#else
+    if (memcmp(cur, last, ChannelChangeMap::BLOCK_SIZE) == 0) {
+        return false;
+    }
+    memcpy(last, cur, ChannelChangeMap::BLOCK_SIZE);
+    return true;
+#endif
+}
+
+void ChannelChangeMap::Update(const unsigned char* channelData) {
+    if (!blockCount) {
+        return;
+    }
+    ++generation;
+    uint32_t dirty = 0;
+    for (auto& r : blockRanges) {
+        for (uint32_t b = r.first; b < r.second; b++) {
+            uint32_t off = b * BLOCK_SIZE;
+            if (UpdateBlock(channelData + off, lastFrame + off)) {
+                blockGenerations[b] = generation;
+                ++dirty;
+            }
+        }
+    }
+    if (generation == 1) {
+        // everything is new on the first frame
+        for (uint32_t b = 0; b < blockCount; b++) {
+            blockGenerations[b] = generation;
+        }
+        dirty = blockCount;
+    }
+    dirtyBlocks = dirty;
+}
@@ -0,0 +1,72 @@
+#pragma once
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+/*
+ * Tracks which blocks of channels changed from frame to frame.  The map
+ * is updated once per frame (after the output processors have run) by
+ * comparing the channel data against a copy of the previous frame.  Each
+ * block records the generation it last changed in so outputs that don't
+ * send every frame can ask if anything changed since the generation they
+ * last sent.
+ */
+class ChannelChangeMap {
+public:
+    static constexpr uint32_t BLOCK_SIZE = 64;
+
+    ChannelChangeMap();
+    ~ChannelChangeMap();
+
+    void Init(const std::vector<std::pair<uint32_t, uint32_t>>& ranges);
+    void Update(const unsigned char* channelData);
+
+    // generation of the current frame, 0 if the map has never been updated
+    uint32_t Generation() const { return generation; }
+
+    // did anything in the range change in the current frame
+    bool IsDirty(uint32_t startChannel, uint32_t count) const {
+        return ChangedSince(startChannel, count, generation - 1);
+    }
+
+    // did anything in the range change after the given generation
+    bool ChangedSince(uint32_t startChannel, uint32_t count, uint32_t gen) const {
+        if (count == 0) {
+            return false;
+        }
+        uint32_t b = startChannel / BLOCK_SIZE;
+        uint32_t e = (startChannel + count - 1) / BLOCK_SIZE;
+        if (e >= blockCount) {
+            // not something we track
+            return true;
+        }
+        for (; b <= e; b++) {
+            if (blockGenerations[b] > gen) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint32_t DirtyBlocks() const { return dirtyBlocks; }
+
+private:
+    std::vector<std::pair<uint32_t, uint32_t>> blockRanges;
+    uint32_t blockCount;
+    uint32_t* blockGenerations;
+    unsigned char* lastFrame;
+    uint32_t generation;
+    uint32_t dirtyBlocks;
+};
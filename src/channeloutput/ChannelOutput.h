@@ -15,6 +15,8 @@
 #include <string>
 #include <vector>
 
+class ChannelChangeMap;
+
 class ChannelOutput {
 public:
     ChannelOutput(unsigned int startChannel = 1,
@@ -34,6 +36,13 @@ public:
     virtual void PrepData(unsigned char* channelData) {}
     virtual int SendData(unsigned char* channelData) = 0;
 
+    // Optional versions of PrepData/SendData that also get the map of which
+    // channels (0 based, absolute channel numbers) have changed.  Outputs
+    // that can skip unchanged universes/strings/rows can override these
+    // instead of comparing the data themselves.
+    virtual void PrepDataWithChanges(unsigned char* channelData, const ChannelChangeMap& changes) { PrepData(channelData); }
+    virtual int SendDataWithChanges(unsigned char* channelData, const ChannelChangeMap& changes) { return SendData(channelData); }
+
     virtual void GetRequiredChannelRanges(const std::function<void(int, int)>& addRange) = 0;
 
     // Some outputs may need to know ahead of time that they are about to start or stop outputting
@@ -48,6 +57,15 @@ public:
     virtual void OverlayTestData(unsigned char* channelData, int cycleNum, int testType) {}
     virtual bool SupportsTesting() const { return  false; }
 
+    // Outputs that are not time critical (virtual displays, etc...) can be
+    // skipped for a frame when the output thread is running behind.
+    virtual bool IsOptionalOutput() const { return false; }
+
+    // Outputs that keep send statistics can report (and reset) them for
+    // the fppd/outputStats API
+    virtual void GetStats(Json::Value& stats) {}
+    virtual void ResetStats() {}
+
 protected:
     virtual void DumpConfig(void);
     virtual void ConvertToCSV(Json::Value config, char* configStr);
@@ -24,13 +24,16 @@
 #include <sstream>
 #include <string>
 
+#include "ChannelChangeMap.h"
 #include "ChannelOutput.h"
 #include "ChannelOutputSetup.h"
 #include "Sequence.h"
+#include "channeloutputthread.h"
 #include "Warnings.h"
 #include "common.h"
 #include "log.h"
 #include "settings.h"
+#include "../Trace.h"
 #include "../Plugin.h"
 #include "../Plugins.h"
 #include "../config.h"
@@ -49,6 +52,7 @@ std::vector<FPPChannelOutputInstance> channelOutputs;
 static int LoadOutputProcessors(void);
 
 OutputProcessors outputProcessors;
+static ChannelChangeMap channelChanges;
 
 static std::vector<std::pair<uint32_t, uint32_t>> outputRanges;
 static std::vector<std::pair<uint32_t, uint32_t>> preciseOutputRanges;
@@ -226,6 +230,7 @@ int InitializeChannelOutputs(void) {
         FPPChannelOutputInstance inst;
         inst.startChannel = getSettingInt("FPDStartChannelOffset");
         inst.outputOld = &FPDOutput;
+        inst.traceSendName = "FPD::send";
 
         if (FPDOutput.open("", &inst.privData)) {
             inst.channelCount = inst.outputOld->maxChannels(inst.privData);
@@ -295,6 +300,13 @@ int InitializeChannelOutputs(void) {
 
                 channelOutput.startChannel = start;
                 channelOutput.channelCount = count;
+                if (outputs[c].isMember("frameDivider") && outputs[c]["frameDivider"].asInt() > 1) {
+                    channelOutput.frameDivider = outputs[c]["frameDivider"].asInt();
+                    LogInfo(VB_CHANNELOUT, "%s:  Sending every %d frames\n", type.c_str(), channelOutput.frameDivider);
+                } else if (outputs[c].isMember("refreshRate") && outputs[c]["refreshRate"].asFloat() > 0.0f) {
+                    channelOutput.refreshRate = outputs[c]["refreshRate"].asFloat();
+                    LogInfo(VB_CHANNELOUT, "%s:  Sending at a fixed %.2f Hz\n", type.c_str(), channelOutput.refreshRate);
+                }
                 std::string libnamePfx = "";
 
                 // First some Channel Outputs enabled everythwere
@@ -318,6 +330,8 @@ int InitializeChannelOutputs(void) {
                                     type.c_str(), m1, m2);
                             addRange(m1, m2);
                         });
+                        channelOutput.tracePrepName = TraceManager::INSTANCE.InternName(type + "::PrepData");
+                        channelOutput.traceSendName = TraceManager::INSTANCE.InternName(type + "::SendData");
                         channelOutputs.push_back(channelOutput);
                     } else {
                         WarningHolder::AddWarning("Could not initialize output type " + type + ". Check logs for details.");
@@ -347,6 +361,7 @@ int InitializeChannelOutputs(void) {
     }
     sortRanges(outputRanges, false);
     sortRanges(preciseOutputRanges, true);
+    channelChanges.Init(outputRanges);
     for (auto& r : preciseOutputRanges) {
         LogInfo(VB_CHANNELOUT, "Determined range needed %d - %d\n", r.first, r.first + r.second - 1);
     }
@@ -354,6 +369,32 @@ int InitializeChannelOutputs(void) {
     return 1;
 }
 
+/*
+ * Collect the statistics from the outputs that keep them
+ */
+void GetChannelOutputStats(Json::Value& result) {
+    result["outputs"] = Json::Value(Json::arrayValue);
+    for (auto& inst : channelOutputs) {
+        if (inst.output) {
+            Json::Value stats;
+            inst.output->GetStats(stats);
+            if (!stats.empty()) {
+                stats["type"] = inst.output->GetOutputType();
+                stats["startChannel"] = inst.startChannel + 1;
+                stats["channelCount"] = inst.channelCount;
+                result["outputs"].append(stats);
+            }
+        }
+    }
+}
+void ResetChannelOutputStats() {
+    for (auto& inst : channelOutputs) {
+        if (inst.output) {
+            inst.output->ResetStats();
+        }
+    }
+}
+
 /*
  * Set the channel output frame counter to a specific value
  */
@@ -386,11 +427,54 @@ std::set<std::string> GetOutputTypes() {
     }
     return ret;
 }
+
+/*
+ * Determine if the output should be sent the current frame.  The cadence
+ * is based on the frame number so it is stable across seeks and multiple
+ * calls for the same frame and matches on all remotes.
+ */
+static inline bool OutputIsDue(const FPPChannelOutputInstance& inst, unsigned long frame, float seqRate) {
+    if (frame == 0) {
+        return true;
+    }
+    if (inst.frameDivider > 1) {
+        return (frame % inst.frameDivider) == 0;
+    }
+    if ((inst.refreshRate > 0.0f) && (inst.refreshRate < seqRate)) {
+        double ratio = inst.refreshRate / seqRate;
+        return (uint64_t)(frame * ratio) != (uint64_t)((frame - 1) * ratio);
+    }
+    return true;
+}
+
 int PrepareChannelData(char* channelData) {
-    outputProcessors.ProcessData((unsigned char*)channelData);
+    FPP_TRACE_SPAN("PrepareChannelData");
+    {
+        FPP_TRACE_SPAN("OutputProcessors::ProcessData");
+        outputProcessors.ProcessData((unsigned char*)channelData);
+    }
+    {
+        FPP_TRACE_SPAN("ChannelChangeMap::Update");
+        channelChanges.Update((unsigned char*)channelData);
+    }
+    // the cadence only applies while a sequence is playing, everything
+    // else (bridging, blanking, etc...) is sent to all outputs
+    bool allDue = !sequence->IsSequenceRunning();
+    float seqRate = GetChannelOutputRefreshRate();
+    bool skipOptional = false;
+    bool checkedOptional = false;
     for (auto& inst : channelOutputs) {
-        if (inst.output) {
-            inst.output->PrepData((unsigned char*)channelData);
+        inst.sendDue = allDue || OutputIsDue(inst, channelOutputFrame, seqRate);
+        if (inst.sendDue && inst.output && inst.output->IsOptionalOutput()) {
+            if (!checkedOptional) {
+                skipOptional = SkipOptionalFrameStage(OptionalFrameStage::OptionalOutputs);
+                checkedOptional = true;
+            }
+            inst.sendDue = !skipOptional;
+        }
+        if (inst.output && inst.sendDue) {
+            FPP_TRACE_SPAN(inst.tracePrepName);
+            inst.output->PrepDataWithChanges((unsigned char*)channelData, channelChanges);
         }
     }
     return 0;
@@ -410,14 +494,19 @@ int SendChannelData(const char* channelData) {
         HexDump(buf, &channelData[minimumNeededChannel], 16, VB_CHANNELDATA);
     }
 
+    FPP_TRACE_SPAN_ARG("SendChannelData", channelOutputFrame);
     for (auto& inst : channelOutputs) {
+        if (!inst.sendDue) {
+            continue;
+        }
+        FPP_TRACE_SPAN(inst.traceSendName);
         if (inst.outputOld) {
             inst.outputOld->send(
                 inst.privData,
                 channelData + inst.startChannel,
                 inst.channelCount < (FPPD_MAX_CHANNELS - inst.startChannel) ? inst.channelCount : (FPPD_MAX_CHANNELS - inst.startChannel));
         } else if (inst.output) {
-            inst.output->SendData((unsigned char*)(channelData + inst.startChannel));
+            inst.output->SendDataWithChanges((unsigned char*)(channelData + inst.startChannel), channelChanges);
         }
     }
 
@@ -501,3 +590,35 @@ int LoadOutputProcessors(void) {
 
     return 1;
 }
+
+/*
+ * Reload the output processors while running.  The new set is swapped in
+ * without stopping the output.  Returns 0 if the new processors need
+ * channels the outputs aren't reading in which case fppd needs a restart.
+ */
+int ReloadOutputProcessors(void) {
+    LogInfo(VB_CHANNELOUT, "Reloading Output Processors.\n");
+    if (!FileExists(FPP_DIR_CONFIG("/outputprocessors.json"))) {
+        outputProcessors.loadFromJSON(Json::Value());
+        return 1;
+    }
+    if (!LoadOutputProcessors()) {
+        return 0;
+    }
+
+    bool covered = true;
+    outputProcessors.GetRequiredChannelRanges([&covered](int m1, int m2) {
+        bool found = false;
+        for (auto& r : outputRanges) {
+            if ((uint32_t)m1 >= r.first && (uint32_t)m2 < (r.first + r.second)) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            LogWarn(VB_CHANNELOUT, "OutputProcessor:  Range %d - %d is not in the current output ranges\n", m1, m2);
+            covered = false;
+        }
+    });
+    return covered ? 1 : 0;
+}
@@ -41,6 +41,18 @@ public:
     FPPChannelOutput* outputOld = nullptr;
     ChannelOutput* output = nullptr;
     void* privData = nullptr;
+
+    // Output cadence.  Outputs that can't keep up with the sequence step
+    // rate can be sent every Nth frame (frameDivider) or at a fixed rate in
+    // Hz (refreshRate) in which case the newest frame is latched and sent
+    // whenever the output is due.
+    int frameDivider = 1;
+    float refreshRate = 0.0f;
+    bool sendDue = true;
+
+    // interned span names for the trace capture
+    const char* tracePrepName = "PrepData";
+    const char* traceSendName = "SendData";
 };
 
 extern char channelData[];
@@ -55,6 +67,10 @@ int SendChannelData(const char* channelData);
 void OverlayOutputTestData(std::set<std::string> types, unsigned char *channelData, int cycleCnt, int testType);
 std::set<std::string> GetOutputTypes();
 void CloseChannelOutputs(void);
+int ReloadOutputProcessors(void);
+
+void GetChannelOutputStats(Json::Value& result);
+void ResetChannelOutputStats();
 void SetChannelOutputFrameNumber(int frameNumber);
 void ResetChannelOutputFrameNumber(void);
 
@@ -106,11 +106,28 @@
 #define DDP_ID_CONFIG 250
 #define DDP_ID_STATUS 251
 
-//1440 channels per packet
+//1440 channels per packet on a standard 1500 byte MTU
 #define DDP_CHANNELS_PER_PACKET 1440
 
 #define DDP_PACKET_LEN (DDP_HEADER_LEN + DDP_CHANNELS_PER_PACKET)
 
+// IP + UDP headers
+#define DDP_IP_OVERHEAD 28
+#define DDP_MIN_MTU 576
+#define DDP_MAX_MTU 9216
+
+// channels per packet that fit in the given MTU, kept a multiple of 3 so
+// pixels aren't split across packets.  Anything up to a standard 1500 MTU
+// uses the normal 1440 so existing controllers see the same packets.
+static int DDPPayloadForMTU(int mtu) {
+    mtu = std::clamp(mtu, DDP_MIN_MTU, DDP_MAX_MTU);
+    int payload = ((mtu - DDP_IP_OVERHEAD - DDP_HEADER_LEN) / 3) * 3;
+    if (mtu <= 1500) {
+        payload = std::min(payload, DDP_CHANNELS_PER_PACKET);
+    }
+    return payload;
+}
+
 static const std::string DDPTYPE = "DDP";
 
 const std::string& DDPOutputData::GetOutputTypeString() const {
@@ -119,7 +136,11 @@ const std::string& DDPOutputData::GetOutputTypeString() const {
 
 DDPOutputData::DDPOutputData(const Json::Value& config) :
     UDPOutputData(config),
-    sequenceNumber(1) {
+    sequenceNumber(1),
+    pktCount(0),
+    mtu(0),
+    payload(0),
+    wantedPayload(0) {
     memset((char*)&ddpAddress, 0, sizeof(sockaddr_in));
     ddpAddress.sin_family = AF_INET;
     ddpAddress.sin_port = htons(DDP_PORT);
@@ -130,8 +151,42 @@ DDPOutputData::DDPOutputData(const Json::Value& config) :
         active = false;
     }
 
-    pktCount = channelCount / DDP_CHANNELS_PER_PACKET;
-    if (channelCount % DDP_CHANNELS_PER_PACKET) {
+    if (config.isMember("mtu")) {
+        // 0 (default) keeps the standard 1440 channel packets, -1 or "auto"
+        // follows the MTU of the route to the controller.  Auto is opt in as
+        // a jumbo frame path doesn't mean the controller can take them.
+        if (config["mtu"].isString()) {
+            mtu = config["mtu"].asString() == "auto" ? -1 : std::atoi(config["mtu"].asString().c_str());
+        } else {
+            mtu = config["mtu"].asInt();
+        }
+    }
+    BuildPackets(mtu > 0 ? DDPPayloadForMTU(mtu) : DDP_CHANNELS_PER_PACKET);
+    wantedPayload = payload;
+}
+DDPOutputData::~DDPOutputData() {
+    FreePackets();
+}
+
+void DDPOutputData::FreePackets() {
+    for (int x = 0; x < pktCount; x++) {
+        free(ddpBuffers[x]);
+    }
+    free(ddpBuffers);
+    free(ddpIovecs);
+    ddpBuffers = nullptr;
+    ddpIovecs = nullptr;
+    ddpMessages.clear();
+    pktCount = 0;
+}
+
+void DDPOutputData::BuildPackets(int pl) {
+    FreePackets();
+    payload = pl;
+    planChannelData = nullptr;
+
+    pktCount = channelCount / payload;
+    if (channelCount % payload) {
         pktCount++;
     }
 
@@ -155,12 +210,12 @@ DDPOutputData::DDPOutputData(const Json::Value& config) :
         ddpBuffers[x][0] = DDP_FLAGS1_VER1;
         ddpBuffers[x][2] = 1;
         ddpBuffers[x][3] = DDP_ID_DISPLAY;
-        int pktSize = DDP_CHANNELS_PER_PACKET;
+        int pktSize = payload;
         if (x == (pktCount - 1)) {
             ddpBuffers[x][0] = DDP_FLAGS1_VER1 | DDP_FLAGS1_PUSH;
             //last packet
-            if (channelCount % DDP_CHANNELS_PER_PACKET) {
-                pktSize = channelCount % DDP_CHANNELS_PER_PACKET;
+            if (channelCount % payload) {
+                pktSize = channelCount % payload;
             }
         }
         ddpIovecs[x * 2 + 1].iov_len = pktSize;
@@ -177,49 +232,97 @@ DDPOutputData::DDPOutputData(const Json::Value& config) :
 
         chan += pktSize;
     }
-}
-DDPOutputData::~DDPOutputData() {
+
+    ddpMessages.resize(pktCount);
     for (int x = 0; x < pktCount; x++) {
-        free(ddpBuffers[x]);
+        struct mmsghdr& msg = ddpMessages[x];
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_hdr.msg_name = &ddpAddress;
+        msg.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        msg.msg_hdr.msg_iov = &ddpIovecs[x * 2];
+        msg.msg_hdr.msg_iovlen = 2;
+        msg.msg_len = ddpIovecs[x * 2 + 1].iov_len + DDP_HEADER_LEN;
     }
-    free(ddpBuffers);
-    free(ddpIovecs);
+}
+
+void DDPOutputData::BuildSendPlan(UDPOutputMessages& msgs) {
+    sendTarget = msgs.ReserveMessages(ddpAddress.sin_addr.s_addr, pktCount);
+}
+
+void DDPOutputData::NetworkChanged() {
+    if (mtu >= 0 || !valid) {
+        return;
+    }
+    int pathMTU = 1500;
+#ifndef PLATFORM_OSX
+    // the route's MTU, including anything learned from path MTU discovery
+    int s = socket(AF_INET, SOCK_DGRAM, 0);
+    if (s >= 0) {
+        if (connect(s, (struct sockaddr*)&ddpAddress, sizeof(ddpAddress)) == 0) {
+            int v = 0;
+            socklen_t len = sizeof(v);
+            if (getsockopt(s, IPPROTO_IP, IP_MTU, &v, &len) == 0 && v > 0) {
+                pathMTU = v;
+            }
+        }
+        close(s);
+    }
+#endif
+    int p = DDPPayloadForMTU(pathMTU);
+    if (p != wantedPayload) {
+        LogDebug(VB_CHANNELOUT, "DDP %s: MTU %d, %d channels per packet\n", ipAddress.c_str(), pathMTU, p);
+        wantedPayload = p;
+    }
+}
+
+void DDPOutputData::GetStats(Json::Value& result) {
+    UDPOutputData::GetStats(result);
+    result["mtu"] = mtu;
+    result["channelsPerPacket"] = payload;
+    result["packetsPerFrame"] = pktCount;
 }
 
 void DDPOutputData::PrepareData(unsigned char* channelData, UDPOutputMessages& msgs) {
     if (valid && active) {
-        int start = 0;
-        struct mmsghdr msg;
-        memset(&msg, 0, sizeof(msg));
+        if (wantedPayload != payload) {
+            // MTU changed, rebuild the packets on the output thread so
+            // nothing is using the old ones
+            int oldCount = pktCount;
+            BuildPackets(wantedPayload);
+            if (sendTarget && pktCount > oldCount) {
+                msgs.ReserveMessages(ddpAddress.sin_addr.s_addr, pktCount - oldCount);
+            }
+        }
+        if (channelData != planChannelData) {
+            // set the pointers to the channelData for each packet
+            int start = 0;
+            for (int p = 0; p < pktCount; p++) {
+                ddpIovecs[p * 2 + 1].iov_base = (void*)(&channelData[startChannel - 1 + start]);
+                start += ddpIovecs[p * 2 + 1].iov_len;
+            }
+            planChannelData = channelData;
+        }
+        std::vector<struct mmsghdr>& target = sendTarget ? *sendTarget : msgs[ddpAddress.sin_addr.s_addr];
 
-        msg.msg_hdr.msg_name = &ddpAddress;
-        msg.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        int start = 0;
         bool skipped = false;
         bool allSkipped = true;
         for (int p = 0; p < pktCount; p++) {
-            bool nto = NeedToOutputFrame(channelData, startChannel - 1, start, ddpIovecs[p * 2 + 1].iov_len);
+            bool nto = !deDuplicate || NeedToOutputFrame(channelData, startChannel - 1, start, ddpIovecs[p * 2 + 1].iov_len);
             if (!nto && (p == (pktCount - 1)) && !allSkipped) {
                 // at least one packet is not a duplicate, we need to send the last
                 // packet so that the sync flag is sent
                 nto = true;
             }
             if (nto) {
-                msg.msg_hdr.msg_iov = &ddpIovecs[p * 2];
-                msg.msg_hdr.msg_iovlen = 2;
-                msg.msg_len = ddpIovecs[p * 2 + 1].iov_len + DDP_HEADER_LEN;
+                target.push_back(ddpMessages[p]);
 
-                msgs[ddpAddress.sin_addr.s_addr].push_back(msg);
-
-                unsigned char* header = ddpBuffers[p];
-                header[1] = sequenceNumber & 0xF;
+                ddpBuffers[p][1] = sequenceNumber & 0xF;
                 if (sequenceNumber == 15) {
                     sequenceNumber = 1;
                 } else {
                     ++sequenceNumber;
                 }
-
-                // set the pointer to the channelData for the universe
-                ddpIovecs[p * 2 + 1].iov_base = (void*)(&channelData[startChannel - 1 + start]);
                 allSkipped = false;
             } else {
                 skipped = true;
@@ -235,11 +338,12 @@ void DDPOutputData::PrepareData(unsigned char* channelData, UDPOutputMessages& m
     }
 }
 void DDPOutputData::DumpConfig() {
-    LogDebug(VB_CHANNELOUT, "DDP: %s   %d:%d:%d:%d  %s\n",
+    LogDebug(VB_CHANNELOUT, "DDP: %s   %d:%d:%d:%d  %s  %d\n",
              description.c_str(),
              active,
              startChannel,
              channelCount,
              type,
-             ipAddress.c_str());
+             ipAddress.c_str(),
+             payload);
 }
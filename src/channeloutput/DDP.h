@@ -26,15 +26,33 @@ public:
 
     virtual bool IsPingable() override { return true; }
     virtual void PrepareData(unsigned char* channelData, UDPOutputMessages& msgs) override;
+    virtual void BuildSendPlan(UDPOutputMessages& msgs) override;
+    virtual void NetworkChanged() override;
     virtual void DumpConfig() override;
 
     virtual const std::string& GetOutputTypeString() const override;
+    virtual void GetStats(Json::Value& result) override;
 
     char sequenceNumber;
 
     sockaddr_in ddpAddress;
     int pktCount;
 
+    // configured MTU, 0 for the standard 1440 channel packets, -1 to
+    // follow the path MTU to the controller
+    int mtu;
+    // channels per packet of the current packets and the one wanted for
+    // the current MTU, the packets are rebuilt on the next frame if they differ
+    int payload;
+    std::atomic_int wantedPayload;
+
     struct iovec* ddpIovecs = nullptr;
     unsigned char** ddpBuffers = nullptr;
+
+    // one prebuilt message per packet, copied to the send list as is
+    std::vector<struct mmsghdr> ddpMessages;
+
+private:
+    void BuildPackets(int payload);
+    void FreePackets();
 };
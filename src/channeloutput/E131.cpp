@@ -46,11 +46,72 @@ const unsigned char E131header[] = {
     0x00, 0x00, 0x01, 0x72, 0x0b, 0x02, 0xa1, 0x00, 0x00, 0x00, 0x01, 0x02, 0x01, 0x00
 };
 
+static int E131SyncUniverse = 0;
+static unsigned char E131SyncPacket[E131_SYNC_PACKET_LENGTH];
+static struct iovec E131SyncIovec = { E131SyncPacket, E131_SYNC_PACKET_LENGTH };
+static std::vector<sockaddr_in> E131SyncAddresses;
+
+static std::string E131MulticastAddress(int universe) {
+    char sAddress[32];
+    sprintf(sAddress, "239.255.%d.%d", universe / 256, universe % 256);
+    return sAddress;
+}
+
+void E131OutputData::SetSyncUniverse(int u, const std::string& targets) {
+    E131SyncUniverse = (u > 0 && u < 64000) ? u : 0;
+    E131SyncAddresses.clear();
+    if (!E131SyncUniverse) {
+        return;
+    }
+
+    memset(E131SyncPacket, 0, sizeof(E131SyncPacket));
+    // root layer is the same as the data packets other than the length and vector
+    memcpy(E131SyncPacket, E131header, 38);
+    int count = E131_SYNC_PACKET_LENGTH - 16;
+    E131SyncPacket[E131_RLP_COUNT_INDEX] = (count / 256) + 0x70;
+    E131SyncPacket[E131_RLP_COUNT_INDEX + 1] = count % 256;
+    E131SyncPacket[E131_VECTOR_INDEX] = VECTOR_ROOT_E131_EXTENDED;
+    count = E131_SYNC_PACKET_LENGTH - 38;
+    E131SyncPacket[E131_FRAMING_COUNT_INDEX] = (count / 256) + 0x70;
+    E131SyncPacket[E131_FRAMING_COUNT_INDEX + 1] = count % 256;
+    E131SyncPacket[E131_EXTENDED_PACKET_TYPE_INDEX] = VECTOR_E131_EXTENDED_SYNCHRONIZATION;
+    E131SyncPacket[E131_SYNC_UNIVERSE_INDEX] = E131SyncUniverse / 256;
+    E131SyncPacket[E131_SYNC_UNIVERSE_INDEX + 1] = E131SyncUniverse % 256;
+
+    std::vector<std::string> addresses;
+    if (targets.empty()) {
+        addresses.push_back(E131MulticastAddress(E131SyncUniverse));
+    } else {
+        addresses = split(targets, ',');
+    }
+    for (auto& ip : addresses) {
+        TrimWhiteSpace(ip);
+        if (ip.empty()) {
+            continue;
+        }
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(E131_DEST_PORT);
+        bool v = true;
+        addr.sin_addr.s_addr = toInetAddr(ip, v);
+        if (v) {
+            E131SyncAddresses.push_back(addr);
+        }
+    }
+    LogDebug(VB_CHANNELOUT, "E1.31 Sync Universe: %d to %d targets\n", E131SyncUniverse, (int)E131SyncAddresses.size());
+}
+
 static const std::string E131TYPE = "e1.31";
 
 const std::string& E131OutputData::GetOutputTypeString() const {
     return E131TYPE;
 }
+void E131OutputData::GetStats(Json::Value& result) {
+    UDPOutputData::GetStats(result);
+    result["universe"] = universe;
+    result["universeCount"] = universeCount;
+}
 
 E131OutputData::E131OutputData(const Json::Value& config) :
     UDPOutputData(config),
@@ -115,6 +176,8 @@ E131OutputData::E131OutputData(const Json::Value& config) :
 
         int uni = universe + x;
         e131Buffer[E131_PRIORITY_INDEX] = priority;
+        e131Buffer[E131_SYNC_ADDRESS_INDEX] = E131SyncUniverse / 256;
+        e131Buffer[E131_SYNC_ADDRESS_INDEX + 1] = E131SyncUniverse % 256;
         e131Buffer[E131_UNIVERSE_INDEX] = (char)(uni / 256);
         e131Buffer[E131_UNIVERSE_INDEX + 1] = (char)(uni % 256);
 
@@ -147,6 +210,19 @@ E131OutputData::E131OutputData(const Json::Value& config) :
         e131Iovecs[x * 2 + 1].iov_base = nullptr;
         e131Iovecs[x * 2 + 1].iov_len = channelCount;
     }
+
+    // the iovecs and addresses never move after this so the messages can
+    // be built once and reused every frame
+    e131Messages.resize(universeCount);
+    for (int x = 0; x < universeCount; x++) {
+        struct mmsghdr& msg = e131Messages[x];
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_hdr.msg_name = &e131Addresses[x];
+        msg.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        msg.msg_hdr.msg_iov = &e131Iovecs[x * 2];
+        msg.msg_hdr.msg_iovlen = 2;
+        msg.msg_len = channelCount + E131_HEADER_LENGTH;
+    }
 }
 
 E131OutputData::~E131OutputData() {
@@ -159,41 +235,53 @@ bool E131OutputData::IsPingable() {
     return type == 1;
 }
 
+unsigned int E131OutputData::sendKey() const {
+    if (type == E131_TYPE_MULTICAST) {
+        return MULTICAST_MESSAGES_KEY;
+    }
+    return e131Addresses[0].sin_addr.s_addr;
+}
+
+void E131OutputData::BuildSendPlan(UDPOutputMessages& msgs) {
+    sendTarget = msgs.ReserveMessages(sendKey(), universeCount);
+}
+
 void E131OutputData::PrepareData(unsigned char* channelData, UDPOutputMessages& msgs) {
     if (valid && active) {
-        unsigned char* cur = channelData + startChannel - 1;
+        if (channelData != planChannelData) {
+            // point the data iovecs at the universes
+            unsigned char* cur = channelData + startChannel - 1;
+            for (int x = 0; x < universeCount; x++, cur += channelCount) {
+                e131Iovecs[x * 2 + 1].iov_base = (void*)cur;
+            }
+            planChannelData = channelData;
+        }
+        std::vector<struct mmsghdr>& target = sendTarget ? *sendTarget : msgs[sendKey()];
+
+        if (!deDuplicate) {
+            // everything is sent, copy the whole plan
+            target.insert(target.end(), e131Messages.begin(), e131Messages.end());
+            for (auto h : e131Headers) {
+                ++h[E131_SEQUENCE_INDEX];
+            }
+            return;
+        }
+
         int start = 0;
         bool skipped = false;
         bool allSkipped = true;
         for (int x = 0; x < universeCount; x++) {
             if (NeedToOutputFrame(channelData, startChannel - 1, start, channelCount)) {
-                struct mmsghdr msg;
-                memset(&msg, 0, sizeof(msg));
-
-                msg.msg_hdr.msg_name = &e131Addresses[x];
-                msg.msg_hdr.msg_namelen = sizeof(sockaddr_in);
-                msg.msg_hdr.msg_iov = &e131Iovecs[x * 2];
-                msg.msg_hdr.msg_iovlen = 2;
-                msg.msg_len = channelCount + E131_HEADER_LENGTH;
-                if (type == E131_TYPE_MULTICAST) {
-                    msgs[MULTICAST_MESSAGES_KEY].push_back(msg);
-                } else {
-                    msgs[e131Addresses[x].sin_addr.s_addr].push_back(msg);
-                }
-
+                target.push_back(e131Messages[x]);
                 ++e131Headers[x][E131_SEQUENCE_INDEX];
-                e131Iovecs[x * 2 + 1].iov_base = (void*)cur;
                 allSkipped = false;
             } else {
                 skipped = true;
             }
-            cur += channelCount;
             start += channelCount;
         }
         if (skipped) {
             skippedFrames++;
-        } else {
-            skippedFrames = 0;
         }
         if (!allSkipped) {
             SaveFrame(&channelData[startChannel - 1], start);
@@ -201,6 +289,30 @@ void E131OutputData::PrepareData(unsigned char* channelData, UDPOutputMessages&
     }
 }
 
+void E131OutputData::PostPrepareData(unsigned char* channelData, UDPOutputMessages& msgs) {
+    if (!E131SyncUniverse || E131SyncAddresses.empty()) {
+        return;
+    }
+    std::vector<struct mmsghdr>& late = msgs[LATE_MULTICAST_MESSAGES_KEY];
+    for (auto& msg : late) {
+        if (msg.msg_hdr.msg_iov == &E131SyncIovec) {
+            //already added by another output, skip
+            return;
+        }
+    }
+    ++E131SyncPacket[E131_SYNC_SEQUENCE_INDEX];
+    for (auto& addr : E131SyncAddresses) {
+        struct mmsghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_hdr.msg_name = &addr;
+        msg.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        msg.msg_hdr.msg_iov = &E131SyncIovec;
+        msg.msg_hdr.msg_iovlen = 1;
+        msg.msg_len = E131_SYNC_PACKET_LENGTH;
+        late.push_back(msg);
+    }
+}
+
 void E131OutputData::GetRequiredChannelRange(int& min, int& max) {
     min = startChannel - 1;
     max = startChannel + (channelCount * universeCount) - 1;
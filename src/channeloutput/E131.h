@@ -26,17 +26,32 @@ public:
     virtual bool IsPingable() override;
 
     virtual void PrepareData(unsigned char* channelData, UDPOutputMessages& msgs) override;
+    virtual void PostPrepareData(unsigned char* channelData, UDPOutputMessages& msgs) override;
+    virtual void BuildSendPlan(UDPOutputMessages& msgs) override;
 
     virtual void DumpConfig() override;
     virtual void GetRequiredChannelRange(int& min, int& max) override;
 
     virtual const std::string& GetOutputTypeString() const override;
+    virtual void GetStats(Json::Value& result) override;
 
     int universe;
     int universeCount;
     int priority;
 
+    // Universe Synchronization.  With a sync universe set, every data packet
+    // carries it as the sync address and a sync packet is sent to the
+    // targets (comma separated IPs, the sync universe's multicast group
+    // if empty) once the frame's data has gone out.  0 disables.
+    static void SetSyncUniverse(int universe, const std::string& targets);
+
     std::vector<sockaddr_in> e131Addresses;
     std::vector<struct iovec> e131Iovecs;
     std::vector<unsigned char*> e131Headers;
+
+    // one prebuilt message per universe, copied to the send list as is
+    std::vector<struct mmsghdr> e131Messages;
+
+private:
+    unsigned int sendKey() const;
 };
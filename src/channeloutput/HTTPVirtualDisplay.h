@@ -30,6 +30,8 @@ public:
     virtual void PrepData(unsigned char* channelData) override;
     virtual int SendData(unsigned char* channelData) override;
 
+    virtual bool IsOptionalOutput() const override { return true; }
+
     void ConnectionThread(void);
     void SelectThread(void);
 
@@ -25,6 +25,8 @@ public:
 
     virtual int RawSendData(unsigned char* channelData) override;
 
+    virtual bool IsOptionalOutput() const override { return true; }
+
     virtual void DumpConfig(void) override;
     virtual void GetRequiredChannelRanges(const std::function<void(int, int)>& addRange) override;
 
@@ -14,10 +14,19 @@
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
 #include <sys/socket.h>
 #include <ifaddrs.h>
+#include <time.h>
 
 #include <netdb.h>
+#include <pthread.h>
+#ifndef PLATFORM_OSX
+#include <linux/futex.h>
+#include <linux/sockios.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
 
 #include <curl/curl.h>
 
@@ -28,11 +37,53 @@
 
 #include "ArtNet.h"
 #include "DDP.h"
+#include "channeloutputthread.h"
 #include "E131.h"
 #include "KiNet.h"
 #include "Twinkly.h"
+#include "UDPPacketRing.h"
 
 #include "Plugin.h"
+#include "Trace.h"
+
+#if defined(__linux__) && !defined(UDP_SEGMENT)
+#define UDP_SEGMENT 103
+#endif
+
+// the kernel limits a GSO send to 64 segments and a single IP datagram
+static constexpr int GSO_MAX_SEGMENTS = 64;
+static constexpr size_t GSO_MAX_PAYLOAD = 65000;
+
+static inline uint64_t ThreadCPUNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+static inline uint64_t MonotonicNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// wait until the value is no longer val (or the timeout), no futex on OSX
+// so that just polls
+static void FutexWait(std::atomic_uint32_t& v, uint32_t val, uint64_t timeoutNanos) {
+#ifndef PLATFORM_OSX
+    struct timespec ts;
+    ts.tv_sec = timeoutNanos / 1000000000ULL;
+    ts.tv_nsec = timeoutNanos % 1000000000ULL;
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&v), FUTEX_WAIT_PRIVATE, val, &ts, nullptr, 0);
+#else
+    if (v.load() == val) {
+        std::this_thread::sleep_for(std::chrono::microseconds(std::min(timeoutNanos / 1000, (uint64_t)100)));
+    }
+#endif
+}
+static void FutexWake(std::atomic_uint32_t& v) {
+#ifndef PLATFORM_OSX
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&v), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
 class UDPPlugin : public FPPPlugins::Plugin, public FPPPlugins::ChannelOutputPlugin {
 public:
     UDPPlugin() :
@@ -57,6 +108,11 @@ static void DoPingThread(UDPOutput* output) {
     output->BackgroundThreadPing();
 }
 
+union GSOControl {
+    char buf[CMSG_SPACE(sizeof(uint16_t))];
+    struct cmsghdr align;
+};
+
 class SendSocketInfo {
 public:
     SendSocketInfo() {
@@ -64,14 +120,22 @@ public:
         curSocket = -1;
     }
     ~SendSocketInfo() {
-        for (int x : sockets) {
-            close(x);
+        if (ownsSockets) {
+            for (int x : sockets) {
+                close(x);
+            }
         }
     }
 
     std::vector<int> sockets;
+    bool ownsSockets = true;
     int errCount;
     int curSocket;
+
+    // scratch space for coalescing messages for GSO, reused every frame
+    std::vector<struct mmsghdr> gsoMsgs;
+    std::vector<int> gsoCounts;
+    std::vector<GSOControl> gsoControl;
 };
 
 UDPOutputMessages::UDPOutputMessages() {
@@ -85,21 +149,30 @@ int UDPOutputMessages::GetSocket(unsigned int key) {
     }
     return -1;
 }
-void UDPOutputMessages::ForceSocket(unsigned int key, int socket) {
+void UDPOutputMessages::ForceSocket(unsigned int key, int socket, bool owned) {
     SendSocketInfo* info = sendSockets[key];
     if (info == nullptr) {
         info = new SendSocketInfo();
         sendSockets[key] = info;
     }
-    for (int x = 0; x < info->sockets.size(); x++) {
-        close(info->sockets[x]);
+    if (info->ownsSockets) {
+        for (int x = 0; x < info->sockets.size(); x++) {
+            close(info->sockets[x]);
+        }
     }
     info->sockets.clear();
     info->sockets.push_back(socket);
+    info->ownsSockets = owned;
 }
 std::vector<struct mmsghdr>& UDPOutputMessages::GetMessages(unsigned int key) {
     return messages[key];
 }
+std::vector<struct mmsghdr>* UDPOutputMessages::ReserveMessages(unsigned int key, int count) {
+    std::vector<struct mmsghdr>& m = messages[key];
+    reservedCounts[key] += count;
+    m.reserve(reservedCounts[key]);
+    return &m;
+}
 void UDPOutputMessages::clearMessages() {
     for (auto& m : messages) {
         m.second.clear();
@@ -119,8 +192,7 @@ UDPOutputData::UDPOutputData(const Json::Value& config) :
     type(0),
     monitor(true),
     failCount(0),
-    lastData(nullptr),
-    skippedFrames(0) {
+    lastData(nullptr) {
     if (config.isMember("description")) {
         description = config["description"].asString();
     }
@@ -143,6 +215,15 @@ UDPOutputData::UDPOutputData(const Json::Value& config) :
     if (config.isMember("deDuplicate")) {
         deDuplicate = config["deDuplicate"].asInt() ? true : false;
     }
+    if (config.isMember("keepAlive")) {
+        keepAliveMS = config["keepAlive"].asInt();
+    }
+    if (config.isMember("pacePackets")) {
+        pacePackets = config["pacePackets"].asDouble();
+    }
+    if (config.isMember("paceBytes")) {
+        paceBytes = config["paceBytes"].asDouble();
+    }
 }
 UDPOutputData::~UDPOutputData() {
     if (lastData) {
@@ -154,6 +235,102 @@ static const std::string UNKNOWN_TYPE = "UDP";
 const std::string& UDPOutputData::GetOutputTypeString() const {
     return UNKNOWN_TYPE;
 }
+void UDPOutputData::GetStats(Json::Value& result) {
+    result["type"] = GetOutputTypeString();
+    result["description"] = description;
+    result["address"] = ipAddress;
+    result["startChannel"] = startChannel;
+    result["channelCount"] = channelCount;
+    result["active"] = active;
+    result["valid"] = valid;
+    result["dedupeSkips"] = (Json::UInt64)dedupeSkips;
+    result["skippedFrames"] = (Json::UInt64)skippedFrames;
+}
+
+// upper bounds of the latency histogram buckets in microseconds, the
+// last bucket is everything slower
+static const int LATENCY_LIMITS[UDPDestinationStats::LATENCY_BUCKETS - 1] = { 10, 25, 50, 100, 250, 500, 1000, 2500, 5000 };
+
+void UDPDestinationStats::Counters::Reset() {
+    packets = 0;
+    bytes = 0;
+    eagain = 0;
+    enobufs = 0;
+    errors = 0;
+    for (auto& l : latency) {
+        l = 0;
+    }
+    lastSuccess = 0;
+}
+UDPDestinationStats::UDPDestinationStats() {
+    for (int x = 0; x < MAX_DESTINATIONS; x++) {
+        addresses[x] = 0;
+        counters[x].Reset();
+    }
+}
+UDPDestinationStats::Counters* UDPDestinationStats::Get(in_addr_t addr) {
+    uint32_t idx = ((uint32_t)addr * 2654435761U) % MAX_DESTINATIONS;
+    for (int x = 0; x < MAX_DESTINATIONS; x++) {
+        in_addr_t cur = addresses[idx].load(std::memory_order_acquire);
+        if (cur == addr) {
+            return &counters[idx];
+        }
+        if (cur == 0) {
+            in_addr_t expected = 0;
+            if (addresses[idx].compare_exchange_strong(expected, addr) || expected == addr) {
+                return &counters[idx];
+            }
+        }
+        idx = (idx + 1) % MAX_DESTINATIONS;
+    }
+    return nullptr;
+}
+void UDPDestinationStats::AddLatency(Counters* c, uint64_t nanos) {
+    uint64_t us = nanos / 1000;
+    int b = 0;
+    while (b < (LATENCY_BUCKETS - 1) && us >= LATENCY_LIMITS[b]) {
+        ++b;
+    }
+    c->latency[b]++;
+}
+void UDPDestinationStats::GetStats(Json::Value& result) {
+    result = Json::Value(Json::arrayValue);
+    long long now = GetTimeMS();
+    for (int x = 0; x < MAX_DESTINATIONS; x++) {
+        in_addr_t addr = addresses[x].load(std::memory_order_acquire);
+        if (addr == 0) {
+            continue;
+        }
+        Counters& c = counters[x];
+        struct in_addr a;
+        a.s_addr = addr;
+        char buf[INET_ADDRSTRLEN];
+        Json::Value d;
+        d["address"] = inet_ntop(AF_INET, &a, buf, sizeof(buf));
+        d["packets"] = (Json::UInt64)c.packets;
+        d["bytes"] = (Json::UInt64)c.bytes;
+        d["eagain"] = (Json::UInt64)c.eagain;
+        d["enobufs"] = (Json::UInt64)c.enobufs;
+        d["errors"] = (Json::UInt64)c.errors;
+        long long last = c.lastSuccess;
+        d["lastSuccess"] = (Json::Int64)last;
+        d["lastSuccessAge"] = last ? (Json::Int64)(now - last) : (Json::Int64)-1;
+        Json::Value hist;
+        for (int b = 0; b < LATENCY_BUCKETS; b++) {
+            Json::Value h;
+            h["maxUS"] = b < (LATENCY_BUCKETS - 1) ? LATENCY_LIMITS[b] : -1;
+            h["count"] = (Json::UInt64)c.latency[b];
+            hist.append(h);
+        }
+        d["latency"] = hist;
+        result.append(d);
+    }
+}
+void UDPDestinationStats::Reset() {
+    for (int x = 0; x < MAX_DESTINATIONS; x++) {
+        counters[x].Reset();
+    }
+}
 
 in_addr_t UDPOutputData::toInetAddr(const std::string& ipAddress, bool& valid) {
     valid = true;
@@ -177,44 +354,89 @@ in_addr_t UDPOutputData::toInetAddr(const std::string& ipAddress, bool& valid) {
     return inet_addr(ipAddress.c_str());
 }
 
+typedef uint8_t DedupeVector __attribute__((vector_size(16)));
+
+// Compares the new data to the saved copy and saves it in the same pass,
+// returns true if anything changed.  Uses the compiler's vector extensions
+// so this is SSE2 on x86 and NEON on ARM.  The new data is always stored,
+// that's cheaper than checking first.
+static bool CompareAndSave(const unsigned char* cur, unsigned char* saved, int len) {
+    DedupeVector diff = {};
+    int x = 0;
+    for (; x + 64 <= len; x += 64) {
+        DedupeVector a[4], b[4];
+        memcpy(a, cur + x, 64);
+        memcpy(b, saved + x, 64);
+        diff |= (a[0] ^ b[0]) | (a[1] ^ b[1]) | (a[2] ^ b[2]) | (a[3] ^ b[3]);
+        memcpy(saved + x, a, 64);
+    }
+    for (; x + 16 <= len; x += 16) {
+        DedupeVector a, b;
+        memcpy(&a, cur + x, 16);
+        memcpy(&b, saved + x, 16);
+        diff |= a ^ b;
+        memcpy(saved + x, &a, 16);
+    }
+    uint64_t d[2];
+    memcpy(d, &diff, 16);
+    d[0] |= d[1];
+    for (; x < len; x++) {
+        d[0] |= cur[x] ^ saved[x];
+        saved[x] = cur[x];
+    }
+    return d[0] != 0;
+}
+
 void UDPOutputData::SaveFrame(unsigned char* channelData, int len) {
     if (deDuplicate) {
-        if (lastData == nullptr) {
-            lastData = (unsigned char*)calloc(1, len);
+        if (changes && changes->Generation()) {
+            savedGeneration = changes->Generation();
+            return;
         }
-        /*
-        printf("Saving: %d   %2X%2X%2X %2X%2X%2X %2X%2X%2X %2X%2X%2X\n", len,
-               channelData[0], channelData[1], channelData[2], channelData[3], channelData[4], channelData[5],
-               channelData[6], channelData[7], channelData[8], channelData[9], channelData[10], channelData[11]);
-         */
-        memcpy(lastData, channelData, len);
+        // NeedToOutputFrame already saved the data while comparing
+        savedGeneration = 0;
     }
 }
 
 bool UDPOutputData::NeedToOutputFrame(unsigned char* channelData, int startChannel, int savedIdx, int count) {
-    if (deDuplicate && skippedFrames < 10) {
-        if (lastData == nullptr) {
+    if (!deDuplicate) {
+        return true;
+    }
+    if (savedIdx == 0) {
+        // first range of a new frame
+        long long now = GetTimeMS();
+        keepAliveFrame = (now - lastKeepAlive) >= keepAliveMS;
+        if (keepAliveFrame) {
+            lastKeepAlive = now;
+        }
+    }
+    if (changes && savedGeneration) {
+        if (keepAliveFrame || savedGeneration > changes->Generation()) {
+            // keepalive or the map was reset
             return true;
         }
-        for (int x = 0; x < count; x++) {
-            if (channelData[x + savedIdx + startChannel] != lastData[x + savedIdx]) {
-                /*
-                printf("ND: %d   %2X%2X%2X %2X%2X%2X %2X%2X%2X %2X%2X%2X\n", x,
-                       lastData[0], lastData[1], lastData[2], lastData[3], lastData[4], lastData[5],
-                       lastData[6], lastData[7], lastData[8], lastData[9], lastData[10], lastData[11]);
-                printf("%d %d    %2X%2X%2X %2X%2X%2X %2X%2X%2X %2X%2X%2X\n", start, startChannel, x,
-                       channelData[start + startChannel + 0], channelData[start + startChannel + 1], channelData[start + startChannel + 2],
-                       channelData[start + startChannel + 3], channelData[start + startChannel + 4], channelData[start + startChannel + 5],
-                       channelData[start + startChannel + 6], channelData[start + startChannel + 7], channelData[start + startChannel + 8],
-                       channelData[start + startChannel + 9], channelData[start + startChannel + 10], channelData[start + startChannel + 11]);
-                 printf("New data %d  %d  %d      %X %X\n", x, startChannel, savedIdx, channelData[x + savedIdx + startChannel], lastData[x + savedIdx]);
-                 */
-                return true;
-            }
+        if (!changes->ChangedSince(startChannel + savedIdx, count, savedGeneration)) {
+            ++dedupeSkips;
+            return false;
         }
+        return true;
+    }
+    if (lastData == nullptr) {
+        int mn = 0;
+        int mx = 0;
+        GetRequiredChannelRange(mn, mx);
+        lastDataSize = mx - mn + 1;
+        lastData = (unsigned char*)calloc(1, lastDataSize);
+        keepAliveFrame = true;
+    }
+    if ((savedIdx + count) > lastDataSize) {
+        return true;
+    }
+    bool changed = CompareAndSave(channelData + startChannel + savedIdx, lastData + savedIdx, count);
+    if (!changed && !keepAliveFrame) {
+        ++dedupeSkips;
         return false;
     }
-    skippedFrames = 0;
     return true;
 }
 
@@ -222,16 +444,23 @@ UDPOutput::UDPOutput(unsigned int startChannel, unsigned int channelCount) :
     pingThread(nullptr),
     runPingThread(true),
     networkCallbackId(0),
-    doneWorkCount(0),
-    numWorkThreads(0),
+    workLatch(0),
     runWorkThreads(true),
-    useThreadedOutput(true) {
+    useThreadedOutput(true),
+    useGSO(false),
+    gsoAvailable(false),
+    packetRing(nullptr),
+    pacingEnabled(false),
+    pacePackets(0),
+    paceBytes(0),
+    paceWindowMS(0),
+    syncWaitUS(1000) {
     INSTANCE = this;
+    stats.startTime = GetTimeMS();
     m_curlm = curl_multi_init();
 }
 UDPOutput::~UDPOutput() {
-    runWorkThreads = false;
-    workSignal.notify_all();
+    StopWorkers();
 
     INSTANCE = nullptr;
     runPingThread = false;
@@ -247,14 +476,19 @@ UDPOutput::~UDPOutput() {
     }
     curl_multi_cleanup(m_curlm);
     m_curlm = nullptr;
-
-    while (numWorkThreads) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    if (packetRing) {
+        delete packetRing;
+        packetRing = nullptr;
     }
 }
 
 int UDPOutput::Init(Json::Value config) {
     enabled = config["enabled"].asInt();
+    // sync settings are baked into the packet headers so need to be
+    // known before the outputs are created
+    E131OutputData::SetSyncUniverse(config.isMember("e131SyncUniverse") ? config["e131SyncUniverse"].asInt() : 0,
+                                    config.isMember("e131SyncAddresses") ? config["e131SyncAddresses"].asString() : "");
+    ArtNetOutputData::SetSyncTargets(config.isMember("artSyncTargets") ? config["artSyncTargets"].asString() : "");
     for (int i = 0; i < config["universes"].size(); i++) {
         Json::Value s = config["universes"][i];
         int type = s["type"].asInt();
@@ -295,6 +529,34 @@ int UDPOutput::Init(Json::Value config) {
     if (config.isMember("interface")) {
         e131Interface = config["interface"].asString();
     }
+    if (config.isMember("gso")) {
+        useGSO = config["gso"].asInt() ? true : false;
+    }
+    if (config.isMember("txBackend")) {
+        txBackend = config["txBackend"].asString();
+    }
+    if (config.isMember("pacePackets")) {
+        pacePackets = config["pacePackets"].asDouble();
+    }
+    if (config.isMember("paceBytes")) {
+        paceBytes = config["paceBytes"].asDouble();
+    }
+    if (config.isMember("paceWindow")) {
+        paceWindowMS = config["paceWindow"].asInt();
+    }
+    if (config.isMember("syncWait")) {
+        syncWaitUS = config["syncWait"].asInt();
+    }
+    for (auto o : outputs) {
+        if ((o->pacePackets > 0 || o->paceBytes > 0) && o->ipAddress != "") {
+            bool v = true;
+            in_addr_t addr = UDPOutputData::toInetAddr(o->ipAddress, v);
+            if (v) {
+                paceOverrides[addr] = std::make_pair(o->pacePackets, o->paceBytes);
+            }
+        }
+    }
+    pacingEnabled = pacePackets > 0 || paceBytes > 0 || !paceOverrides.empty();
 
     std::set<std::string> myIps;
     //get all the addresses
@@ -356,7 +618,14 @@ int UDPOutput::Init(Json::Value config) {
     };
     networkCallbackId = NetworkMonitor::INSTANCE.registerCallback(f);
 
+    for (auto o : outputs) {
+        o->BuildSendPlan(messages);
+    }
+
     InitNetwork();
+    if (useGSO) {
+        gsoAvailable = ProbeGSO();
+    }
     // need to do three pings to detect down hosts
     PingControllers();
     PingControllers(true);
@@ -378,7 +647,9 @@ int UDPOutput::Close() {
 void UDPOutput::PrepData(unsigned char* channelData) {
     if (enabled) {
         std::unique_lock<std::mutex> lk(socketMutex);
+        uint64_t cpuStart = ThreadCPUNanos();
         messages.clearMessages();
+        FPP_TRACE_SPAN("UDPOutput::PrepareData");
         for (auto a : outputs) {
             if (a->valid && a->active) {
                 a->PrepareData(channelData, messages);
@@ -390,7 +661,15 @@ void UDPOutput::PrepData(unsigned char* channelData) {
                 a->PostPrepareData(channelData, messages);
             }
         }
+        ++stats.frames;
+        stats.prepCPUNanos += ThreadCPUNanos() - cpuStart;
+    }
+}
+void UDPOutput::PrepDataWithChanges(unsigned char* channelData, const ChannelChangeMap& changes) {
+    for (auto a : outputs) {
+        a->SetChangeMap(&changes);
     }
+    PrepData(channelData);
 }
 void UDPOutput::GetRequiredChannelRanges(const std::function<void(int, int)>& addRange) {
     if (enabled) {
@@ -409,12 +688,19 @@ void UDPOutput::addOutput(UDPOutputData* out) {
 }
 
 int UDPOutput::SendMessages(unsigned int socketKey, SendSocketInfo* socketInfo, std::vector<struct mmsghdr>& sendmsgs) {
+    if (sendmsgs.empty()) {
+        return 0;
+    }
+    return SendMessages(socketKey, socketInfo, &sendmsgs[0], sendmsgs.size());
+}
+int UDPOutput::SendMessages(unsigned int socketKey, SendSocketInfo* socketInfo, struct mmsghdr* msgs, int msgCount) {
     errno = 0;
-    struct mmsghdr* msgs = &sendmsgs[0];
-    int msgCount = sendmsgs.size();
     if (msgCount == 0) {
         return 0;
     }
+    FPP_TRACE_SPAN_ARG("UDPOutput::SendMessages", msgCount);
+    uint64_t cpuStart = ThreadCPUNanos();
+    uint64_t start = MonotonicNanos();
 
     int newSockKey = socketKey;
     int sendSocket = socketInfo->sockets[socketInfo->curSocket];
@@ -423,15 +709,34 @@ int UDPOutput::SendMessages(unsigned int socketKey, SendSocketInfo* socketInfo,
         socketInfo->curSocket = 0;
     }
 
-    errno = 0;
-    int oc = sendmmsg(sendSocket, msgs, msgCount, MSG_DONTWAIT);
     int outputCount = 0;
-    if (oc > 0) {
-        outputCount = oc;
+#ifdef UDP_SEGMENT
+    if (gsoAvailable && socketKey != BROADCAST_MESSAGES_KEY) {
+        outputCount = SendMessagesGSO(sendSocket, socketInfo, msgs, msgCount);
+    }
+#endif
+    if (outputCount != msgCount) {
+        errno = 0;
+        int oc = sendmmsg(sendSocket, &msgs[outputCount], msgCount - outputCount, MSG_DONTWAIT);
+        ++stats.sendCalls;
+        if (oc > 0) {
+            outputCount += oc;
+        }
     }
 
     int errCount = 0;
     while (outputCount != msgCount) {
+        struct sockaddr_in* failed = (struct sockaddr_in*)msgs[outputCount].msg_hdr.msg_name;
+        UDPDestinationStats::Counters* fc = failed ? destinationStats.Get(failed->sin_addr.s_addr) : nullptr;
+        if (fc) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                ++fc->eagain;
+            } else if (errno == ENOBUFS) {
+                ++fc->enobufs;
+            } else {
+                ++fc->errors;
+            }
+        }
         LogErr(VB_CHANNELOUT, "sendmmsg() failed for UDP output (key: %X   Socket: %d   output count: %d/%d) with error: %d   %s\n",
                socketKey, sendSocket,
                outputCount, msgCount,
@@ -451,61 +756,415 @@ int UDPOutput::SendMessages(unsigned int socketKey, SendSocketInfo* socketInfo,
                     newSock = socketInfo->sockets[socketInfo->curSocket];
                 }
             } else {
-                return outputCount;
+                break;
             }
         }
         ++errCount;
         if (errCount >= 10) {
-            return outputCount;
+            break;
         }
         errno = 0;
         int oc = sendmmsg(newSock, &msgs[outputCount], msgCount - outputCount, MSG_DONTWAIT);
+        ++stats.sendCalls;
         if (oc > 0) {
             outputCount += oc;
         }
     }
+    stats.packets += outputCount;
+    stats.sendCPUNanos += ThreadCPUNanos() - cpuStart;
+    UpdateDestinationStats(msgs, outputCount, MonotonicNanos() - start);
     return outputCount;
 }
 
-static void DoWorkThread(UDPOutput* output) {
-    output->BackgroundOutputWork();
+void UDPOutput::UpdateDestinationStats(struct mmsghdr* msgs, int sent, uint64_t nanos) {
+    // messages for a destination are almost always together, only look up
+    // the counters when the destination changes.  The kernel doesn't time
+    // the individual messages of a sendmmsg so every destination in the
+    // batch gets the latency of the whole call.
+    long long now = GetTimeMS();
+    in_addr_t curAddr = 0;
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    auto flush = [&]() {
+        if (packets) {
+            UDPDestinationStats::Counters* c = destinationStats.Get(curAddr);
+            if (c) {
+                c->packets += packets;
+                c->bytes += bytes;
+                c->lastSuccess = now;
+                UDPDestinationStats::AddLatency(c, nanos);
+            }
+        }
+        packets = 0;
+        bytes = 0;
+    };
+    for (int m = 0; m < sent; m++) {
+        const struct msghdr& h = msgs[m].msg_hdr;
+        if (!h.msg_name) {
+            continue;
+        }
+        in_addr_t addr = ((struct sockaddr_in*)h.msg_name)->sin_addr.s_addr;
+        if (addr != curAddr) {
+            flush();
+            curAddr = addr;
+        }
+        ++packets;
+        for (size_t i = 0; i < h.msg_iovlen; i++) {
+            bytes += h.msg_iov[i].iov_len;
+        }
+    }
+    flush();
 }
 
-void UDPOutput::BackgroundOutputWork() {
-    std::chrono::high_resolution_clock clock;
-    while (runWorkThreads) {
-        std::unique_lock<std::mutex> lock(workMutex);
-        if (workQueue.empty()) {
-            workSignal.wait(lock);
+#ifdef UDP_SEGMENT
+static inline size_t MessageLength(const struct msghdr& m) {
+    size_t len = 0;
+    for (size_t x = 0; x < m.msg_iovlen; x++) {
+        len += m.msg_iov[x].iov_len;
+    }
+    return len;
+}
+
+/*
+ * Coalesce runs of messages that go to the same address, are the same size
+ * (the last one can be shorter) and whose iovecs are adjacent in memory
+ * (as the prebuilt E1.31/DDP plans are) into single UDP_SEGMENT sends.
+ * Returns how many of the original messages were sent, 0 if nothing could
+ * be coalesced so the caller sends them as is.
+ */
+int UDPOutput::SendMessagesGSO(int sendSocket, SendSocketInfo* socketInfo, struct mmsghdr* msgs, int msgCount) {
+    std::vector<struct mmsghdr>& gsoMsgs = socketInfo->gsoMsgs;
+    std::vector<int>& gsoCounts = socketInfo->gsoCounts;
+    gsoMsgs.clear();
+    gsoCounts.clear();
+    if (socketInfo->gsoControl.size() < msgCount) {
+        socketInfo->gsoControl.resize(msgCount);
+    }
+
+    int x = 0;
+    while (x < msgCount) {
+        struct mmsghdr m = msgs[x];
+        size_t segSize = MessageLength(m.msg_hdr);
+        size_t total = segSize;
+        size_t lastLen = segSize;
+        int segs = 1;
+        int maxSegs = std::min(GSO_MAX_SEGMENTS, (int)(GSO_MAX_PAYLOAD / std::max(segSize, (size_t)1)));
+        while ((x + segs) < msgCount && segs < maxSegs && lastLen == segSize && m.msg_hdr.msg_controllen == 0) {
+            const struct msghdr& prev = msgs[x + segs - 1].msg_hdr;
+            const struct msghdr& next = msgs[x + segs].msg_hdr;
+            if (next.msg_controllen || next.msg_namelen != m.msg_hdr.msg_namelen ||
+                memcmp(next.msg_name, m.msg_hdr.msg_name, next.msg_namelen) ||
+                next.msg_iov != (prev.msg_iov + prev.msg_iovlen)) {
+                break;
+            }
+            size_t len = MessageLength(next);
+            if (len > segSize || (total + len) > GSO_MAX_PAYLOAD) {
+                break;
+            }
+            m.msg_hdr.msg_iovlen += next.msg_iovlen;
+            total += len;
+            lastLen = len;
+            segs++;
+        }
+        if (segs > 1) {
+            GSOControl& ctrl = socketInfo->gsoControl[gsoMsgs.size()];
+            memset(&ctrl, 0, sizeof(ctrl));
+            struct cmsghdr* cm = (struct cmsghdr*)ctrl.buf;
+            cm->cmsg_level = SOL_UDP;
+            cm->cmsg_type = UDP_SEGMENT;
+            cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t gsoSize = segSize;
+            memcpy(CMSG_DATA(cm), &gsoSize, sizeof(gsoSize));
+            m.msg_hdr.msg_control = ctrl.buf;
+            m.msg_hdr.msg_controllen = sizeof(ctrl.buf);
         }
-        if (!workQueue.empty()) {
-            WorkItem i = workQueue.front();
-            workQueue.pop_front();
-            lock.unlock();
+        gsoMsgs.push_back(m);
+        gsoCounts.push_back(segs);
+        x += segs;
+    }
+    if (gsoMsgs.size() == msgCount) {
+        return 0;
+    }
 
-            auto t1 = clock.now();
-            int outputCount = SendMessages(i.id, i.socketInfo, i.msgs);
-            auto t2 = clock.now();
+    errno = 0;
+    int oc = sendmmsg(sendSocket, &gsoMsgs[0], gsoMsgs.size(), MSG_DONTWAIT);
+    ++stats.sendCalls;
+    int err = errno;
+    int sent = 0;
+    for (int i = 0; i < oc; i++) {
+        sent += gsoCounts[i];
+        if (gsoCounts[i] > 1) {
+            ++stats.gsoSends;
+            stats.gsoPackets += gsoCounts[i];
+        }
+    }
+    if (oc < 0 && (err == EIO || err == EINVAL || err == EOPNOTSUPP || err == ENOPROTOOPT)) {
+        // kernel or NIC (no checksum offload) refused, don't try again
+        LogWarn(VB_CHANNELOUT, "UDP GSO send failed (%d: %s), disabling GSO\n", err, strerror(err));
+        gsoAvailable = false;
+        ++stats.gsoFallbacks;
+    }
+    return sent;
+}
+#else
+int UDPOutput::SendMessagesGSO(int sendSocket, SendSocketInfo* socketInfo, struct mmsghdr* msgs, int msgCount) {
+    return 0;
+}
+#endif
 
-            long diff = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
-            if ((outputCount != i.msgs.size()) || (diff > 100)) {
-                i.socketInfo->errCount++;
+bool UDPOutput::ProbeGSO() {
+#ifdef UDP_SEGMENT
+    int s = socket(AF_INET, SOCK_DGRAM, 0);
+    if (s < 0) {
+        return false;
+    }
+    int size = 1400;
+    bool ok = setsockopt(s, SOL_UDP, UDP_SEGMENT, &size, sizeof(size)) == 0;
+    close(s);
+    if (ok) {
+        LogInfo(VB_CHANNELOUT, "UDP GSO enabled\n");
+        return true;
+    }
+    LogInfo(VB_CHANNELOUT, "UDP GSO not supported by the kernel (%s)\n", strerror(errno));
+#else
+    LogInfo(VB_CHANNELOUT, "UDP GSO not supported on this platform\n");
+#endif
+    return false;
+}
 
-                //failed to send all messages or it took more than 100ms to send them
-                LogErr(VB_CHANNELOUT, "sendmmsg() failed for UDP output (key: %X   output count: %d/%d   time: %u ms    errCount: %d) with error: %d   %s\n",
-                       i.id,
-                       outputCount, i.msgs.size(), diff, i.socketInfo->errCount,
-                       errno,
-                       strerror(errno));
-            } else {
-                i.socketInfo->errCount = 0;
-            }
+void UDPOutput::GetStats(Json::Value& result) {
+    double secs = (GetTimeMS() - stats.startTime) / 1000.0;
+    uint64_t frames = stats.frames;
+    uint64_t packets = stats.packets;
+    uint64_t sendCalls = stats.sendCalls;
+
+    result["frames"] = (Json::UInt64)frames;
+    result["packets"] = (Json::UInt64)packets;
+    result["sendCalls"] = (Json::UInt64)sendCalls;
+    result["seconds"] = secs;
+    result["packetsPerSecond"] = secs > 0 ? packets / secs : 0.0;
+    result["packetsPerFrame"] = frames ? (double)packets / frames : 0.0;
+    result["sendCallsPerFrame"] = frames ? (double)sendCalls / frames : 0.0;
+    // CPU time of the prepare (output thread) and the sends (output or
+    // worker threads) in microseconds per frame
+    result["prepCPUPerFrame"] = frames ? stats.prepCPUNanos / 1000.0 / frames : 0.0;
+    result["sendCPUPerFrame"] = frames ? stats.sendCPUNanos / 1000.0 / frames : 0.0;
 
-            doneWorkCount++;
+    Json::Value gso;
+    gso["enabled"] = useGSO;
+    gso["available"] = gsoAvailable.load();
+    gso["sends"] = (Json::UInt64)stats.gsoSends;
+    gso["packets"] = (Json::UInt64)stats.gsoPackets;
+    gso["fallbacks"] = (Json::UInt64)stats.gsoFallbacks;
+    result["gso"] = gso;
+
+    Json::Value ring;
+    ring["backend"] = txBackend == "" ? "sockets" : txBackend;
+    ring["open"] = packetRing && packetRing->IsOpen();
+    if (packetRing) {
+        ring["queued"] = (Json::UInt64)packetRing->framesQueued;
+        ring["kicks"] = (Json::UInt64)packetRing->kicks;
+        ring["unresolved"] = (Json::UInt64)packetRing->unresolved;
+        ring["ringFull"] = (Json::UInt64)packetRing->ringFull;
+        ring["oversize"] = (Json::UInt64)packetRing->oversize;
+    }
+    result["tx"] = ring;
+
+    Json::Value sync;
+    uint64_t syncWaits = stats.syncWaits;
+    sync["waits"] = (Json::UInt64)syncWaits;
+    sync["timeouts"] = (Json::UInt64)stats.syncWaitTimeouts;
+    // microseconds waiting for the data to leave before each sync
+    sync["avgWait"] = syncWaits ? stats.syncWaitNanos / 1000.0 / syncWaits : 0.0;
+    result["sync"] = sync;
+
+    destinationStats.GetStats(result["destinations"]);
+    result["universes"] = Json::Value(Json::arrayValue);
+    for (auto o : outputs) {
+        Json::Value u;
+        o->GetStats(u);
+        result["universes"].append(u);
+    }
+
+    // the worker pool and pacing destinations are created by the output thread
+    std::unique_lock<std::mutex> lk(socketMutex);
+    if (pacingEnabled) {
+        Json::Value pacing;
+        pacing["window"] = PaceWindowNanos() / 1000000.0;
+        pacing["waitPerFrame"] = frames ? stats.paceWaitNanos / 1000.0 / frames : 0.0;
+        for (auto& b : paceBuckets) {
+            struct in_addr a;
+            a.s_addr = b.first;
+            char buf[INET_ADDRSTRLEN];
+            Json::Value d;
+            d["address"] = inet_ntop(AF_INET, &a, buf, sizeof(buf));
+            d["packetsPerMS"] = b.second.packetsPerMS;
+            d["bytesPerMS"] = b.second.bytesPerMS;
+            d["packets"] = (Json::UInt64)b.second.packets;
+            d["bytes"] = (Json::UInt64)b.second.bytes;
+            // frames where the bucket held packets back
+            d["delays"] = (Json::UInt64)b.second.delays;
+            // packets sent unpaced as the window ran out
+            d["overruns"] = (Json::UInt64)b.second.overruns;
+            pacing["destinations"].append(d);
         }
+        result["pacing"] = pacing;
     }
 
-    --numWorkThreads;
+    if (useThreadedOutput) {
+        Json::Value pool;
+        pool["waitPerFrame"] = frames ? stats.workerWaitNanos / 1000.0 / frames : 0.0;
+        pool["timeouts"] = (Json::UInt64)stats.workerTimeouts;
+        for (auto w : workers) {
+            uint64_t items = w->items;
+            Json::Value wj;
+            wj["cpu"] = w->cpu;
+            wj["items"] = (Json::UInt64)items;
+            wj["queueDepth"] = w->depth();
+            wj["maxQueueDepth"] = w->maxDepth.load();
+            // microseconds per work item
+            wj["avgSendTime"] = items ? w->sendNanos / 1000.0 / items : 0.0;
+            wj["maxSendTime"] = w->maxSendNanos / 1000.0;
+            pool["workers"].append(wj);
+        }
+        result["workers"] = pool;
+    }
+}
+void UDPOutput::ResetStats() {
+    stats.frames = 0;
+    stats.packets = 0;
+    stats.sendCalls = 0;
+    stats.gsoSends = 0;
+    stats.gsoPackets = 0;
+    stats.gsoFallbacks = 0;
+    stats.prepCPUNanos = 0;
+    stats.sendCPUNanos = 0;
+    stats.startTime = GetTimeMS();
+    stats.workerWaitNanos = 0;
+    stats.workerTimeouts = 0;
+    stats.paceWaitNanos = 0;
+    stats.syncWaits = 0;
+    stats.syncWaitNanos = 0;
+    stats.syncWaitTimeouts = 0;
+    destinationStats.Reset();
+    for (auto o : outputs) {
+        o->dedupeSkips = 0;
+        o->skippedFrames = 0;
+    }
+    std::unique_lock<std::mutex> lk(socketMutex);
+    for (auto& b : paceBuckets) {
+        b.second.packets = 0;
+        b.second.bytes = 0;
+        b.second.delays = 0;
+        b.second.overruns = 0;
+    }
+    for (auto w : workers) {
+        w->items = 0;
+        w->sendNanos = 0;
+        w->maxSendNanos = 0;
+        w->maxDepth = 0;
+    }
+    if (packetRing) {
+        packetRing->framesQueued = 0;
+        packetRing->kicks = 0;
+        packetRing->unresolved = 0;
+        packetRing->ringFull = 0;
+        packetRing->oversize = 0;
+    }
+}
+
+void UDPOutput::StartWorkers() {
+    int keys = 0;
+    for (auto& msgs : messages.messages) {
+        if (msgs.first < LATE_MESSAGES_KEY) {
+            ++keys;
+        }
+    }
+    int cpus = std::max((int)std::thread::hardware_concurrency(), 1);
+    int count = std::max(std::min(keys, std::min(cpus, 4)), 1);
+    runWorkThreads = true;
+    for (int x = 0; x < count; x++) {
+        Worker* w = new Worker();
+        w->index = x;
+        // leave the first core for the output thread if we can
+        w->cpu = cpus > 1 ? (x % (cpus - 1)) + 1 : -1;
+        w->thread = new std::thread([this, w]() { BackgroundOutputWork(w); });
+        workers.push_back(w);
+    }
+    LogDebug(VB_CHANNELOUT, "Started %d UDP output workers for %d keys\n", count, keys);
+}
+void UDPOutput::StopWorkers() {
+    runWorkThreads = false;
+    for (auto w : workers) {
+        w->wake++;
+        FutexWake(w->wake);
+    }
+    for (auto w : workers) {
+        w->thread->join();
+        delete w->thread;
+        delete w;
+    }
+    workers.clear();
+    keyWorkers.clear();
+}
+UDPOutput::Worker* UDPOutput::GetWorker(unsigned int key) {
+    auto it = keyWorkers.find(key);
+    if (it != keyWorkers.end()) {
+        return it->second;
+    }
+    Worker* w = workers[keyWorkers.size() % workers.size()];
+    keyWorkers[key] = w;
+    return w;
+}
+
+void UDPOutput::BackgroundOutputWork(Worker* w) {
+    TraceManager::INSTANCE.SetThreadName("UDPOutputWorker" + std::to_string(w->index));
+#ifndef PLATFORM_OSX
+    if (w->cpu >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(w->cpu, &cpuset);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset)) {
+            LogDebug(VB_CHANNELOUT, "Could not pin UDP output worker %d to CPU %d\n", w->index, w->cpu);
+        }
+    }
+#endif
+    std::chrono::high_resolution_clock clock;
+    while (runWorkThreads) {
+        uint32_t seq = w->wake.load();
+        WorkItem i;
+        if (!w->pop(i)) {
+            FutexWait(w->wake, seq, 1000000000ULL);
+            continue;
+        }
+        uint64_t start = MonotonicNanos();
+        auto t1 = clock.now();
+        int outputCount = SendMessages(i.id, i.socketInfo, *i.msgs);
+        auto t2 = clock.now();
+
+        long diff = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
+        if ((outputCount != i.msgs->size()) || (diff > 100)) {
+            i.socketInfo->errCount++;
+
+            //failed to send all messages or it took more than 100ms to send them
+            LogErr(VB_CHANNELOUT, "sendmmsg() failed for UDP output (key: %X   output count: %d/%d   time: %u ms    errCount: %d) with error: %d   %s\n",
+                   i.id,
+                   outputCount, i.msgs->size(), diff, i.socketInfo->errCount,
+                   errno,
+                   strerror(errno));
+        } else {
+            i.socketInfo->errCount = 0;
+        }
+        uint64_t nanos = MonotonicNanos() - start;
+        w->items++;
+        w->sendNanos += nanos;
+        if (nanos > w->maxSendNanos) {
+            w->maxSendNanos = nanos;
+        }
+        if (workLatch.fetch_sub(1) == 1) {
+            FutexWake(workLatch);
+        }
+    }
 }
 
 int UDPOutput::SendData(unsigned char* channelData) {
@@ -513,71 +1172,108 @@ int UDPOutput::SendData(unsigned char* channelData) {
     if (!enabled || messages.sendSockets.empty()) {
         return 0;
     }
+    if (pacingEnabled) {
+        return SendDataPaced(lk);
+    }
+    if (packetRing && packetRing->IsOpen()) {
+        return SendDataRing();
+    }
     std::chrono::high_resolution_clock clock;
     if (useThreadedOutput) {
-        doneWorkCount = 0;
+        if (workers.empty()) {
+            StartWorkers();
+        }
+        // the previous frame always drains before SendData returns so
+        // nothing can still be holding a count
+        workLatch.store(0);
         int total = 0;
-        auto t1 = clock.now();
         for (auto& msgs : messages.messages) {
-            if (!msgs.second.empty() && msgs.first < LATE_MULTICAST_MESSAGES_KEY) {
-                SendSocketInfo* socketInfo = findOrCreateSocket(msgs.first, 5);
+            if (!msgs.second.empty() && msgs.first < LATE_MESSAGES_KEY) {
+                WorkItem i;
+                i.id = msgs.first;
+                i.socketInfo = findOrCreateSocket(msgs.first, 5);
+                i.msgs = &msgs.second;
 
-                std::unique_lock<std::mutex> lock(workMutex);
-                workQueue.push_back(WorkItem(msgs.first, socketInfo, msgs.second));
-                lock.unlock();
-                workSignal.notify_one();
+                Worker* w = GetWorker(msgs.first);
+                workLatch++;
+                if (!w->push(i)) {
+                    // worker is way behind, send it from here
+                    workLatch--;
+                    SendMessages(i.id, i.socketInfo, *i.msgs);
+                    continue;
+                }
+                uint32_t d = w->depth();
+                if (d > w->maxDepth) {
+                    w->maxDepth = d;
+                }
                 ++total;
             }
         }
-        std::unique_lock<std::mutex> lock(workMutex);
-        while (numWorkThreads < workQueue.size()) {
-            std::thread(DoWorkThread, this).detach();
-            numWorkThreads++;
+        for (auto w : workers) {
+            if (w->depth()) {
+                w->wake++;
+                FutexWake(w->wake);
+            }
         }
-        if (workQueue.size()) {
-            workSignal.notify_all();
+
+        FPP_TRACE_SPAN_ARG("UDPOutput::WaitForWorkers", total);
+        uint64_t start = MonotonicNanos();
+        uint64_t deadline = start + 50000000ULL;
+        bool timedOut = false;
+        uint32_t outstanding = workLatch.load();
+        while (outstanding) {
+            uint64_t now = MonotonicNanos();
+            if (!timedOut && now >= deadline) {
+                // the work items point into messages which PrepData clears
+                // for the next frame so we cannot leave without the workers,
+                // just note that the frame is late and keep waiting
+                timedOut = true;
+                ++stats.workerTimeouts;
+                LogDebug(VB_CHANNELOUT, "UDP output workers still have %d items after 50ms\n", outstanding);
+            }
+            FutexWait(workLatch, outstanding, timedOut ? 100000000ULL : deadline - now);
+            outstanding = workLatch.load();
         }
-        lock.unlock();
-        auto t2 = clock.now();
-        while (doneWorkCount != total && std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count() < 50) {
-            std::this_thread::sleep_for(std::chrono::microseconds(250));
-            t2 = clock.now();
-        }
-        if (doneWorkCount == total) {
-            //now output the LATE/Broadcast packets (likely sync packets)
-            for (auto& msgs : messages.messages) {
-                if (!msgs.second.empty()) {
-                    SendSocketInfo* socketInfo = findOrCreateSocket(msgs.first, 5);
-                    if (msgs.first >= LATE_MULTICAST_MESSAGES_KEY) {
-                        t1 = clock.now();
-                        int outputCount = SendMessages(msgs.first, socketInfo, msgs.second);
-                        t2 = clock.now();
-                        long diff = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
-                        if ((outputCount != msgs.second.size()) || (diff > 100)) {
-                            socketInfo->errCount++;
-
-                            //failed to send all messages or it took more than 100ms to send them
-                            LogErr(VB_CHANNELOUT, "sendmmsg() failed for UDP output (key: %X   output count: %d/%d   time: %u ms    errCount: %d) with error: %d   %s\n",
-                                   msgs.first,
-                                   outputCount, msgs.second.size(), diff, socketInfo->errCount,
-                                   errno,
-                                   strerror(errno));
-                        } else {
-                            socketInfo->errCount = 0;
-                        }
-                    }
-                    if (socketInfo->errCount >= 3) {
-                        //we'll ping the controllers and rebuild the valid message list, this could take time
-                        pingThreadCondition.notify_all();
+        stats.workerWaitNanos += MonotonicNanos() - start;
+        //now output the LATE/Broadcast packets (likely sync packets)
+        WaitForSendQueues();
+        for (auto& msgs : messages.messages) {
+            if (!msgs.second.empty()) {
+                SendSocketInfo* socketInfo = findOrCreateSocket(msgs.first, 5);
+                if (msgs.first >= LATE_MESSAGES_KEY) {
+                    auto t1 = clock.now();
+                    int outputCount = SendMessages(msgs.first, socketInfo, msgs.second);
+                    auto t2 = clock.now();
+                    long diff = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
+                    if ((outputCount != msgs.second.size()) || (diff > 100)) {
+                        socketInfo->errCount++;
+
+                        //failed to send all messages or it took more than 100ms to send them
+                        LogErr(VB_CHANNELOUT, "sendmmsg() failed for UDP output (key: %X   output count: %d/%d   time: %u ms    errCount: %d) with error: %d   %s\n",
+                               msgs.first,
+                               outputCount, msgs.second.size(), diff, socketInfo->errCount,
+                               errno,
+                               strerror(errno));
+                    } else {
                         socketInfo->errCount = 0;
                     }
                 }
+                if (socketInfo->errCount >= 3) {
+                    //we'll ping the controllers and rebuild the valid message list, this could take time
+                    pingThreadCondition.notify_all();
+                    socketInfo->errCount = 0;
+                }
             }
         }
         return 1;
     }
+    bool waited = false;
     for (auto& msgs : messages.messages) {
         if (!msgs.second.empty()) {
+            if (msgs.first >= LATE_MESSAGES_KEY && !waited) {
+                WaitForSendQueues();
+                waited = true;
+            }
             SendSocketInfo* socketInfo = findOrCreateSocket(msgs.first, 5);
             auto t1 = clock.now();
             int outputCount = SendMessages(msgs.first, socketInfo, msgs.second);
@@ -606,11 +1302,264 @@ int UDPOutput::SendData(unsigned char* channelData) {
     return 1;
 }
 
+int UDPOutput::SendDataRing() {
+    // everything is written into the ring from this thread, no need for
+    // the workers, the kernel is kicked once for the whole frame
+    FPP_TRACE_SPAN("UDPOutput::SendDataRing");
+    uint64_t cpuStart = ThreadCPUNanos();
+    ringUnsent.clear();
+    int queued = 0;
+    for (auto& msgs : messages.messages) {
+        if (!msgs.second.empty() && msgs.first < LATE_MESSAGES_KEY) {
+            queued += packetRing->Queue(&msgs.second[0], msgs.second.size(), ringUnsent);
+        }
+    }
+    packetRing->Flush();
+    stats.packets += queued;
+    ++stats.sendCalls;
+    stats.sendCPUNanos += ThreadCPUNanos() - cpuStart;
+
+    // anything the ring couldn't take (unknown neighbour, ring full) and then
+    // the LATE/Broadcast packets (likely sync packets) go out the normal way
+    if (!ringUnsent.empty()) {
+        SendSocketInfo* socketInfo = findOrCreateSocket(ANY_MESSAGES_KEY, 5);
+        SendMessages(ANY_MESSAGES_KEY, socketInfo, ringUnsent);
+    }
+    SendLateMessages();
+    return 1;
+}
+
+void UDPOutput::SendLateMessages() {
+    auto late = messages.messages.lower_bound(LATE_MESSAGES_KEY);
+    bool any = false;
+    for (auto it = late; it != messages.messages.end(); ++it) {
+        any |= !it->second.empty();
+    }
+    if (!any) {
+        return;
+    }
+    WaitForSendQueues();
+    for (auto& msgs : messages.messages) {
+        if (!msgs.second.empty() && msgs.first >= LATE_MESSAGES_KEY) {
+            SendSocketInfo* socketInfo = findOrCreateSocket(msgs.first, 5);
+            int outputCount = SendMessages(msgs.first, socketInfo, msgs.second);
+            if (outputCount != msgs.second.size()) {
+                LogErr(VB_CHANNELOUT, "sendmmsg() failed for UDP output (key: %X   output count: %d/%d) with error: %d   %s\n",
+                       msgs.first, outputCount, msgs.second.size(), errno, strerror(errno));
+            }
+        }
+    }
+}
+
+bool UDPOutput::WaitForSendQueues() {
+    // Wait (bounded) for the data already handed to the sockets to actually
+    // be sent so the controllers have all of it before the sync arrives
+#ifndef PLATFORM_OSX
+    if (syncWaitUS <= 0) {
+        return true;
+    }
+    uint64_t start = MonotonicNanos();
+    uint64_t deadline = start + syncWaitUS * 1000ULL;
+    ++stats.syncWaits;
+    while (true) {
+        bool empty = true;
+        for (auto& si : messages.sendSockets) {
+            if (si.first >= LATE_MESSAGES_KEY || si.second == nullptr) {
+                continue;
+            }
+            for (int sock : si.second->sockets) {
+                int outq = 0;
+                if (sock >= 0 && ioctl(sock, SIOCOUTQ, &outq) == 0 && outq > 0) {
+                    empty = false;
+                    break;
+                }
+            }
+            if (!empty) {
+                break;
+            }
+        }
+        uint64_t now = MonotonicNanos();
+        if (empty || now >= deadline) {
+            stats.syncWaitNanos += now - start;
+            if (!empty) {
+                ++stats.syncWaitTimeouts;
+            }
+            return empty;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+    }
+#else
+    return true;
+#endif
+}
+
+void UDPOutput::PaceBucket::Refill(uint64_t now) {
+    double ms = (now - lastRefill) / 1000000.0;
+    lastRefill = now;
+    // allow up to 1ms worth (at least one full packet) to build up
+    if (packetsPerMS > 0) {
+        packetTokens = std::min(packetTokens + ms * packetsPerMS, std::max(packetsPerMS, 1.0));
+    }
+    if (bytesPerMS > 0) {
+        byteTokens = std::min(byteTokens + ms * bytesPerMS, std::max(bytesPerMS, 1500.0));
+    }
+}
+int UDPOutput::PaceBucket::Allowance(int maxCount, uint64_t& waitNanos) {
+    int count = 0;
+    while (count < maxCount) {
+        const struct msghdr& m = pending[next + count].msg_hdr;
+        size_t len = 0;
+        for (size_t x = 0; x < m.msg_iovlen; x++) {
+            len += m.msg_iov[x].iov_len;
+        }
+        double wait = 0;
+        if (packetsPerMS > 0 && packetTokens < 1.0) {
+            wait = (1.0 - packetTokens) / packetsPerMS;
+        }
+        if (bytesPerMS > 0 && byteTokens < len) {
+            wait = std::max(wait, (len - byteTokens) / bytesPerMS);
+        }
+        if (wait > 0) {
+            waitNanos = std::min(waitNanos, (uint64_t)(wait * 1000000.0) + 1);
+            break;
+        }
+        packetTokens -= 1.0;
+        byteTokens -= len;
+        ++count;
+    }
+    return count;
+}
+
+UDPOutput::PaceBucket* UDPOutput::GetPaceBucket(in_addr_t addr) {
+    auto it = paceBuckets.find(addr);
+    if (it != paceBuckets.end()) {
+        return &it->second;
+    }
+    PaceBucket& b = paceBuckets[addr];
+    auto o = paceOverrides.find(addr);
+    if (o != paceOverrides.end()) {
+        b.packetsPerMS = o->second.first;
+        b.bytesPerMS = o->second.second;
+    } else {
+        b.packetsPerMS = pacePackets;
+        b.bytesPerMS = paceBytes;
+    }
+    b.packetTokens = std::max(b.packetsPerMS, 1.0);
+    b.byteTokens = std::max(b.bytesPerMS, 1500.0);
+    b.lastRefill = MonotonicNanos();
+    return &b;
+}
+
+uint64_t UDPOutput::PaceWindowNanos() const {
+    // leave part of the frame for the sync packets and the next frame's
+    // prep, a configured window is still capped at the frame period
+    float rate = GetChannelOutputRefreshRate();
+    uint64_t period = rate > 0 ? (uint64_t)(1000000000.0 / rate) : 25000000ULL;
+    if (paceWindowMS > 0) {
+        return std::min((uint64_t)paceWindowMS * 1000000, period);
+    }
+    return std::clamp(period * 6 / 10, (uint64_t)2000000ULL, (uint64_t)40000000ULL);
+}
+
+int UDPOutput::SendDataPaced(std::unique_lock<std::mutex>& lk) {
+    FPP_TRACE_SPAN("UDPOutput::SendDataPaced");
+    uint64_t start = MonotonicNanos();
+    uint64_t deadline = start + PaceWindowNanos();
+
+    // split the frame up by destination
+    paceActive.clear();
+    for (auto& msgs : messages.messages) {
+        if (!msgs.second.empty() && msgs.first < LATE_MESSAGES_KEY) {
+            SendSocketInfo* socketInfo = findOrCreateSocket(msgs.first, 5);
+            for (auto& m : msgs.second) {
+                struct sockaddr_in* dest = (struct sockaddr_in*)m.msg_hdr.msg_name;
+                PaceBucket* b = GetPaceBucket(dest->sin_addr.s_addr);
+                if (b->pending.empty()) {
+                    b->key = msgs.first;
+                    b->socketInfo = socketInfo;
+                    b->next = 0;
+                    paceActive.push_back(b);
+                }
+                b->pending.push_back(m);
+            }
+        }
+    }
+
+    // round robin across the destinations, each sending what its bucket
+    // allows, until everything is out
+    uint64_t waited = 0;
+    while (!paceActive.empty()) {
+        uint64_t now = MonotonicNanos();
+        bool late = now >= deadline;
+        uint64_t waitNanos = UINT64_MAX;
+        for (int x = 0; x < paceActive.size();) {
+            PaceBucket* b = paceActive[x];
+            int left = b->pending.size() - b->next;
+            int count = left;
+            if (late) {
+                b->overruns += left;
+            } else if (b->packetsPerMS > 0 || b->bytesPerMS > 0) {
+                b->Refill(now);
+                count = b->Allowance(left, waitNanos);
+                if (count < left) {
+                    ++b->delays;
+                }
+            }
+            if (count) {
+                int sent = SendMessages(b->key, b->socketInfo, &b->pending[b->next], count);
+                size_t len = 0;
+                for (int m = 0; m < sent; m++) {
+                    const struct msghdr& h = b->pending[b->next + m].msg_hdr;
+                    for (size_t i = 0; i < h.msg_iovlen; i++) {
+                        len += h.msg_iov[i].iov_len;
+                    }
+                }
+                b->packets += sent;
+                b->bytes += len;
+                b->next += count;
+            }
+            if (b->next == b->pending.size()) {
+                b->pending.clear();
+                paceActive[x] = paceActive.back();
+                paceActive.pop_back();
+            } else {
+                ++x;
+            }
+        }
+        if (!paceActive.empty() && waitNanos != UINT64_MAX) {
+            waitNanos = std::min(waitNanos, deadline - std::min(deadline, MonotonicNanos()));
+            // don't hold up GetStats or CloseNetwork while waiting on the
+            // buckets, the sockets may have been closed while unlocked
+            lk.unlock();
+            std::this_thread::sleep_for(std::chrono::nanoseconds(waitNanos));
+            lk.lock();
+            waited += waitNanos;
+            if (messages.sendSockets.empty()) {
+                for (auto b : paceActive) {
+                    b->pending.clear();
+                }
+                paceActive.clear();
+                break;
+            }
+            for (auto b : paceActive) {
+                b->socketInfo = findOrCreateSocket(b->key, 5);
+            }
+        }
+    }
+    stats.paceWaitNanos += waited;
+
+    SendLateMessages();
+    return 1;
+}
+
 void UDPOutput::BackgroundThreadPing() {
     std::unique_lock<std::mutex> lk(pingThreadMutex);
     pingThreadCondition.wait_for(lk, std::chrono::seconds(10));
     while (runPingThread) {
         PingControllers();
+        for (auto o : outputs) {
+            o->NetworkChanged();
+        }
         pingThreadCondition.wait_for(lk, std::chrono::seconds(15));
     }
 }
@@ -729,6 +1678,9 @@ void UDPOutput::DumpConfig() {
 void UDPOutput::CloseNetwork() {
     std::unique_lock<std::mutex> lk(socketMutex);
     messages.clearSockets();
+    if (packetRing) {
+        packetRing->Close();
+    }
     lk.unlock();
     PingControllers();
 }
@@ -817,6 +1769,18 @@ bool UDPOutput::InitNetwork() {
 
     int broadcastSocket = createSocket(0, true);
     messages.ForceSocket(BROADCAST_MESSAGES_KEY, broadcastSocket);
+
+    if (txBackend == "packet_mmap") {
+        if (!packetRing) {
+            packetRing = new UDPPacketRing();
+        }
+        if (!packetRing->IsOpen() && !packetRing->Open(e131Interface)) {
+            LogWarn(VB_CHANNELOUT, "Could not open PACKET_MMAP ring on %s, using sockets\n", e131Interface.c_str());
+        }
+    }
+    for (auto o : outputs) {
+        o->NetworkChanged();
+    }
     return true;
 }
 
@@ -23,12 +23,18 @@
 #include "SysSocket.h"
 #include <netinet/in.h>
 
+#include "ChannelChangeMap.h"
 #include "ChannelOutput.h"
 
 typedef void CURLM;
+class UDPPacketRing;
 
 #define MULTICAST_MESSAGES_KEY 0x00000001
 #define ANY_MESSAGES_KEY 0x00000002
+// keys from LATE_MESSAGES_KEY up are sent after all the data has gone out
+// (sync packets)
+#define LATE_MESSAGES_KEY 0xFFFFFFF0
+#define LATE_ARTNET_MESSAGES_KEY 0xFFFFFFF0
 #define LATE_MULTICAST_MESSAGES_KEY 0xFFFFFFFE
 #define BROADCAST_MESSAGES_KEY 0xFFFFFFFF
 
@@ -39,14 +45,21 @@ public:
     UDPOutputMessages();
     ~UDPOutputMessages();
 
-    void ForceSocket(unsigned int key, int socket);
+    // if owned, the socket is closed when the network is shut down
+    void ForceSocket(unsigned int key, int socket, bool owned = true);
     int GetSocket(unsigned int key);
 
     std::vector<struct mmsghdr>& GetMessages(unsigned int key);
     std::vector<struct mmsghdr>& operator[](unsigned int key) { return GetMessages(key); }
 
+    // Outputs with a prebuilt send plan reserve room for all their messages
+    // up front and hold onto the returned list (the map never moves it) so
+    // preparing a frame doesn't need the lookup or any allocation.
+    std::vector<struct mmsghdr>* ReserveMessages(unsigned int key, int count);
+
 private:
     std::map<unsigned int, std::vector<struct mmsghdr>> messages;
+    std::map<unsigned int, int> reservedCounts;
     std::map<unsigned int, SendSocketInfo*> sendSockets;
 
     void clearMessages();
@@ -55,6 +68,44 @@ private:
     friend class UDPOutput;
 };
 
+// Per destination (controller IP or multicast group) send counters.  Slots
+// are claimed with a CAS on the address so the output thread and the
+// workers can update them without locking.  The latency histogram counts
+// the send calls that carried the destination's packets, each timed as a
+// whole.  It shows batches that were slow for the destination, not the
+// destination's own share of the call.
+class UDPDestinationStats {
+public:
+    static constexpr int MAX_DESTINATIONS = 1024;
+    static constexpr int LATENCY_BUCKETS = 10;
+
+    class Counters {
+    public:
+        void Reset();
+
+        std::atomic_uint64_t packets;
+        std::atomic_uint64_t bytes;
+        std::atomic_uint64_t eagain;
+        std::atomic_uint64_t enobufs;
+        std::atomic_uint64_t errors;
+        std::atomic_uint64_t latency[LATENCY_BUCKETS];
+        std::atomic_llong lastSuccess;
+    };
+
+    UDPDestinationStats();
+
+    // nullptr if the table is full
+    Counters* Get(in_addr_t addr);
+    static void AddLatency(Counters* c, uint64_t nanos);
+
+    void GetStats(Json::Value& result);
+    void Reset();
+
+private:
+    std::atomic<in_addr_t> addresses[MAX_DESTINATIONS];
+    Counters counters[MAX_DESTINATIONS];
+};
+
 class UDPOutputData {
 public:
     UDPOutputData(const Json::Value& config);
@@ -65,6 +116,14 @@ public:
     virtual void PrepareData(unsigned char* channelData, UDPOutputMessages& msgs) = 0;
     virtual void PostPrepareData(unsigned char* channelData, UDPOutputMessages& msgs) {}
 
+    // called once the outputs are configured so outputs that can prebuild
+    // their messages can resolve where they will send them
+    virtual void BuildSendPlan(UDPOutputMessages& msgs) {}
+
+    // called from the network/ping threads when the network may have
+    // changed (interface up, periodic re-check), not from the output thread
+    virtual void NetworkChanged() {}
+
     virtual void DumpConfig() = 0;
 
     virtual void GetRequiredChannelRange(int& min, int& max) {
@@ -77,6 +136,10 @@ public:
 
     virtual const std::string& GetOutputTypeString() const;
 
+    virtual void GetStats(Json::Value& result);
+
+    void SetChangeMap(const ChannelChangeMap* c) { changes = c; }
+
     static in_addr_t toInetAddr(const std::string& ip, bool& valid);
 
     std::string description;
@@ -89,6 +152,15 @@ public:
     bool monitor;
 
     int failCount;
+    // ranges not sent because they didn't change, and frames where at
+    // least one range was skipped
+    std::atomic_uint64_t dedupeSkips{ 0 };
+    std::atomic_uint64_t skippedFrames{ 0 };
+
+    // optional pacing for this destination, overrides the output wide
+    // setting, 0 is unlimited
+    double pacePackets = 0;
+    double paceBytes = 0;
 
     UDPOutputData(UDPOutputData const&) = delete;
     void operator=(UDPOutputData const& x) = delete;
@@ -97,8 +169,24 @@ protected:
     void SaveFrame(unsigned char* channelData, int len);
     bool NeedToOutputFrame(unsigned char* channelData, int startChannel, int savedIdx, int count);
     bool deDuplicate = false;
-    int skippedFrames;
     unsigned char* lastData;
+    int lastDataSize = 0;
+
+    // with deDuplicate, everything is still resent every keepAliveMS so
+    // controllers with a data timeout don't blank unchanged universes
+    int keepAliveMS = 1000;
+    long long lastKeepAlive = 0;
+    bool keepAliveFrame = false;
+
+    // when the change map is available, it is used instead of comparing
+    // against lastData.  savedGeneration is the generation last sent.
+    const ChannelChangeMap* changes = nullptr;
+    uint32_t savedGeneration = 0;
+
+    // prebuilt send plan, the message list for this output's socket key and
+    // the channel data the plan's iovecs currently point into
+    std::vector<struct mmsghdr>* sendTarget = nullptr;
+    unsigned char* planChannelData = nullptr;
 };
 
 class UDPOutput : public ChannelOutput {
@@ -111,6 +199,7 @@ public:
 
     virtual void PrepData(unsigned char* channelData) override;
     virtual int SendData(unsigned char* channelData) override;
+    virtual void PrepDataWithChanges(unsigned char* channelData, const ChannelChangeMap& changes) override;
 
     virtual void DumpConfig(void) override;
 
@@ -123,13 +212,24 @@ public:
 
     static UDPOutput* INSTANCE;
 
-    void BackgroundOutputWork();
-
     virtual void StartingOutput() override;
     virtual void StoppingOutput() override;
 
+    virtual void GetStats(Json::Value& stats) override;
+    virtual void ResetStats() override;
+
 private:
     int SendMessages(unsigned int key, SendSocketInfo* socketInfo, std::vector<struct mmsghdr>& sendmsgs);
+    int SendMessages(unsigned int key, SendSocketInfo* socketInfo, struct mmsghdr* msgs, int msgCount);
+    int SendMessagesGSO(int sendSocket, SendSocketInfo* socketInfo, struct mmsghdr* msgs, int msgCount);
+    bool ProbeGSO();
+    void UpdateDestinationStats(struct mmsghdr* msgs, int sent, uint64_t nanos);
+    UDPDestinationStats destinationStats;
+    int SendDataRing();
+    int SendDataPaced(std::unique_lock<std::mutex>& lk);
+    uint64_t PaceWindowNanos() const;
+    void SendLateMessages();
+    bool WaitForSendQueues();
     struct sockaddr_in localAddress;
     std::string e131Interface;
 
@@ -154,20 +254,140 @@ private:
 
     class WorkItem {
     public:
-        WorkItem(unsigned int i, SendSocketInfo* si, std::vector<struct mmsghdr>& m) :
-            id(i),
-            socketInfo(si),
-            msgs(m) {}
-        unsigned int id;
-        SendSocketInfo* socketInfo;
-        std::vector<struct mmsghdr>& msgs;
+        unsigned int id = 0;
+        SendSocketInfo* socketInfo = nullptr;
+        std::vector<struct mmsghdr>* msgs = nullptr;
     };
 
-    std::mutex workMutex;
-    std::condition_variable workSignal;
-    std::list<WorkItem> workQueue;
-    std::atomic_int doneWorkCount;
-    std::atomic_int numWorkThreads;
+    // Threaded output uses a fixed pool of pinned workers.  Each message key
+    // is always sent by the same worker so each worker owns its sockets.
+    // Work is handed over through a single producer/single consumer ring
+    // per worker and the output thread waits on a futex latch (workLatch
+    // counts the outstanding items) instead of polling.  The items point
+    // into messages so SendData always waits for the latch to drain, a
+    // slow frame is only counted in workerTimeouts.
+    class Worker {
+    public:
+        static constexpr uint32_t QUEUE_SIZE = 256;
+
+        bool push(const WorkItem& i) {
+            uint32_t h = head.load(std::memory_order_relaxed);
+            if ((h - tail.load(std::memory_order_acquire)) >= QUEUE_SIZE) {
+                return false;
+            }
+            queue[h % QUEUE_SIZE] = i;
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+        bool pop(WorkItem& i) {
+            uint32_t t = tail.load(std::memory_order_relaxed);
+            if (t == head.load(std::memory_order_acquire)) {
+                return false;
+            }
+            i = queue[t % QUEUE_SIZE];
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+        uint32_t depth() const {
+            return head.load(std::memory_order_relaxed) - tail.load(std::memory_order_relaxed);
+        }
+
+        int index = 0;
+        int cpu = -1;
+        std::thread* thread = nullptr;
+        std::atomic_uint32_t wake{ 0 };
+
+        std::atomic_uint64_t items{ 0 };
+        std::atomic_uint64_t sendNanos{ 0 };
+        std::atomic_uint64_t maxSendNanos{ 0 };
+        std::atomic_uint32_t maxDepth{ 0 };
+
+    private:
+        WorkItem queue[QUEUE_SIZE];
+        std::atomic_uint32_t head{ 0 };
+        std::atomic_uint32_t tail{ 0 };
+    };
+    void StartWorkers();
+    void StopWorkers();
+    void BackgroundOutputWork(Worker* worker);
+    Worker* GetWorker(unsigned int key);
+
+    std::vector<Worker*> workers;
+    std::map<unsigned int, Worker*> keyWorkers;
+    std::atomic_uint32_t workLatch;
     volatile bool runWorkThreads;
     bool useThreadedOutput;
+
+    // Generic Segmentation Offload.  Runs of same size packets to the same
+    // destination are handed to the kernel as one send with UDP_SEGMENT,
+    // gsoAvailable is cleared if the kernel or NIC refuses it.
+    bool useGSO;
+    std::atomic_bool gsoAvailable;
+
+    // "packet_mmap" builds the frames into a PACKET_MMAP TX ring instead of
+    // using the sockets, see UDPPacketRing.h
+    std::string txBackend;
+    UDPPacketRing* packetRing;
+    std::vector<struct mmsghdr> ringUnsent;
+
+    // Per destination pacing.  Each destination gets a token bucket
+    // (packets and/or bytes per ms) and the frame's packets are sent
+    // interleaved across the destinations as the buckets allow instead
+    // of as one burst per socket.  Anything still queued at the end of
+    // the window is sent unpaced and counted as an overrun.  The window is
+    // paceWindowMS if set (capped at the frame period), otherwise 60% of
+    // the frame period, 2-40ms.  socketMutex is released while waiting.
+    class PaceBucket {
+    public:
+        void Refill(uint64_t now);
+        int Allowance(int maxCount, uint64_t& waitNanos);
+
+        double packetsPerMS = 0;
+        double bytesPerMS = 0;
+        double packetTokens = 0;
+        double byteTokens = 0;
+        uint64_t lastRefill = 0;
+
+        unsigned int key = 0;
+        SendSocketInfo* socketInfo = nullptr;
+        std::vector<struct mmsghdr> pending;
+        size_t next = 0;
+
+        std::atomic_uint64_t packets{ 0 };
+        std::atomic_uint64_t bytes{ 0 };
+        std::atomic_uint64_t delays{ 0 };
+        std::atomic_uint64_t overruns{ 0 };
+    };
+    PaceBucket* GetPaceBucket(in_addr_t addr);
+
+    bool pacingEnabled;
+    double pacePackets;
+    double paceBytes;
+    int paceWindowMS;
+    std::map<in_addr_t, std::pair<double, double>> paceOverrides;
+    std::map<in_addr_t, PaceBucket> paceBuckets;
+    std::vector<PaceBucket*> paceActive;
+
+    // max time (us) to wait for the data to leave the sockets before sending
+    // the sync packets
+    int syncWaitUS;
+
+    class SendStats {
+    public:
+        std::atomic_uint64_t frames{ 0 };
+        std::atomic_uint64_t packets{ 0 };
+        std::atomic_uint64_t sendCalls{ 0 };
+        std::atomic_uint64_t gsoSends{ 0 };
+        std::atomic_uint64_t gsoPackets{ 0 };
+        std::atomic_uint64_t gsoFallbacks{ 0 };
+        std::atomic_uint64_t prepCPUNanos{ 0 };
+        std::atomic_uint64_t sendCPUNanos{ 0 };
+        std::atomic_uint64_t startTime{ 0 };
+        std::atomic_uint64_t workerWaitNanos{ 0 };
+        std::atomic_uint64_t workerTimeouts{ 0 };
+        std::atomic_uint64_t paceWaitNanos{ 0 };
+        std::atomic_uint64_t syncWaits{ 0 };
+        std::atomic_uint64_t syncWaitNanos{ 0 };
+        std::atomic_uint64_t syncWaitTimeouts{ 0 };
+    } stats;
 };
@@ -0,0 +1,402 @@
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include "fpp-pch.h"
+
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <netinet/ip.h>
+#include <netinet/udp.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifndef PLATFORM_OSX
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#endif
+
+#include "../common.h"
+#include "../log.h"
+
+#include "UDPPacketRing.h"
+
+// neighbour entries are re-read this often so a replaced controller
+// (same IP, new MAC) is picked up
+#define NEIGHBOUR_REFRESH_MS 5000
+// but not more often than this when looking for a missing entry
+#define NEIGHBOUR_RETRY_MS 500
+
+#define ETH_HEADER_LEN 14
+#define IP_HEADER_LEN 20
+#define UDP_HEADER_LEN 8
+#define FRAME_HEADERS_LEN (ETH_HEADER_LEN + IP_HEADER_LEN + UDP_HEADER_LEN)
+
+UDPPacketRing::UDPPacketRing() :
+    fd(-1),
+    portSocket(-1),
+    ring(nullptr),
+    ringSize(0),
+    frameSize(2048),
+    frameCount(0),
+    curFrame(0),
+    pending(0),
+    mtu(1500),
+    loopback(false),
+    srcAddr(0),
+    netmask(0),
+    gateway(0),
+    srcPort(0),
+    ipId(0),
+    neighboursLoaded(0) {
+    memset(srcMAC, 0, sizeof(srcMAC));
+}
+UDPPacketRing::~UDPPacketRing() {
+    Close();
+}
+
+#ifdef PLATFORM_OSX
+bool UDPPacketRing::Open(const std::string& iface, int fc) {
+    LogWarn(VB_CHANNELOUT, "PACKET_MMAP transmit is not available on this platform\n");
+    return false;
+}
+void UDPPacketRing::Close() {
+}
+int UDPPacketRing::Queue(struct mmsghdr* msgs, int count, std::vector<struct mmsghdr>& unsent) {
+    for (int x = 0; x < count; x++) {
+        unsent.push_back(msgs[x]);
+    }
+    return 0;
+}
+void UDPPacketRing::Flush() {
+}
+bool UDPPacketRing::Resolve(in_addr_t dst, uint8_t* mac) {
+    return false;
+}
+void UDPPacketRing::LoadNeighbours() {
+}
+#else
+
+bool UDPPacketRing::Open(const std::string& iface, int fc) {
+    Close();
+    ifName = iface;
+
+    char addr[16], mask[16], gw[16];
+    GetInterfaceAddress(iface.c_str(), addr, mask, gw);
+    srcAddr = inet_addr(addr);
+    netmask = inet_addr(mask);
+    gateway = gw[0] ? inet_addr(gw) : 0;
+
+    fd = socket(AF_PACKET, SOCK_RAW, 0);
+    if (fd < 0) {
+        LogWarn(VB_CHANNELOUT, "Could not create PACKET_MMAP socket: %s\n", strerror(errno));
+        return false;
+    }
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, iface.c_str(), IFNAMSIZ - 1);
+    if (ioctl(fd, SIOCGIFINDEX, &ifr) < 0) {
+        LogWarn(VB_CHANNELOUT, "Could not get index of %s: %s\n", iface.c_str(), strerror(errno));
+        Close();
+        return false;
+    }
+    int ifIndex = ifr.ifr_ifindex;
+    if (ioctl(fd, SIOCGIFFLAGS, &ifr) == 0) {
+        loopback = (ifr.ifr_flags & IFF_LOOPBACK) != 0;
+    }
+    if (ioctl(fd, SIOCGIFMTU, &ifr) == 0) {
+        mtu = ifr.ifr_mtu;
+    }
+    if (ioctl(fd, SIOCGIFHWADDR, &ifr) == 0) {
+        memcpy(srcMAC, ifr.ifr_hwaddr.sa_data, 6);
+    }
+
+    int v = TPACKET_V2;
+    if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &v, sizeof(v)) < 0) {
+        LogWarn(VB_CHANNELOUT, "Could not set TPACKET_V2: %s\n", strerror(errno));
+        Close();
+        return false;
+    }
+    // frames don't need to go through the qdisc, the output thread already
+    // paces things, not fatal if the kernel doesn't support it
+    v = 1;
+    setsockopt(fd, SOL_PACKET, PACKET_QDISC_BYPASS, &v, sizeof(v));
+
+    int pageSize = getpagesize();
+    int blockSize = pageSize;
+    while (blockSize < frameSize * 16) {
+        blockSize *= 2;
+    }
+    int framesPerBlock = blockSize / frameSize;
+    int blockCount = (fc + framesPerBlock - 1) / framesPerBlock;
+    frameCount = blockCount * framesPerBlock;
+
+    struct tpacket_req req;
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = blockSize;
+    req.tp_block_nr = blockCount;
+    req.tp_frame_size = frameSize;
+    req.tp_frame_nr = frameCount;
+    if (setsockopt(fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) < 0) {
+        LogWarn(VB_CHANNELOUT, "Could not create PACKET_TX_RING: %s\n", strerror(errno));
+        Close();
+        return false;
+    }
+    ringSize = (size_t)blockSize * blockCount;
+    void* m = mmap(nullptr, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED) {
+        LogWarn(VB_CHANNELOUT, "Could not map PACKET_TX_RING: %s\n", strerror(errno));
+        ring = nullptr;
+        Close();
+        return false;
+    }
+    ring = (uint8_t*)m;
+    curFrame = 0;
+    pending = 0;
+
+    struct sockaddr_ll sll;
+    memset(&sll, 0, sizeof(sll));
+    sll.sll_family = AF_PACKET;
+    sll.sll_protocol = htons(ETH_P_IP);
+    sll.sll_ifindex = ifIndex;
+    if (bind(fd, (struct sockaddr*)&sll, sizeof(sll)) < 0) {
+        LogWarn(VB_CHANNELOUT, "Could not bind PACKET_MMAP socket to %s: %s\n", iface.c_str(), strerror(errno));
+        Close();
+        return false;
+    }
+
+    // hold a normal UDP socket open so the source port is ours and the
+    // kernel doesn't answer replies from the controllers with port unreachable
+    portSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = srcAddr;
+    socklen_t slen = sizeof(sin);
+    if (portSocket < 0 || bind(portSocket, (struct sockaddr*)&sin, sizeof(sin)) < 0 ||
+        getsockname(portSocket, (struct sockaddr*)&sin, &slen) < 0) {
+        LogWarn(VB_CHANNELOUT, "Could not reserve a UDP source port on %s: %s\n", iface.c_str(), strerror(errno));
+        Close();
+        return false;
+    }
+    srcPort = ntohs(sin.sin_port);
+    ipId = (uint16_t)GetTimeMS();
+
+    neighbours.clear();
+    LoadNeighbours();
+
+    LogInfo(VB_CHANNELOUT, "PACKET_MMAP transmit ring on %s: %d frames, MTU %d, %s:%d\n",
+            iface.c_str(), frameCount, mtu, addr, (int)srcPort);
+    return true;
+}
+
+void UDPPacketRing::Close() {
+    if (ring) {
+        munmap(ring, ringSize);
+        ring = nullptr;
+    }
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    if (portSocket >= 0) {
+        close(portSocket);
+        portSocket = -1;
+    }
+    pending = 0;
+}
+
+void UDPPacketRing::LoadNeighbours() {
+    neighboursLoaded = GetTimeMS();
+    FILE* f = fopen("/proc/net/arp", "r");
+    if (!f) {
+        return;
+    }
+    neighbours.clear();
+    char line[256];
+    // IP address  HW type  Flags  HW address  Mask  Device
+    if (fgets(line, sizeof(line), f)) {
+        while (fgets(line, sizeof(line), f)) {
+            char ip[64], hw[64], dev[64];
+            unsigned int type, flags;
+            char msk[64];
+            if (sscanf(line, "%63s 0x%x 0x%x %63s %63s %63s", ip, &type, &flags, hw, msk, dev) != 6) {
+                continue;
+            }
+            if (!(flags & ATF_COM) || ifName != dev) {
+                continue;
+            }
+            unsigned int b[6];
+            if (sscanf(hw, "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6) {
+                continue;
+            }
+            std::array<uint8_t, 6> mac;
+            for (int x = 0; x < 6; x++) {
+                mac[x] = b[x];
+            }
+            neighbours[inet_addr(ip)] = mac;
+        }
+    }
+    fclose(f);
+}
+
+bool UDPPacketRing::Resolve(in_addr_t dst, uint8_t* mac) {
+    uint32_t h = ntohl(dst);
+    if ((h & 0xF0000000) == 0xE0000000) {
+        mac[0] = 0x01;
+        mac[1] = 0x00;
+        mac[2] = 0x5E;
+        mac[3] = (h >> 16) & 0x7F;
+        mac[4] = (h >> 8) & 0xFF;
+        mac[5] = h & 0xFF;
+        return true;
+    }
+    if (dst == INADDR_BROADCAST || (netmask != INADDR_BROADCAST && (dst | netmask) == INADDR_BROADCAST)) {
+        memset(mac, 0xFF, 6);
+        return true;
+    }
+    if (loopback) {
+        memset(mac, 0, 6);
+        return true;
+    }
+    in_addr_t hop = dst;
+    if (((dst ^ srcAddr) & netmask) != 0 && gateway) {
+        hop = gateway;
+    }
+    auto it = neighbours.find(hop);
+    if (it == neighbours.end()) {
+        if ((GetTimeMS() - neighboursLoaded) < NEIGHBOUR_RETRY_MS) {
+            return false;
+        }
+        LoadNeighbours();
+        it = neighbours.find(hop);
+        if (it == neighbours.end()) {
+            return false;
+        }
+    }
+    memcpy(mac, &it->second[0], 6);
+    return true;
+}
+
+static inline uint16_t IPChecksum(const uint16_t* hdr) {
+    uint32_t sum = 0;
+    for (int x = 0; x < IP_HEADER_LEN / 2; x++) {
+        sum += hdr[x];
+    }
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return ~sum;
+}
+
+int UDPPacketRing::Queue(struct mmsghdr* msgs, int count, std::vector<struct mmsghdr>& unsent) {
+    if (fd < 0) {
+        unsent.insert(unsent.end(), msgs, msgs + count);
+        return 0;
+    }
+    if ((GetTimeMS() - neighboursLoaded) > NEIGHBOUR_REFRESH_MS) {
+        LoadNeighbours();
+    }
+    const int dataOffset = TPACKET2_HDRLEN - sizeof(struct sockaddr_ll);
+    const int maxPayload = std::min(mtu - IP_HEADER_LEN - UDP_HEADER_LEN, frameSize - dataOffset - FRAME_HEADERS_LEN);
+
+    int queued = 0;
+    uint8_t mac[6];
+    for (int m = 0; m < count; m++) {
+        struct msghdr& hdr = msgs[m].msg_hdr;
+        struct sockaddr_in* dest = (struct sockaddr_in*)hdr.msg_name;
+
+        int payload = 0;
+        for (size_t i = 0; i < hdr.msg_iovlen; i++) {
+            payload += hdr.msg_iov[i].iov_len;
+        }
+        if (payload > maxPayload) {
+            // would need IP fragmentation, let the kernel do it
+            ++oversize;
+            unsent.push_back(msgs[m]);
+            continue;
+        }
+        if (!Resolve(dest->sin_addr.s_addr, mac)) {
+            ++unresolved;
+            unsent.push_back(msgs[m]);
+            continue;
+        }
+        struct tpacket2_hdr* th = (struct tpacket2_hdr*)(ring + (size_t)curFrame * frameSize);
+        uint32_t status = __atomic_load_n(&th->tp_status, __ATOMIC_ACQUIRE);
+        if (status == TP_STATUS_WRONG_FORMAT) {
+            status = TP_STATUS_AVAILABLE;
+        }
+        if (status != TP_STATUS_AVAILABLE) {
+            // driver hasn't caught up, everything left goes the normal way
+            ringFull += count - m;
+            unsent.insert(unsent.end(), msgs + m, msgs + count);
+            break;
+        }
+
+        uint8_t* frame = (uint8_t*)th + dataOffset;
+        memcpy(frame, mac, 6);
+        memcpy(frame + 6, srcMAC, 6);
+        frame[12] = ETH_P_IP >> 8;
+        frame[13] = ETH_P_IP & 0xFF;
+
+        struct iphdr* ip = (struct iphdr*)(frame + ETH_HEADER_LEN);
+        ip->version = 4;
+        ip->ihl = IP_HEADER_LEN / 4;
+        ip->tos = 0;
+        ip->tot_len = htons(IP_HEADER_LEN + UDP_HEADER_LEN + payload);
+        ip->id = htons(ipId++);
+        ip->frag_off = htons(IP_DF);
+        ip->ttl = (mac[0] == 0x01) ? 1 : 64;
+        ip->protocol = IPPROTO_UDP;
+        ip->check = 0;
+        ip->saddr = srcAddr;
+        ip->daddr = dest->sin_addr.s_addr;
+        ip->check = IPChecksum((const uint16_t*)ip);
+
+        // UDP checksum is optional for IPv4 and none of the controllers
+        // need it, leave it 0
+        struct udphdr* udp = (struct udphdr*)(frame + ETH_HEADER_LEN + IP_HEADER_LEN);
+        udp->source = htons(srcPort);
+        udp->dest = dest->sin_port;
+        udp->len = htons(UDP_HEADER_LEN + payload);
+        udp->check = 0;
+
+        uint8_t* p = frame + FRAME_HEADERS_LEN;
+        for (size_t i = 0; i < hdr.msg_iovlen; i++) {
+            memcpy(p, hdr.msg_iov[i].iov_base, hdr.msg_iov[i].iov_len);
+            p += hdr.msg_iov[i].iov_len;
+        }
+        th->tp_len = FRAME_HEADERS_LEN + payload;
+        __atomic_store_n(&th->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+
+        curFrame = (curFrame + 1) % frameCount;
+        ++queued;
+    }
+    pending += queued;
+    framesQueued += queued;
+    return queued;
+}
+
+void UDPPacketRing::Flush() {
+    if (fd < 0 || !pending) {
+        return;
+    }
+    // a blocking send with no data tells the kernel to transmit everything
+    // marked SEND_REQUEST and returns once it's been handed to the driver
+    if (send(fd, nullptr, 0, 0) < 0) {
+        LogDebug(VB_CHANNELOUT, "PACKET_MMAP kick failed: %s\n", strerror(errno));
+    }
+    pending = 0;
+    ++kicks;
+}
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "SysSocket.h"
+#include <netinet/in.h>
+
+/*
+ * Kernel bypass transmit path for the UDP outputs.  Complete Ethernet, IP
+ * and UDP frames are built straight into a PACKET_MMAP TX ring shared with
+ * the kernel and the ring is kicked once per frame, skipping the socket
+ * layer and the per packet syscall work of sendmmsg.
+ *
+ * Destination MACs come from the kernel's neighbour table (or the gateway's
+ * entry for off subnet hosts).  Anything that can't go in the ring (no
+ * neighbour entry yet, ring full, larger than the MTU) is handed back to be
+ * sent through the normal sockets, which also gets the kernel to ARP for
+ * hosts it doesn't know yet.
+ *
+ * Needs CAP_NET_RAW.  Works on any interface including veth pairs and
+ * loopback which makes it easy to test.
+ */
+class UDPPacketRing {
+public:
+    UDPPacketRing();
+    ~UDPPacketRing();
+
+    bool Open(const std::string& iface, int frameCount = 4096);
+    void Close();
+    bool IsOpen() const { return fd >= 0; }
+
+    // build frames for the messages into the ring, returns the number
+    // queued, messages that couldn't be queued are added to unsent
+    int Queue(struct mmsghdr* msgs, int count, std::vector<struct mmsghdr>& unsent);
+
+    // hand everything queued to the driver
+    void Flush();
+
+    std::atomic_uint64_t framesQueued{ 0 };
+    std::atomic_uint64_t unresolved{ 0 };
+    std::atomic_uint64_t ringFull{ 0 };
+    std::atomic_uint64_t oversize{ 0 };
+    std::atomic_uint64_t kicks{ 0 };
+
+private:
+    bool Resolve(in_addr_t dst, uint8_t* mac);
+    void LoadNeighbours();
+
+    std::string ifName;
+    int fd;
+    int portSocket;
+    uint8_t* ring;
+    size_t ringSize;
+    int frameSize;
+    int frameCount;
+    int curFrame;
+    int pending;
+
+    int mtu;
+    bool loopback;
+    uint8_t srcMAC[6];
+    in_addr_t srcAddr;
+    in_addr_t netmask;
+    in_addr_t gateway;
+    uint16_t srcPort;
+    uint16_t ipId;
+
+    std::map<in_addr_t, std::array<uint8_t, 6>> neighbours;
+    long long neighboursLoaded;
+};
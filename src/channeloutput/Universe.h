@@ -23,9 +23,6 @@ typedef struct {
     uint32_t startAddress;
     uint32_t type;
     char unicastAddress[16];
-    uint32_t bytesReceived;
-    uint32_t packetsReceived;
-    uint32_t errorPackets;
     uint32_t lastSequenceNumber;
     uint32_t priority;
 } UniverseEntry;
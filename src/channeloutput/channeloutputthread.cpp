@@ -13,6 +13,8 @@
 #include "fpp-pch.h"
 
 #include <sys/time.h>
+#include <algorithm>
+#include <cmath>
 #include <errno.h>
 #include <mutex>
 #include <pthread.h>
@@ -23,13 +25,16 @@
 #include <unistd.h>
 
 #include "ChannelOutputSetup.h"
+#include "channeloutputthread.h"
 #include "MultiSync.h"
 #include "Sequence.h"
 #include "common.h"
+#include "e131bridge.h"
 #include "effects.h"
 #include "fppd.h"
 #include "log.h"
 #include "settings.h"
+#include "Trace.h"
 #include "overlays/PixelOverlay.h"
 
 #include "mediaoutput/SDLOut.h"
@@ -57,8 +62,47 @@ std::mutex outputThreadStatusLock;
 std::condition_variable outputThreadCond;
 std::condition_variable outputThreadSatusCond;
 
+/* frame clock PLL tuning */
+#define FRAME_CLOCK_LOCK_SECONDS 2.0f      // time constant for pulling in phase errors
+#define FRAME_CLOCK_DAMPING 0.7f
+#define FRAME_CLOCK_MAX_SLEW 0.10f         // max deviation from the nominal frame period
+#define FRAME_CLOCK_MAX_STEP 0.02f         // max change of the frame period per update
+#define FRAME_CLOCK_HARD_JUMP_SECONDS 0.5f // larger errors seek instead of slewing
+
+class FrameClockState {
+public:
+    long lastFrame = -1;
+    // a hard jump was requested, lastFrame is taken from the frame
+    // number once the skip has been applied
+    bool jumped = false;
+    float correction = 0.0;
+    float integral = 0.0;
+
+    uint64_t updates = 0;
+    uint64_t hardJumps = 0;
+    uint64_t saturated = 0;
+    float lastError = 0.0;
+    float avgAbsError = 0.0;
+    float maxAbsError = 0.0;
+};
+static FrameClockState frameClock;
+static std::mutex frameClockLock;
+
+/* deadline aware frame drop policy */
+#define FRAME_LATE_TOLERANCE_DIVISOR 4 // loops later than 1/4 of a frame count as behind
+#define FRAME_BEHIND_DROP_FRAMES 2     // jump to the newest frame once this far behind
+
+static thread_local bool frameOverBudget = false;
+static thread_local bool frameStageSkipped = false;
+static long long avgProcessTime = 0;
+static std::atomic<uint64_t> droppedFrames(0);
+static std::atomic<uint64_t> frameDropEvents(0);
+static std::atomic<uint64_t> skippedStages[(int)OptionalFrameStage::COUNT];
+
 /* prototypes for functions below */
 void CalculateNewChannelOutputDelayForFrame(int expectedFramesSent);
+static void UpdateFrameClock(float expectedFrame);
+static void ResetFrameClock(void);
 
 /*
  * Check to see if the channel output thread is running
@@ -93,6 +137,38 @@ void ForceChannelOutputNow(void) {
     outputThreadCond.notify_all();
 }
 
+/*
+ * Called by the optional processing stages to check if they should be
+ * skipped for the frame currently being processed.  Only frames processed
+ * by the output thread have a deadline, everything else runs all stages.
+ */
+bool SkipOptionalFrameStage(OptionalFrameStage stage) {
+    if (!frameOverBudget) {
+        return false;
+    }
+    skippedStages[(int)stage]++;
+    frameStageSkipped = true;
+    return true;
+}
+
+void GetFrameDropStats(Json::Value& result) {
+    static const char* stageNames[] = { "overlayEffects", "videoOverlay", "optionalOutputs" };
+    result["droppedFrames"] = (Json::UInt64)droppedFrames;
+    result["dropEvents"] = (Json::UInt64)frameDropEvents;
+    result["avgProcessTime"] = (Json::Int64)avgProcessTime;
+    for (int x = 0; x < (int)OptionalFrameStage::COUNT; x++) {
+        result["skippedStages"][stageNames[x]] = (Json::UInt64)skippedStages[x];
+    }
+}
+
+void ResetFrameDropStats(void) {
+    droppedFrames = 0;
+    frameDropEvents = 0;
+    for (int x = 0; x < (int)OptionalFrameStage::COUNT; x++) {
+        skippedStages[x] = 0;
+    }
+}
+
 static inline bool forceOutput() {
     return IsEffectRunning() ||
            PixelOverlayManager::INSTANCE.hasActiveOverlays() ||
@@ -116,10 +192,13 @@ void* RunChannelOutputThread(void* data) {
     struct timespec ts;
     struct timeval tv;
     int slowFrameCount = 0;
+    long long lastStartTime = 0;
+    long long behindTime = 0;
 
     alwaysTransmit = getSettingInt("alwaysTransmit");
 
     LogDebug(VB_CHANNELOUT, "RunChannelOutputThread() starting\n");
+    TraceManager::INSTANCE.SetThreadName("ChannelOutput");
 
     std::unique_lock<std::mutex> lock(outputThreadLock);
     std::unique_lock<std::mutex> statusLock(outputThreadStatusLock);
@@ -145,6 +224,26 @@ void* RunChannelOutputThread(void* data) {
     bool doForceOutput = false;
     while (RunThread) {
         startTime = GetTime();
+
+        // Keep track of how far behind schedule we are.  Small amounts of
+        // lateness are normal wakeup jitter, but if we fall more than a couple
+        // frames behind we jump straight to the newest frame rather than
+        // playing every stale frame late.
+        long long lateTime = lastStartTime ? (startTime - (lastStartTime + LightDelay)) : 0;
+        lastStartTime = startTime;
+        if (!doForceOutput && (channelOutputFrame > 1) && (lateTime > (LightDelay / FRAME_LATE_TOLERANCE_DIVISOR))) {
+            behindTime += lateTime;
+        } else {
+            behindTime = 0;
+        }
+        if ((behindTime >= (FRAME_BEHIND_DROP_FRAMES * LightDelay)) && sequence->IsSequenceRunning() && (getFPPmode() != REMOTE_MODE) && (FrameSkip == 0)) {
+            int frames = behindTime / LightDelay;
+            LogDebug(VB_CHANNELOUT, "Output thread is %lldus behind, dropping %d frames at frame %ld\n", behindTime, frames, channelOutputFrame);
+            FrameSkip = frames;
+            droppedFrames += frames;
+            frameDropEvents++;
+            behindTime = 0;
+        }
         if (multiSync->isMultiSyncEnabled() && sequence->IsSequenceRunning()) {
             multiSync->SendSeqSyncPacket(
                 sequence->m_seqFilename, channelOutputFrame,
@@ -154,7 +253,10 @@ void* RunChannelOutputThread(void* data) {
 
         doForceOutput |= forceOutput();
         if (OutputFrames) {
+            FPP_TRACE_SPAN_ARG("OutputThread::Send", channelOutputFrame);
+            uint64_t bridgeArrival = 0;
             if (!sequence->isDataProcessed() || sequence->hasBridgeData()) {
+                bridgeArrival = Bridge_TakeOldestArrival();
                 //first time through or immediately after sequence load, the data might not be
                 //processed yet, need to do it
                 int msTime = 1000.0 * channelOutputFrame / RefreshRate;
@@ -172,11 +274,15 @@ void* RunChannelOutputThread(void* data) {
                 }
             }
             sequence->SendSequenceData();
+            if (bridgeArrival) {
+                Bridge_FrameSent(bridgeArrival);
+            }
         }
 
         sendTime = GetTime();
 
         if (sequence->IsSequenceRunning() || (onceMore >= 1)) {
+            FPP_TRACE_SPAN("OutputThread::Read");
             if (FrameSkip && sequence->IsSequenceRunning()) {
                 sequence->SeekSequenceFile(channelOutputFrame + FrameSkip + 1);
                 FrameSkip = 0;
@@ -191,9 +297,19 @@ void* RunChannelOutputThread(void* data) {
         }
         if (!sequence->hasBridgeData()) {
             //if bridging, we'll have to process later
+            FPP_TRACE_SPAN("OutputThread::Process");
+            // if what is left of this frame's time isn't enough to process a
+            // full frame, the optional stages are skipped
+            frameOverBudget = (readTime + avgProcessTime) > (startTime + LightDelay);
+            frameStageSkipped = false;
             sequence->ProcessSequenceData(msTime, 1);
+            frameOverBudget = false;
         }
         processTime = GetTime();
+        if (!frameStageSkipped) {
+            // only full frames are used so the estimate doesn't drop when stages are skipped
+            avgProcessTime = (avgProcessTime * 7 + (processTime - readTime)) / 8;
+        }
 
         long long totalTime = processTime - startTime;
         if (totalTime > 150000) {
@@ -261,6 +377,7 @@ void* RunChannelOutputThread(void* data) {
         // Calculate how long we need to nanosleep()
         long dt = (LightDelay - (GetTime() - startTime)) * 1000;
         if (RunThread && dt > 0) {
+            FPP_TRACE_SPAN("OutputThread::Sleep");
             if (outputThreadCond.wait_for(lock, std::chrono::nanoseconds(dt)) == std::cv_status::no_timeout) {
                 LogDebug(VB_CHANNELOUT, "Forced output\n");
                 doForceOutput = true;
@@ -290,6 +407,7 @@ void SetChannelOutputRefreshRate(float rate) {
     RefreshRate = rate;
     SequenceLightDelay = 1000000 / RefreshRate;
     LightDelay = SequenceLightDelay;
+    ResetFrameClock();
 }
 float GetChannelOutputRefreshRate() {
     return RefreshRate;
@@ -424,81 +542,128 @@ void CalculateNewChannelOutputDelay(float mediaPosition) {
 
     float offsetMediaPosition = mediaPosition - mediaOffset;
 
-    int expectedFramesSent = (int)(offsetMediaPosition * RefreshRate);
+    float expectedFramesSent = offsetMediaPosition * RefreshRate;
 
     LogDebug(VB_CHANNELOUT,
-             "Media Position: %.2f, Offset: %.3f, Frames Sent: %d, Expected: %d, Diff: %d\n",
+             "Media Position: %.2f, Offset: %.3f, Frames Sent: %d, Expected: %.1f, Diff: %.1f\n",
              mediaPosition, mediaOffset, channelOutputFrame, expectedFramesSent,
              channelOutputFrame - expectedFramesSent);
 
-    CalculateNewChannelOutputDelayForFrame(expectedFramesSent);
+    UpdateFrameClock(expectedFramesSent);
 }
 
 /*
  * Calculate the new sync offset based on a desired frame number
  */
 void CalculateNewChannelOutputDelayForFrame(int expectedFramesSent) {
-    int diff = channelOutputFrame - expectedFramesSent;
-    if (!multiSync->isMultiSyncEnabled()) {
-        if (diff < -4) {
-            // pretty far behind master, lets just skip forward
-            if (diff > -(RefreshRate / 2)) {
-                LogDebug(VB_CHANNELOUT, "Skipping a few frames - We are at %d, master is at: %d\n", channelOutputFrame, expectedFramesSent);
-                // off, but not super off, we'll skip a few frames, but not too much to try and keep using
-                // the frames in the cache and avoid hitting the storage, we'll then have the OS preload
-                // the next bunch and we can skip a few more next time
-                FrameSkip = 4;
-                diff += 4;
-            } else {
-                LogDebug(VB_CHANNELOUT, "Skipping many frames - We are at %d, master is at: %d\n", channelOutputFrame, expectedFramesSent);
-                //more than 1/2 second behind, just jump
-                FrameSkip = expectedFramesSent - channelOutputFrame;
-                LightDelay = sequence->IsSequenceRunning() ? SequenceLightDelay : BridgeLightDelay;
-                return;
-            }
-        } else if (diff > 2) {
-            //hold the last frame
-            FrameSkip = -1;
-            diff--;
-        }
-    }
+    UpdateFrameClock(expectedFramesSent);
+}
+
+/*
+ * Frame clock PLL.  The frame period (LightDelay) is steered by a PI
+ * controller so the frames output track the reference clock (media
+ * position or the MultiSync master) without the stutter that skipping
+ * or holding frames causes.  Only errors larger than
+ * FRAME_CLOCK_HARD_JUMP_SECONDS are corrected by seeking.
+ */
+static void UpdateFrameClock(float expectedFrame) {
+    std::unique_lock<std::mutex> lock(frameClockLock);
+
     int DefaultLightDelay = sequence->IsSequenceRunning() ? SequenceLightDelay : BridgeLightDelay;
-    if (diff > 1 || diff < -1) {
-        int timerOffset = diff * (DefaultLightDelay / 100);
-        int newLightDelay = LightDelay;
-        if (channelOutputFrame > expectedFramesSent) {
-            // correct if we slingshot past 0, otherwise offset further
-            if (LightDelay < DefaultLightDelay)
-                newLightDelay = DefaultLightDelay;
-            else
-                newLightDelay += timerOffset;
-        } else {
-            // correct if we slingshot past 0, otherwise offset further
-            if (LightDelay > DefaultLightDelay)
-                newLightDelay = DefaultLightDelay;
-            else
-                newLightDelay += timerOffset;
+    long curFrame = channelOutputFrame;
+    if (frameClock.jumped) {
+        if (FrameSkip) {
+            // the output thread hasn't seeked yet, the error is meaningless
+            return;
         }
+        frameClock.jumped = false;
+        frameClock.lastFrame = curFrame;
+    }
+    if ((frameClock.lastFrame < 0) || (curFrame < frameClock.lastFrame)) {
+        // new sequence or we were seeked backwards, start tracking from scratch
+        frameClock.correction = 0.0;
+        frameClock.integral = 0.0;
+        frameClock.lastFrame = curFrame;
+    }
+    float dt = curFrame - frameClock.lastFrame;
+    if (dt < 1.0) {
+        dt = 1.0;
+    }
+    frameClock.lastFrame = curFrame;
+
+    // positive error means we are ahead of the reference clock
+    float error = curFrame - expectedFrame;
+    float absError = std::fabs(error);
+    frameClock.updates++;
+    frameClock.lastError = error;
+    frameClock.avgAbsError = (frameClock.updates == 1) ? absError : (frameClock.avgAbsError * 0.95 + absError * 0.05);
+    if (absError > frameClock.maxAbsError) {
+        frameClock.maxAbsError = absError;
+    }
 
-        // Don't let us go more than 15ms out from the default.  If we
-        // can't keep up using that delta then we probably won't be able to.
-        if ((DefaultLightDelay - 15000) > newLightDelay)
-            newLightDelay = DefaultLightDelay - 15000;
-
-        LogDebug(VB_CHANNELOUT, "LightDelay: %d, newLightDelay: %d,   DiffFrames: %d     %d/%d\n",
-                 LightDelay, newLightDelay, diff, channelOutputFrame, expectedFramesSent);
-        LightDelay = newLightDelay;
-    } else if (diff == -1) {
-        //for the one frame off cases, keep the existing light delay unless the
-        //previous "off" frame was on the other side of default
-        if (LightDelay > DefaultLightDelay) {
-            LightDelay = DefaultLightDelay;
-        }
-    } else if (diff == 1) {
-        if (LightDelay < DefaultLightDelay) {
-            LightDelay = DefaultLightDelay;
-        }
-    } else if (LightDelay != DefaultLightDelay) {
-        LightDelay = DefaultLightDelay;
+    float hardJumpFrames = std::max(FRAME_CLOCK_HARD_JUMP_SECONDS * RefreshRate, 4.0f);
+    if (!multiSync->isMultiSyncEnabled() && (absError > hardJumpFrames)) {
+        // too far off to slew back in a reasonable amount of time, jump to the
+        // expected frame but keep the integral term as it tracks clock drift
+        int expected = (int)std::lround(expectedFrame);
+        LogDebug(VB_CHANNELOUT, "Frame clock jumping - We are at %ld, expected: %d\n", curFrame, expected);
+        FrameSkip = expected - curFrame;
+        frameClock.jumped = true;
+        frameClock.correction = frameClock.integral;
+        frameClock.hardJumps++;
+        LightDelay = DefaultLightDelay * (1.0 + frameClock.correction);
+        return;
+    }
+
+    float horizon = FRAME_CLOCK_LOCK_SECONDS * RefreshRate;
+    float kp = 2.0 * FRAME_CLOCK_DAMPING / horizon;
+    float ki = 1.0 / (horizon * horizon);
+
+    frameClock.integral = std::clamp(frameClock.integral + ki * error * dt, -FRAME_CLOCK_MAX_SLEW, FRAME_CLOCK_MAX_SLEW);
+    float correction = kp * error + frameClock.integral;
+    if ((correction > FRAME_CLOCK_MAX_SLEW) || (correction < -FRAME_CLOCK_MAX_SLEW)) {
+        correction = std::clamp(correction, -FRAME_CLOCK_MAX_SLEW, FRAME_CLOCK_MAX_SLEW);
+        frameClock.saturated++;
     }
+    // bound how quickly the frame period is allowed to change
+    correction = std::clamp(correction, frameClock.correction - FRAME_CLOCK_MAX_STEP, frameClock.correction + FRAME_CLOCK_MAX_STEP);
+    frameClock.correction = correction;
+
+    int newLightDelay = DefaultLightDelay * (1.0 + correction);
+    LogExcess(VB_CHANNELOUT, "LightDelay: %d, newLightDelay: %d,   Error: %.2f   Correction: %.2f%%   %ld/%.1f\n",
+              LightDelay, newLightDelay, error, correction * 100.0, curFrame, expectedFrame);
+    LightDelay = newLightDelay;
+}
+
+static void ResetFrameClock(void) {
+    std::unique_lock<std::mutex> lock(frameClockLock);
+    frameClock.lastFrame = -1;
+    frameClock.jumped = false;
+    frameClock.correction = 0.0;
+    frameClock.integral = 0.0;
+}
+
+void GetFrameClockStats(Json::Value& result) {
+    std::unique_lock<std::mutex> lock(frameClockLock);
+    result["refreshRate"] = RefreshRate;
+    result["nominalDelay"] = SequenceLightDelay;
+    result["lightDelay"] = LightDelay;
+    result["updates"] = (Json::UInt64)frameClock.updates;
+    result["hardJumps"] = (Json::UInt64)frameClock.hardJumps;
+    result["saturated"] = (Json::UInt64)frameClock.saturated;
+    result["lastError"] = frameClock.lastError;
+    result["avgAbsError"] = frameClock.avgAbsError;
+    result["maxAbsError"] = frameClock.maxAbsError;
+    result["correctionPct"] = frameClock.correction * 100.0;
+    result["driftPct"] = frameClock.integral * 100.0;
+}
+
+void ResetFrameClockStats(void) {
+    std::unique_lock<std::mutex> lock(frameClockLock);
+    frameClock.updates = 0;
+    frameClock.hardJumps = 0;
+    frameClock.saturated = 0;
+    frameClock.lastError = 0.0;
+    frameClock.avgAbsError = 0.0;
+    frameClock.maxAbsError = 0.0;
 }
@@ -29,3 +29,16 @@ void ResetMasterPosition(void);
 void UpdateMasterPosition(int frameNumber);
 void CalculateNewChannelOutputDelay(float mediaPosition);
 void CalculateNewChannelOutputDelayForFrame(int expectedFramesSent);
+void GetFrameClockStats(Json::Value& result);
+void ResetFrameClockStats(void);
+
+// Deadline aware frame drop policy
+enum class OptionalFrameStage {
+    OverlayEffects = 0,
+    VideoOverlay,
+    OptionalOutputs,
+    COUNT
+};
+bool SkipOptionalFrameStage(OptionalFrameStage stage);
+void GetFrameDropStats(Json::Value& result);
+void ResetFrameDropStats(void);
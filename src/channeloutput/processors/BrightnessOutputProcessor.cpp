@@ -13,6 +13,7 @@
 #include "fpp-pch.h"
 
 #include "BrightnessOutputProcessor.h"
+#include "OutputProcessorKernels.h"
 
 BrightnessOutputProcessor::BrightnessOutputProcessor(const Json::Value& config) {
     description = config["desription"].asString();
@@ -47,7 +48,9 @@ BrightnessOutputProcessor::~BrightnessOutputProcessor() {
 }
 
 void BrightnessOutputProcessor::ProcessData(unsigned char* channelData) const {
-    for (int x = 0; x < count; x++) {
-        channelData[start + x] = table[channelData[start + x]];
-    }
+    OutputProcessorKernels::Get().lut(channelData + start, count, table);
+}
+
+void BrightnessOutputProcessor::AddToPlan(OutputProcessorPlan& plan) const {
+    plan.addLUT(start, count, table);
 }
@@ -13,6 +13,7 @@
 #include "fpp-pch.h"
 
 #include "ColorOrderOutputProcessor.h"
+#include "OutputProcessorKernels.h"
 
 
 ColorOrderOutputProcessor::ColorOrderOutputProcessor(const Json::Value& config) {
@@ -25,6 +26,35 @@ ColorOrderOutputProcessor::ColorOrderOutputProcessor(const Json::Value& config)
             start, start + (count * 3) - 1,
             order);
 
+    // perm[x] is the source channel within the pixel for output channel x
+    perm[0] = 0;
+    perm[1] = 1;
+    perm[2] = 2;
+    switch (order) {
+    case 132:
+        perm[1] = 2;
+        perm[2] = 1;
+        break;
+    case 213:
+        perm[0] = 1;
+        perm[1] = 0;
+        break;
+    case 231:
+        perm[0] = 1;
+        perm[1] = 2;
+        perm[2] = 0;
+        break;
+    case 312:
+        perm[0] = 2;
+        perm[1] = 0;
+        perm[2] = 1;
+        break;
+    case 321:
+        perm[0] = 2;
+        perm[2] = 0;
+        break;
+    }
+
     //channel numbers need to be 0 based
     --start;
 }
@@ -33,34 +63,11 @@ ColorOrderOutputProcessor::~ColorOrderOutputProcessor() {
 }
 
 void ColorOrderOutputProcessor::ProcessData(unsigned char* channelData) const {
-    int cur = start;
-    for (int x = 0; x < count; x++, cur += 3) {
-        int a = channelData[cur];
-        int b = channelData[cur + 1];
-        int c = channelData[cur + 2];
-        switch (order) {
-        case 132:
-            channelData[cur + 1] = c;
-            channelData[cur + 2] = b;
-            break;
-        case 213:
-            channelData[cur] = b;
-            channelData[cur + 1] = a;
-            break;
-        case 231:
-            channelData[cur] = b;
-            channelData[cur + 1] = c;
-            channelData[cur + 2] = a;
-            break;
-        case 312:
-            channelData[cur] = c;
-            channelData[cur + 1] = a;
-            channelData[cur + 2] = b;
-            break;
-        case 321:
-            channelData[cur] = c;
-            channelData[cur + 2] = a;
-            break;
-        }
+    if (perm[0] != 0 || perm[1] != 1 || perm[2] != 2) {
+        OutputProcessorKernels::Get().permute3(channelData + start, count, perm);
     }
 }
+
+void ColorOrderOutputProcessor::AddToPlan(OutputProcessorPlan& plan) const {
+    plan.addPermute(start, count, perm);
+}
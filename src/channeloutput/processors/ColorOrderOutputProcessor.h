@@ -21,6 +21,7 @@ public:
     virtual void ProcessData(unsigned char* channelData) const override;
 
     virtual OutputProcessorType getType() const override { return COLORORDER; }
+    virtual void AddToPlan(OutputProcessorPlan& plan) const override;
 
     virtual void GetRequiredChannelRanges(const std::function<void(int, int)>& addRange) override {
         addRange(start, start + (count * 3) - 1);
@@ -30,4 +31,5 @@ protected:
     int start;
     int count;
     int order;
+    uint8_t perm[3];
 };
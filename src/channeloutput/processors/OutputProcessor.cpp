@@ -22,22 +22,72 @@
 #include "SetValueOutputProcessor.h"
 #include "ThreeToFourOutputProcessor.h"
 
-OutputProcessors::OutputProcessors() {
+OutputProcessors::OutputProcessors() :
+    current(nullptr),
+    readerEpoch(0) {
+    readers[0] = 0;
+    readers[1] = 0;
 }
 OutputProcessors::~OutputProcessors() {
-    for (OutputProcessor* a : processors) {
-        delete a;
-    }
-    processors.clear();
+    delete current.exchange(nullptr);
 }
 
 void OutputProcessors::ProcessData(unsigned char* channelData) const {
-    std::lock_guard<std::mutex> lock(processorsLock);
-    for (OutputProcessor* a : processors) {
+    // register in the counter for the current epoch and make sure the
+    // epoch didn't flip underneath us, otherwise a writer that already
+    // drained that counter could free the set we are about to use
+    uint32_t epoch = readerEpoch.load();
+    uint32_t idx = epoch & 1;
+    readers[idx].fetch_add(1);
+    while (readerEpoch.load() != epoch) {
+        readers[idx].fetch_sub(1, std::memory_order_release);
+        epoch = readerEpoch.load();
+        idx = epoch & 1;
+        readers[idx].fetch_add(1);
+    }
+    const ProcessorSet* set = current.load();
+    if (set) {
+        set->plan.ProcessData(channelData);
+    }
+    readers[idx].fetch_sub(1, std::memory_order_release);
+}
+
+std::vector<std::shared_ptr<OutputProcessor>> OutputProcessors::currentProcessors() const {
+    const ProcessorSet* set = current.load();
+    if (set) {
+        return set->processors;
+    }
+    return std::vector<std::shared_ptr<OutputProcessor>>();
+}
+
+void OutputProcessors::publish(std::vector<std::shared_ptr<OutputProcessor>>&& procs) {
+    ProcessorSet* set = new ProcessorSet();
+    set->processors = std::move(procs);
+    for (auto& a : set->processors) {
         if (a->isActive()) {
-            a->ProcessData(channelData);
+            a->AddToPlan(set->plan);
         }
     }
+    set->plan.finish();
+    set->plan.dump();
+
+    ProcessorSet* old = current.exchange(set);
+    if (old) {
+        waitForReaders();
+        delete old;
+    }
+}
+
+void OutputProcessors::waitForReaders() {
+    // anyone that could have picked up the old set registered in the
+    // counter for the current epoch before the swap.  The reader side
+    // increments then re-checks the epoch and the writer flips the epoch
+    // then checks the counter, both seq_cst, so either the writer sees the
+    // reader's count or the reader sees the new epoch and backs out.
+    uint32_t idx = readerEpoch.fetch_add(1) & 1;
+    while (readers[idx].load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::microseconds(250));
+    }
 }
 
 void OutputProcessors::addProcessor(OutputProcessor* p) {
@@ -45,37 +95,47 @@ void OutputProcessors::addProcessor(OutputProcessor* p) {
         return;
     }
     std::lock_guard<std::mutex> lock(processorsLock);
-    processors.push_back(p);
+    std::vector<std::shared_ptr<OutputProcessor>> procs = currentProcessors();
+    procs.push_back(std::shared_ptr<OutputProcessor>(p));
+    publish(std::move(procs));
 }
 void OutputProcessors::removeProcessor(OutputProcessor* p) {
     std::lock_guard<std::mutex> lock(processorsLock);
-    processors.remove(p);
-}
-void OutputProcessors::removeAll() {
-    std::lock_guard<std::mutex> lock(processorsLock);
-    for (OutputProcessor* a : processors) {
-        delete a;
-    }
-    processors.clear();
+    std::vector<std::shared_ptr<OutputProcessor>> procs = currentProcessors();
+    procs.erase(std::remove_if(procs.begin(), procs.end(), [p](const std::shared_ptr<OutputProcessor>& a) { return a.get() == p; }), procs.end());
+    publish(std::move(procs));
 }
 
 void OutputProcessors::loadFromJSON(const Json::Value& config, bool clear) {
-    if (clear) {
-        removeAll();
-    }
+    std::vector<std::shared_ptr<OutputProcessor>> procs;
     for (Json::Value::const_iterator itr = config.begin(); itr != config.end(); ++itr) {
         std::string name = itr.key().asString();
         if (name == "outputProcessors") {
             Json::Value val = *itr;
             if (val.isArray()) {
                 for (int x = 0; x < val.size(); x++) {
-                    addProcessor(create(val[x]));
+                    OutputProcessor* p = create(val[x]);
+                    if (p) {
+                        procs.push_back(std::shared_ptr<OutputProcessor>(p));
+                    }
                 }
             } else {
-                addProcessor(create(val));
+                OutputProcessor* p = create(val);
+                if (p) {
+                    procs.push_back(std::shared_ptr<OutputProcessor>(p));
+                }
             }
         }
     }
+
+    // swap the whole new set in at once so the output never sees a
+    // partially loaded configuration
+    std::lock_guard<std::mutex> lock(processorsLock);
+    if (!clear) {
+        std::vector<std::shared_ptr<OutputProcessor>> cur = currentProcessors();
+        procs.insert(procs.begin(), cur.begin(), cur.end());
+    }
+    publish(std::move(procs));
 }
 OutputProcessor* OutputProcessors::create(const Json::Value& config) {
     std::string type = config["type"].asString();
@@ -101,16 +161,20 @@ OutputProcessor* OutputProcessors::create(const Json::Value& config) {
 
 OutputProcessor* OutputProcessors::find(std::function<bool(OutputProcessor*)> f) const {
     std::lock_guard<std::mutex> lock(processorsLock);
-    for (OutputProcessor* a : processors) {
-        if (f(a)) {
-            return a;
+    const ProcessorSet* set = current.load();
+    if (set) {
+        for (auto& a : set->processors) {
+            if (f(a.get())) {
+                return a.get();
+            }
         }
     }
     return nullptr;
 }
 
 void OutputProcessors::GetRequiredChannelRanges(const std::function<void(int, int)>& addRange) {
-    for (OutputProcessor* a : processors) {
+    std::lock_guard<std::mutex> lock(processorsLock);
+    for (auto& a : currentProcessors()) {
         a->GetRequiredChannelRanges(addRange);
     }
 }
@@ -11,8 +11,13 @@
  * included LICENSE.LGPL file.
  */
 
+#include <atomic>
+#include <memory>
+
 #include "../../Sequence.h"
 
+#include "OutputProcessorPlan.h"
+
 class OutputProcessor {
 public:
     OutputProcessor();
@@ -42,6 +47,11 @@ public:
         max = FPPD_MAX_CHANNELS;
     }
 
+    // Add this processor to the precompiled plan.  Processors that can be
+    // expressed as value maps, permutes or copies should add those so they
+    // can be fused with their neighbors.
+    virtual void AddToPlan(OutputProcessorPlan& plan) const { plan.addProcessor(this); }
+
 protected:
     std::string description;
     bool active;
@@ -52,6 +62,7 @@ public:
     OutputProcessors();
     ~OutputProcessors();
 
+    // called from the output thread, does not lock
     void ProcessData(unsigned char* channelData) const;
 
     void addProcessor(OutputProcessor* p);
@@ -64,9 +75,34 @@ public:
     void GetRequiredChannelRanges(const std::function<void(int, int)>& addRange);
 
 protected:
-    void removeAll();
+    /*
+     * An immutable snapshot of the processors and their compiled plan.
+     * ProcessData reads the current set without taking any locks.  Changes
+     * build a complete new set and swap it in, the old set (and any
+     * processors only it references) is deleted once no reader can still
+     * be using it so edits never stall or tear a frame.
+     */
+    class ProcessorSet {
+    public:
+        std::vector<std::shared_ptr<OutputProcessor>> processors;
+        OutputProcessorPlan plan;
+    };
+
     OutputProcessor* create(const Json::Value& config);
 
+    // must be called with processorsLock held
+    std::vector<std::shared_ptr<OutputProcessor>> currentProcessors() const;
+    void publish(std::vector<std::shared_ptr<OutputProcessor>>&& procs);
+    void waitForReaders();
+
+    // serializes changes, never taken by ProcessData
     mutable std::mutex processorsLock;
-    std::list<OutputProcessor*> processors;
+
+    std::atomic<ProcessorSet*> current;
+
+    // readers register in the counter for the current epoch, flipping the
+    // epoch lets a writer wait for the older readers to drain without new
+    // readers holding it up
+    std::atomic<uint32_t> readerEpoch;
+    mutable std::atomic<uint32_t> readers[2];
 };
@@ -0,0 +1,500 @@
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include "fpp-pch.h"
+
+#include <random>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAS_X86_KERNELS
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HAS_NEON_KERNELS
+#endif
+
+#include "OutputProcessorKernels.h"
+
+/*
+ * For the "advanced" RGB to RGBW algorithm the amount of white only depends
+ * on the max and min of the three colors so it is precalculated for every
+ * (max, min) pair.  The table is padded so the AVX2 gather can read 4 bytes
+ * from the last entry.
+ */
+static int CalcWhiteness(int maxc, int minc) {
+    if (maxc == 0) {
+        return 0;
+    }
+    // find colour with 100% hue
+    float multiplier = 255.0f / maxc;
+    float maxW = maxc * multiplier;
+    float minW = minc * multiplier;
+    int whiteness = ((maxW + minW) / 2.0f - 127.5f) * (255.0f / 127.5f) / multiplier;
+    if (whiteness < 0)
+        whiteness = 0;
+    else if (whiteness > minc)
+        whiteness = minc;
+    return whiteness;
+}
+static const uint8_t* GetWhitenessTable() {
+    static const std::vector<uint8_t> table = []() {
+        std::vector<uint8_t> t(256 * 256 + 4);
+        for (int mx = 0; mx < 256; mx++) {
+            for (int mn = 0; mn <= mx; mn++) {
+                t[(mx << 8) | mn] = CalcWhiteness(mx, mn);
+            }
+        }
+        return t;
+    }();
+    return &table[0];
+}
+
+static void LUTScalar(unsigned char* data, int count, const uint8_t* table) {
+    for (int x = 0; x < count; x++) {
+        data[x] = table[data[x]];
+    }
+}
+
+static void Permute3Scalar(unsigned char* data, int pixelCount, const uint8_t* perm) {
+    for (int x = 0; x < pixelCount; x++, data += 3) {
+        uint8_t px[3] = { data[0], data[1], data[2] };
+        data[0] = px[perm[0]];
+        data[1] = px[perm[1]];
+        data[2] = px[perm[2]];
+    }
+}
+
+// works from the last pixel back so the expansion can be done in place
+static void ThreeToFourScalar(unsigned char* data, int pixelCount, int algorithm, bool whiteFirst) {
+    if (pixelCount <= 0) {
+        return;
+    }
+    const uint8_t* wt = algorithm == 2 ? GetWhitenessTable() : nullptr;
+    const unsigned char* src = data + (pixelCount - 1) * 3;
+    unsigned char* dst = data + (pixelCount - 1) * 4;
+    for (int x = 0; x < pixelCount; x++, src -= 3, dst -= 4) {
+        int r = src[0];
+        int g = src[1];
+        int b = src[2];
+        int w = 0;
+        if (algorithm == 1) {
+            // r == g == b -> w
+            if (r == g && r == b) {
+                w = r;
+                r = 0;
+                g = 0;
+                b = 0;
+            }
+        } else if (algorithm == 2) {
+            w = wt[(std::max(r, std::max(g, b)) << 8) | std::min(r, std::min(g, b))];
+            r -= w;
+            g -= w;
+            b -= w;
+        }
+        if (whiteFirst) {
+            dst[0] = w;
+            dst[1] = r;
+            dst[2] = g;
+            dst[3] = b;
+        } else {
+            dst[0] = r;
+            dst[1] = g;
+            dst[2] = b;
+            dst[3] = w;
+        }
+    }
+}
+
+static const OutputProcessorKernels SCALAR_KERNELS = { "Scalar", LUTScalar, Permute3Scalar, ThreeToFourScalar };
+
+#ifdef HAS_X86_KERNELS
+/*
+ * 256 entry lookups are done as 16 pshufb lookups of 16 entries each.  The
+ * index is moved down 16 each round and a saturating add of 0x70 sets the
+ * high bit (which makes pshufb return 0) for anything not in the current
+ * 16 entries.
+ */
+__attribute__((target("sse4.1"))) static void LUTSSE41(unsigned char* data, int count, const uint8_t* table) {
+    __m128i t[16];
+    for (int k = 0; k < 16; k++) {
+        t[k] = _mm_loadu_si128((const __m128i*)(table + k * 16));
+    }
+    const __m128i sixteen = _mm_set1_epi8(16);
+    const __m128i bias = _mm_set1_epi8(0x70);
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        __m128i idx = _mm_loadu_si128((const __m128i*)(data + x));
+        __m128i r = _mm_setzero_si128();
+        for (int k = 0; k < 16; k++) {
+            r = _mm_or_si128(r, _mm_shuffle_epi8(t[k], _mm_adds_epu8(idx, bias)));
+            idx = _mm_sub_epi8(idx, sixteen);
+        }
+        _mm_storeu_si128((__m128i*)(data + x), r);
+    }
+    LUTScalar(data + x, count - x, table);
+}
+__attribute__((target("avx2"))) static void LUTAVX2(unsigned char* data, int count, const uint8_t* table) {
+    __m256i t[16];
+    for (int k = 0; k < 16; k++) {
+        t[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(table + k * 16)));
+    }
+    const __m256i sixteen = _mm256_set1_epi8(16);
+    const __m256i bias = _mm256_set1_epi8(0x70);
+    int x = 0;
+    for (; x + 32 <= count; x += 32) {
+        __m256i idx = _mm256_loadu_si256((const __m256i*)(data + x));
+        __m256i r = _mm256_setzero_si256();
+        for (int k = 0; k < 16; k++) {
+            r = _mm256_or_si256(r, _mm256_shuffle_epi8(t[k], _mm256_adds_epu8(idx, bias)));
+            idx = _mm256_sub_epi8(idx, sixteen);
+        }
+        _mm256_storeu_si256((__m256i*)(data + x), r);
+    }
+    LUTSSE41(data + x, count - x, table);
+}
+
+// builds the pshufb mask to permute 5 pixels, the 16th byte is left as is
+static void BuildPermuteMask(const uint8_t* perm, uint8_t* mask) {
+    for (int p = 0; p < 5; p++) {
+        for (int c = 0; c < 3; c++) {
+            mask[p * 3 + c] = p * 3 + perm[c];
+        }
+    }
+    mask[15] = 15;
+}
+__attribute__((target("sse4.1"))) static void Permute3SSE41(unsigned char* data, int pixelCount, const uint8_t* perm) {
+    uint8_t m[16];
+    BuildPermuteMask(perm, m);
+    const __m128i mask = _mm_loadu_si128((const __m128i*)m);
+    int x = 0;
+    // 5 pixels at a time, but the 16 byte load needs a 6th pixel to exist
+    for (; x + 6 <= pixelCount; x += 5, data += 15) {
+        _mm_storeu_si128((__m128i*)data, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)data), mask));
+    }
+    Permute3Scalar(data, pixelCount - x, perm);
+}
+__attribute__((target("avx2"))) static void Permute3AVX2(unsigned char* data, int pixelCount, const uint8_t* perm) {
+    uint8_t m[16];
+    BuildPermuteMask(perm, m);
+    const __m256i mask = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)m));
+    int x = 0;
+    // each lane does 5 pixels, the second lane starts 15 bytes in and is
+    // stored last so its first byte replaces the unmodified 16th byte
+    for (; x + 11 <= pixelCount; x += 10, data += 30) {
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)data)),
+                                            _mm_loadu_si128((const __m128i*)(data + 15)), 1);
+        v = _mm256_shuffle_epi8(v, mask);
+        _mm_storeu_si128((__m128i*)data, _mm256_castsi256_si128(v));
+        _mm_storeu_si128((__m128i*)(data + 15), _mm256_extracti128_si256(v, 1));
+    }
+    Permute3SSE41(data, pixelCount - x, perm);
+}
+
+/*
+ * RGB -> RGBW works on one pixel per 32 bit lane.  The RGB bytes are spread
+ * out to RGB0, shifting the lane right by 8 and 16 lines up G and B under R
+ * for the compares/min/max, and the white value ends up in the top byte.
+ * Blocks are done from the end back so the expansion can be done in place.
+ */
+__attribute__((target("sse4.1"))) static void ThreeToFourSSE41(unsigned char* data, int pixelCount, int algorithm, bool whiteFirst) {
+    const __m128i expand = _mm_setr_epi8(0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11, -128);
+    const __m128i bcast = _mm_setr_epi8(0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12);
+    const __m128i rotate = _mm_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+    const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i lowByte = _mm_set1_epi32(0xFF);
+    const uint8_t* wt = algorithm == 2 ? GetWhitenessTable() : nullptr;
+
+    int i = pixelCount - 4;
+    for (; i >= 0; i -= 4) {
+        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + i * 3)), expand);
+        if (algorithm == 1) {
+            __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(v, _mm_srli_epi32(v, 8)), _mm_cmpeq_epi8(v, _mm_srli_epi32(v, 16)));
+            v = _mm_blendv_epi8(v, _mm_slli_epi32(v, 24), _mm_shuffle_epi8(eq, bcast));
+        } else if (algorithm == 2) {
+            __m128i g = _mm_srli_epi32(v, 8);
+            __m128i b = _mm_srli_epi32(v, 16);
+            __m128i mx = _mm_and_si128(_mm_max_epu8(v, _mm_max_epu8(g, b)), lowByte);
+            __m128i mn = _mm_and_si128(_mm_min_epu8(v, _mm_min_epu8(g, b)), lowByte);
+            __m128i idx = _mm_or_si128(_mm_slli_epi32(mx, 8), mn);
+            __m128i w = _mm_setr_epi32(wt[_mm_extract_epi32(idx, 0)], wt[_mm_extract_epi32(idx, 1)],
+                                       wt[_mm_extract_epi32(idx, 2)], wt[_mm_extract_epi32(idx, 3)]);
+            v = _mm_sub_epi8(v, _mm_and_si128(_mm_shuffle_epi8(w, bcast), rgbMask));
+            v = _mm_or_si128(v, _mm_slli_epi32(w, 24));
+        }
+        if (whiteFirst) {
+            v = _mm_shuffle_epi8(v, rotate);
+        }
+        _mm_storeu_si128((__m128i*)(data + i * 4), v);
+    }
+    ThreeToFourScalar(data, i + 4, algorithm, whiteFirst);
+}
+__attribute__((target("avx2"))) static void ThreeToFourAVX2(unsigned char* data, int pixelCount, int algorithm, bool whiteFirst) {
+    const __m256i expand = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11, -128));
+    const __m256i bcast = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12));
+    const __m256i rotate = _mm256_broadcastsi128_si256(_mm_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14));
+    const __m256i rgbMask = _mm256_set1_epi32(0x00FFFFFF);
+    const __m256i lowByte = _mm256_set1_epi32(0xFF);
+    const uint8_t* wt = algorithm == 2 ? GetWhitenessTable() : nullptr;
+
+    int i = pixelCount - 8;
+    for (; i >= 0; i -= 8) {
+        const unsigned char* src = data + i * 3;
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)src)),
+                                            _mm_loadu_si128((const __m128i*)(src + 12)), 1);
+        v = _mm256_shuffle_epi8(v, expand);
+        if (algorithm == 1) {
+            __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(v, _mm256_srli_epi32(v, 8)), _mm256_cmpeq_epi8(v, _mm256_srli_epi32(v, 16)));
+            v = _mm256_blendv_epi8(v, _mm256_slli_epi32(v, 24), _mm256_shuffle_epi8(eq, bcast));
+        } else if (algorithm == 2) {
+            __m256i g = _mm256_srli_epi32(v, 8);
+            __m256i b = _mm256_srli_epi32(v, 16);
+            __m256i mx = _mm256_and_si256(_mm256_max_epu8(v, _mm256_max_epu8(g, b)), lowByte);
+            __m256i mn = _mm256_and_si256(_mm256_min_epu8(v, _mm256_min_epu8(g, b)), lowByte);
+            __m256i idx = _mm256_or_si256(_mm256_slli_epi32(mx, 8), mn);
+            __m256i w = _mm256_and_si256(_mm256_i32gather_epi32((const int*)wt, idx, 1), lowByte);
+            v = _mm256_sub_epi8(v, _mm256_and_si256(_mm256_shuffle_epi8(w, bcast), rgbMask));
+            v = _mm256_or_si256(v, _mm256_slli_epi32(w, 24));
+        }
+        if (whiteFirst) {
+            v = _mm256_shuffle_epi8(v, rotate);
+        }
+        _mm256_storeu_si256((__m256i*)(data + i * 4), v);
+    }
+    ThreeToFourSSE41(data, i + 8, algorithm, whiteFirst);
+}
+
+static const OutputProcessorKernels SSE41_KERNELS = { "SSE4.1", LUTSSE41, Permute3SSE41, ThreeToFourSSE41 };
+static const OutputProcessorKernels AVX2_KERNELS = { "AVX2", LUTAVX2, Permute3AVX2, ThreeToFourAVX2 };
+#endif
+
+#ifdef HAS_NEON_KERNELS
+static void LUTNEON(unsigned char* data, int count, const uint8_t* table) {
+    int x = 0;
+#if defined(__aarch64__)
+    // four 64 byte table lookups, tbx leaves out of range lanes alone
+    uint8x16x4_t t[4];
+    for (int k = 0; k < 4; k++) {
+        for (int j = 0; j < 4; j++) {
+            t[k].val[j] = vld1q_u8(table + k * 64 + j * 16);
+        }
+    }
+    const uint8x16_t step = vdupq_n_u8(64);
+    for (; x + 16 <= count; x += 16) {
+        uint8x16_t idx = vld1q_u8(data + x);
+        uint8x16_t r = vqtbl4q_u8(t[0], idx);
+        for (int k = 1; k < 4; k++) {
+            idx = vsubq_u8(idx, step);
+            r = vqtbx4q_u8(r, t[k], idx);
+        }
+        vst1q_u8(data + x, r);
+    }
+#else
+    // eight 32 byte table lookups
+    uint8x8x4_t t[8];
+    for (int k = 0; k < 8; k++) {
+        for (int j = 0; j < 4; j++) {
+            t[k].val[j] = vld1_u8(table + k * 32 + j * 8);
+        }
+    }
+    const uint8x8_t step = vdup_n_u8(32);
+    for (; x + 8 <= count; x += 8) {
+        uint8x8_t idx = vld1_u8(data + x);
+        uint8x8_t r = vtbl4_u8(t[0], idx);
+        for (int k = 1; k < 8; k++) {
+            idx = vsub_u8(idx, step);
+            r = vtbx4_u8(r, t[k], idx);
+        }
+        vst1_u8(data + x, r);
+    }
+#endif
+    LUTScalar(data + x, count - x, table);
+}
+
+static void Permute3NEON(unsigned char* data, int pixelCount, const uint8_t* perm) {
+    int x = 0;
+    for (; x + 16 <= pixelCount; x += 16, data += 48) {
+        uint8x16x3_t v = vld3q_u8(data);
+        uint8x16x3_t o;
+        o.val[0] = v.val[perm[0]];
+        o.val[1] = v.val[perm[1]];
+        o.val[2] = v.val[perm[2]];
+        vst3q_u8(data, o);
+    }
+    Permute3Scalar(data, pixelCount - x, perm);
+}
+
+static void ThreeToFourNEON(unsigned char* data, int pixelCount, int algorithm, bool whiteFirst) {
+    const uint8_t* wt = algorithm == 2 ? GetWhitenessTable() : nullptr;
+    int i = pixelCount - 16;
+    for (; i >= 0; i -= 16) {
+        uint8x16x3_t v = vld3q_u8(data + i * 3);
+        uint8x16_t r = v.val[0];
+        uint8x16_t g = v.val[1];
+        uint8x16_t b = v.val[2];
+        uint8x16_t w = vdupq_n_u8(0);
+        if (algorithm == 1) {
+            uint8x16_t eq = vandq_u8(vceqq_u8(r, g), vceqq_u8(r, b));
+            w = vandq_u8(r, eq);
+            r = vbicq_u8(r, eq);
+            g = vbicq_u8(g, eq);
+            b = vbicq_u8(b, eq);
+        } else if (algorithm == 2) {
+            uint8_t mx[16], mn[16], wv[16];
+            vst1q_u8(mx, vmaxq_u8(r, vmaxq_u8(g, b)));
+            vst1q_u8(mn, vminq_u8(r, vminq_u8(g, b)));
+            for (int p = 0; p < 16; p++) {
+                wv[p] = wt[(mx[p] << 8) | mn[p]];
+            }
+            w = vld1q_u8(wv);
+            r = vsubq_u8(r, w);
+            g = vsubq_u8(g, w);
+            b = vsubq_u8(b, w);
+        }
+        uint8x16x4_t o;
+        if (whiteFirst) {
+            o.val[0] = w;
+            o.val[1] = r;
+            o.val[2] = g;
+            o.val[3] = b;
+        } else {
+            o.val[0] = r;
+            o.val[1] = g;
+            o.val[2] = b;
+            o.val[3] = w;
+        }
+        vst4q_u8(data + i * 4, o);
+    }
+    ThreeToFourScalar(data, i + 16, algorithm, whiteFirst);
+}
+
+static const OutputProcessorKernels NEON_KERNELS = { "NEON", LUTNEON, Permute3NEON, ThreeToFourNEON };
+#endif
+
+std::vector<const OutputProcessorKernels*> OutputProcessorKernels::GetAvailable() {
+    std::vector<const OutputProcessorKernels*> k;
+    k.push_back(&SCALAR_KERNELS);
+#ifdef HAS_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1")) {
+        k.push_back(&SSE41_KERNELS);
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        k.push_back(&AVX2_KERNELS);
+    }
+#endif
+#ifdef HAS_NEON_KERNELS
+    k.push_back(&NEON_KERNELS);
+#endif
+    return k;
+}
+
+const OutputProcessorKernels& OutputProcessorKernels::Scalar() {
+    return SCALAR_KERNELS;
+}
+
+static bool CompareKernelOutput(const char* kernel, const OutputProcessorKernels& kernels,
+                                const std::vector<uint8_t>& expected, const std::vector<uint8_t>& actual,
+                                int offset, int count, uint32_t seed) {
+    if (expected == actual) {
+        return true;
+    }
+    int x = 0;
+    while (expected[x] == actual[x]) {
+        x++;
+    }
+    LogErr(VB_CHANNELOUT, "%s %s kernel differs from scalar at byte %d (offset %d, count %d, seed %u): %d != %d\n",
+           kernels.name, kernel, x - offset, offset, count, seed, actual[x], expected[x]);
+    return false;
+}
+
+bool OutputProcessorKernels::SelfTest(const OutputProcessorKernels& kernels, int iterations) {
+    static const uint8_t perms[6][3] = { { 0, 1, 2 }, { 0, 2, 1 }, { 1, 0, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, { 2, 1, 0 } };
+    uint32_t seed = std::random_device()();
+    std::mt19937 rng(seed);
+
+    // room for the largest run expanded to RGBW plus an alignment offset
+    // and guard bytes so writes past the end show up as differences
+    const int maxPixels = 700;
+    const int bufSize = maxPixels * 4 + 64 + 64;
+    std::vector<uint8_t> expected(bufSize);
+    std::vector<uint8_t> actual(bufSize);
+    uint8_t table[256];
+
+    for (int i = 0; i < iterations; i++) {
+        int offset = rng() % 64;
+        int pixels = rng() % maxPixels;
+        for (auto& b : expected) {
+            b = rng();
+        }
+        // make plenty of pixels gray so the r == g == b paths are covered
+        for (int p = 0; p < pixels; p++) {
+            if ((rng() & 3) == 0) {
+                uint8_t* px = &expected[offset + p * 3];
+                px[1] = px[0];
+                px[2] = px[0];
+            }
+        }
+        for (auto& t : table) {
+            t = rng();
+        }
+
+        int count = pixels * 3;
+        actual = expected;
+        Scalar().lut(&expected[offset], count, table);
+        kernels.lut(&actual[offset], count, table);
+        if (!CompareKernelOutput("lut", kernels, expected, actual, offset, count, seed)) {
+            return false;
+        }
+
+        const uint8_t* perm = perms[rng() % 6];
+        actual = expected;
+        Scalar().permute3(&expected[offset], pixels, perm);
+        kernels.permute3(&actual[offset], pixels, perm);
+        if (!CompareKernelOutput("permute3", kernels, expected, actual, offset, pixels, seed)) {
+            return false;
+        }
+
+        int algorithm = rng() % 3;
+        bool whiteFirst = rng() & 1;
+        actual = expected;
+        Scalar().threeToFour(&expected[offset], pixels, algorithm, whiteFirst);
+        kernels.threeToFour(&actual[offset], pixels, algorithm, whiteFirst);
+        if (!CompareKernelOutput("threeToFour", kernels, expected, actual, offset, pixels, seed)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const OutputProcessorKernels& OutputProcessorKernels::Get() {
+    static const OutputProcessorKernels* kernels = []() {
+        std::vector<const OutputProcessorKernels*> available = GetAvailable();
+        if (getSettingInt("OutputProcessorSelfTest")) {
+            // drop any set that doesn't match the scalar output
+            std::vector<const OutputProcessorKernels*> passed;
+            for (auto k : available) {
+                if (k == &SCALAR_KERNELS || SelfTest(*k)) {
+                    LogInfo(VB_CHANNELOUT, "%s output processor kernels passed the self test\n", k->name);
+                    passed.push_back(k);
+                } else {
+                    WarningHolder::AddWarning(std::string(k->name) + " output processor kernels failed the self test and are disabled");
+                }
+            }
+            available = passed;
+        }
+        // the last available set is the fastest
+        const OutputProcessorKernels* k = available.back();
+        LogInfo(VB_CHANNELOUT, "Using %s output processor kernels\n", k->name);
+        return k;
+    }();
+    return *kernels;
+}
@@ -0,0 +1,47 @@
+#pragma once
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include <stdint.h>
+#include <vector>
+
+/*
+ * The inner loops of the output processors that touch every channel.  A
+ * scalar version is always available, the SSE4.1/AVX2 (x86) or NEON (ARM)
+ * versions are used when the CPU supports them.  Every version produces
+ * exactly the same output as the scalar one.
+ */
+class OutputProcessorKernels {
+public:
+    const char* name;
+
+    // data[x] = table[data[x]] for count channels
+    void (*lut)(unsigned char* data, int count, const uint8_t* table);
+
+    // reorder the channels of each RGB pixel, perm[x] is the source
+    // channel (0-2) within the pixel for output channel x
+    void (*permute3)(unsigned char* data, int pixelCount, const uint8_t* perm);
+
+    // expand pixelCount RGB pixels to RGBW (or WRGB if whiteFirst) in place
+    void (*threeToFour)(unsigned char* data, int pixelCount, int algorithm, bool whiteFirst);
+
+    // the best set of kernels for this CPU
+    static const OutputProcessorKernels& Get();
+
+    static const OutputProcessorKernels& Scalar();
+    static std::vector<const OutputProcessorKernels*> GetAvailable();
+
+    // Runs every kernel of the set against the scalar version on random
+    // data, sizes and alignments.  Returns false and logs the first
+    // difference if the outputs don't match.
+    static bool SelfTest(const OutputProcessorKernels& kernels, int iterations = 500);
+};
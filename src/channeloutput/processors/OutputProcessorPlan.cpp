@@ -0,0 +1,248 @@
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include "fpp-pch.h"
+
+#include "OutputProcessor.h"
+#include "OutputProcessorKernels.h"
+#include "OutputProcessorPlan.h"
+
+OutputProcessorPlan::OutputProcessorPlan() {
+}
+OutputProcessorPlan::~OutputProcessorPlan() {
+}
+
+void OutputProcessorPlan::clear() {
+    steps.clear();
+    tables.clear();
+    pending.clear();
+}
+
+void OutputProcessorPlan::addFill(int start, int count, uint8_t value) {
+    uint8_t table[256];
+    memset(table, value, sizeof(table));
+    addLUT(start, count, table);
+}
+
+void OutputProcessorPlan::addLUT(int start, int count, const uint8_t* table) {
+    if (count <= 0) {
+        return;
+    }
+    int end = start + count;
+    std::array<uint8_t, 256> t;
+    memcpy(&t[0], table, 256);
+
+    // compose the new table onto whatever is already pending for the range,
+    // splitting the pending segments at the range boundaries
+    std::vector<Segment> out;
+    int pos = start;
+    for (auto& seg : pending) {
+        if (seg.end <= start || seg.start >= end) {
+            out.push_back(seg);
+            continue;
+        }
+        if (seg.start < start) {
+            out.push_back({ seg.start, start, seg.table });
+        }
+        int os = std::max(seg.start, start);
+        int oe = std::min(seg.end, end);
+        if (pos < os) {
+            out.push_back({ pos, os, t });
+        }
+        Segment c = { os, oe, seg.table };
+        for (int x = 0; x < 256; x++) {
+            c.table[x] = t[seg.table[x]];
+        }
+        out.push_back(c);
+        pos = oe;
+        if (seg.end > end) {
+            out.push_back({ end, seg.end, seg.table });
+        }
+    }
+    if (pos < end) {
+        out.push_back({ pos, end, t });
+    }
+    std::sort(out.begin(), out.end(), [](const Segment& a, const Segment& b) { return a.start < b.start; });
+    pending.swap(out);
+}
+
+void OutputProcessorPlan::addPermute(int start, int pixelCount, const uint8_t* perm) {
+    if (pixelCount <= 0) {
+        return;
+    }
+    flushIfOverlaps(start, start + pixelCount * 3);
+    if (!steps.empty()) {
+        Step& last = steps.back();
+        if (last.type == StepType::PERMUTE && last.start == start && last.count == pixelCount) {
+            // two permutes of the same pixels, combine them
+            uint8_t p[3];
+            for (int x = 0; x < 3; x++) {
+                p[x] = last.perm[perm[x]];
+            }
+            memcpy(last.perm, p, 3);
+            if (p[0] == 0 && p[1] == 1 && p[2] == 2) {
+                steps.pop_back();
+            }
+            return;
+        }
+    }
+    if (perm[0] == 0 && perm[1] == 1 && perm[2] == 2) {
+        return;
+    }
+    Step s;
+    s.type = StepType::PERMUTE;
+    s.start = start;
+    s.count = pixelCount;
+    memcpy(s.perm, perm, 3);
+    steps.push_back(s);
+}
+
+void OutputProcessorPlan::addCopy(int src, int dst, int count, int loops) {
+    if (count <= 0 || loops <= 0 || (src == dst && loops == 1)) {
+        return;
+    }
+    flushIfOverlaps(std::min(src, dst), std::max(src + count, dst + count * loops));
+    if (!steps.empty() && loops == 1) {
+        Step& last = steps.back();
+        if (last.type == StepType::COPY && last.loops == 1 && count > 1 && last.count > 1 &&
+            (last.src + last.count) == src && (last.start + last.count) == dst) {
+            // contiguous with the previous copy, extend it if the combined
+            // source and destination don't overlap
+            int ns = last.src, nd = last.start, nc = last.count + count;
+            if ((ns + nc) <= nd || (nd + nc) <= ns) {
+                last.count = nc;
+                return;
+            }
+        }
+    }
+    Step s;
+    s.type = StepType::COPY;
+    s.src = src;
+    s.start = dst;
+    s.count = count;
+    s.loops = loops;
+    steps.push_back(s);
+}
+
+void OutputProcessorPlan::addProcessor(const OutputProcessor* p) {
+    int mn = INT_MAX;
+    int mx = 0;
+    const_cast<OutputProcessor*>(p)->GetRequiredChannelRanges([&mn, &mx](int m1, int m2) {
+        mn = std::min(mn, m1);
+        mx = std::max(mx, m2);
+    });
+    if (mn == INT_MAX) {
+        flush();
+    } else {
+        flushIfOverlaps(mn, mx + 1);
+    }
+    Step s;
+    s.type = StepType::PROCESSOR;
+    s.processor = p;
+    steps.push_back(s);
+}
+
+void OutputProcessorPlan::finish() {
+    flush();
+}
+
+void OutputProcessorPlan::flushIfOverlaps(int start, int end) {
+    for (auto& seg : pending) {
+        if (seg.start < end && seg.end > start) {
+            flush();
+            return;
+        }
+    }
+}
+
+int OutputProcessorPlan::addTable(const std::array<uint8_t, 256>& table) {
+    for (int x = 0; x < tables.size(); x++) {
+        if (tables[x] == table) {
+            return x;
+        }
+    }
+    tables.push_back(table);
+    return tables.size() - 1;
+}
+
+void OutputProcessorPlan::flush() {
+    std::vector<Segment> segs;
+    for (auto& seg : pending) {
+        if (!segs.empty() && segs.back().end == seg.start && segs.back().table == seg.table) {
+            segs.back().end = seg.end;
+        } else {
+            segs.push_back(seg);
+        }
+    }
+    pending.clear();
+
+    for (auto& seg : segs) {
+        bool identity = true;
+        bool constant = true;
+        for (int x = 0; x < 256; x++) {
+            identity &= (seg.table[x] == x);
+            constant &= (seg.table[x] == seg.table[0]);
+        }
+        if (identity) {
+            continue;
+        }
+        Step s;
+        s.start = seg.start;
+        s.count = seg.end - seg.start;
+        if (constant) {
+            s.type = StepType::FILL;
+            s.table = seg.table[0];
+        } else {
+            s.type = StepType::LUT;
+            s.table = addTable(seg.table);
+        }
+        steps.push_back(s);
+    }
+}
+
+void OutputProcessorPlan::ProcessData(unsigned char* channelData) const {
+    const OutputProcessorKernels& kernels = OutputProcessorKernels::Get();
+    for (auto& s : steps) {
+        switch (s.type) {
+        case StepType::LUT:
+            kernels.lut(channelData + s.start, s.count, &tables[s.table][0]);
+            break;
+        case StepType::FILL:
+            memset(channelData + s.start, s.table, s.count);
+            break;
+        case StepType::PERMUTE:
+            kernels.permute3(channelData + s.start, s.count, s.perm);
+            break;
+        case StepType::COPY:
+            for (int l = 0; l < s.loops; l++) {
+                if (s.count > 1) {
+                    memcpy(channelData + s.start + (l * s.count), channelData + s.src, s.count);
+                } else {
+                    channelData[s.start + l] = channelData[s.src];
+                }
+            }
+            break;
+        case StepType::PROCESSOR:
+            s.processor->ProcessData(channelData);
+            break;
+        }
+    }
+}
+
+void OutputProcessorPlan::dump() const {
+    static const char* names[] = { "LUT", "Fill", "Permute", "Copy", "Processor" };
+    LogDebug(VB_CHANNELOUT, "Output processor plan: %d steps, %d tables\n", (int)steps.size(), (int)tables.size());
+    for (auto& s : steps) {
+        LogDebug(VB_CHANNELOUT, "    %-9s  start: %d  count: %d  src: %d  loops: %d\n",
+                 names[(int)s.type], s.start + 1, s.count, s.src + 1, s.loops);
+    }
+}
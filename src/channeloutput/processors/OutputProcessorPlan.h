@@ -0,0 +1,82 @@
+#pragma once
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the LGPL v2.1 as described in the
+ * included LICENSE.LGPL file.
+ */
+
+#include <array>
+#include <stdint.h>
+#include <vector>
+
+class OutputProcessor;
+
+/*
+ * A precompiled version of the output processor chain.  The processors add
+ * themselves to the plan in order when the configuration is loaded and the
+ * plan fuses what it can:
+ *   - runs of per-channel value maps (brightness, set value, override zero)
+ *     are composed into a single lookup table (or fill) per channel range
+ *   - color order changes on the same range are combined into one permute
+ *   - adjacent straight copies (remaps) are merged into a single copy
+ * Processors that can't be fused are called as is.  Running the plan gives
+ * the same results as running each processor in order.
+ */
+class OutputProcessorPlan {
+public:
+    OutputProcessorPlan();
+    ~OutputProcessorPlan();
+
+    void clear();
+
+    void addLUT(int start, int count, const uint8_t* table);
+    void addFill(int start, int count, uint8_t value);
+    void addPermute(int start, int pixelCount, const uint8_t* perm);
+    void addCopy(int src, int dst, int count, int loops);
+    void addProcessor(const OutputProcessor* p);
+    void finish();
+
+    void ProcessData(unsigned char* channelData) const;
+
+    void dump() const;
+
+private:
+    enum class StepType {
+        LUT,
+        FILL,
+        PERMUTE,
+        COPY,
+        PROCESSOR
+    };
+    class Step {
+    public:
+        StepType type;
+        int start = 0;
+        int count = 0;
+        int src = 0;
+        int loops = 1;
+        int table = 0;
+        uint8_t perm[3] = { 0, 1, 2 };
+        const OutputProcessor* processor = nullptr;
+    };
+    class Segment {
+    public:
+        int start;
+        int end;
+        std::array<uint8_t, 256> table;
+    };
+
+    void flushIfOverlaps(int start, int end);
+    void flush();
+    int addTable(const std::array<uint8_t, 256>& table);
+
+    std::vector<Step> steps;
+    std::vector<std::array<uint8_t, 256>> tables;
+    std::vector<Segment> pending;
+};
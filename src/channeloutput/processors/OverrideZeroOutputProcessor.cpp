@@ -37,3 +37,12 @@ void OverrideZeroOutputProcessor::ProcessData(unsigned char* channelData) const
         }
     }
 }
+
+void OverrideZeroOutputProcessor::AddToPlan(OutputProcessorPlan& plan) const {
+    uint8_t table[256];
+    for (int x = 0; x < 256; x++) {
+        table[x] = x;
+    }
+    table[0] = value;
+    plan.addLUT(start, count, table);
+}
@@ -21,6 +21,7 @@ public:
     virtual void ProcessData(unsigned char* channelData) const override;
 
     virtual OutputProcessorType getType() const override { return OVERRIDEZERO; }
+    virtual void AddToPlan(OutputProcessorPlan& plan) const override;
 
     virtual void GetRequiredChannelRanges(const std::function<void(int, int)>& addRange) override {
         addRange(start, start + count - 1);
@@ -49,6 +49,14 @@ void RemapOutputProcessor::GetRequiredChannelRanges(const std::function<void(int
     addRange(min, max);
 }
 
+void RemapOutputProcessor::AddToPlan(OutputProcessorPlan& plan) const {
+    if (reverse == 0) {
+        plan.addCopy(sourceChannel, destChannel, count, loops);
+    } else {
+        plan.addProcessor(this);
+    }
+}
+
 void RemapOutputProcessor::ProcessData(unsigned char* channelData) const {
     switch (reverse) {
     case 0: // No reverse
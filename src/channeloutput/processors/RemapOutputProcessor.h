@@ -22,6 +22,7 @@ public:
     virtual void ProcessData(unsigned char* channelData) const override;
 
     virtual OutputProcessorType getType() const override { return REMAP; }
+    virtual void AddToPlan(OutputProcessorPlan& plan) const override;
 
     int getSourceChannel() const { return sourceChannel; }
     int getDestChannel() const { return destChannel; }
@@ -34,3 +34,7 @@ SetValueOutputProcessor::~SetValueOutputProcessor() {
 void SetValueOutputProcessor::ProcessData(unsigned char* channelData) const {
     memset(channelData + start, value, count);
 }
+
+void SetValueOutputProcessor::AddToPlan(OutputProcessorPlan& plan) const {
+    plan.addFill(start, count, value);
+}
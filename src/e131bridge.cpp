@@ -21,20 +21,30 @@
 #include <sys/types.h>
 #include <errno.h>
 #include <ifaddrs.h>
+#include <poll.h>
+#include <pthread.h>
+#ifndef PLATFORM_OSX
+#include <linux/filter.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
 
+#include <array>
+#include <atomic>
 #include <fstream>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 
 #include "command.h"
 #include "e131bridge.h"
 
 #include "MultiSync.h"
+#include "Trace.h"
 #include "e131defs.h"
 #include "channeloutput/ChannelOutputSetup.h"
 #include "channeloutput/DDP.h"
@@ -60,27 +70,354 @@ struct mmsghdr msgs[MAX_MSG];
 struct iovec iovecs[MAX_MSG];
 uint8_t buffers[MAX_MSG][BUFSIZE + 1];
 struct sockaddr_in inAddress[MAX_MSG];
+// room for SO_TIMESTAMPNS and SO_RXQ_OVFL
+#define BRIDGE_CONTROL_LEN (CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(uint32_t)))
+char msgControls[MAX_MSG][BRIDGE_CONTROL_LEN];
+
+// Zero copy E1.31 receive.  The packet header is received into the message
+// buffer and the DMX data straight into a slot.  A data packet is published
+// by handing its slot to the sequence in place of the universe's previous
+// slot.  The output thread may still be reading that slot until the one
+// after it has been published, so it's the slot from two packets back
+// that becomes the buffer for the next receive.  The data isn't copied
+// again until the frame merge.  The pool has two slots for every universe
+// and one for every receive message so it never runs out.
+#define BRIDGE_SLOT_SIZE 512
+static bool zeroCopy = false;
+static uint8_t* slotPool = nullptr;
+static std::vector<uint8_t*> freeSlots;
+static std::mutex freeSlotsLock;
+// the last two slots published for each universe
+static std::vector<std::array<uint8_t*, 2>> universeSlots;
+struct iovec slotIovecs[MAX_MSG][2];
+uint8_t* msgSlots[MAX_MSG];
 
 unsigned int UniverseCache[65536];
 
 std::vector<UniverseEntry> InputUniverses;
 int InputUniverseCount;
 
-static uint64_t ddpBytesReceived = 0;
-static uint32_t ddpPacketsReceived = 0;
-static uint32_t ddpErrors = 0;
+static std::atomic_uint64_t ddpBytesReceived(0);
+static std::atomic_uint32_t ddpPacketsReceived(0);
+static std::atomic_uint32_t ddpErrors(0);
 
 static uint32_t ddpLastSequence = 0;
 static uint32_t ddpLastChannel = 0;
 static uint32_t ddpMinChannel = 0xFFFFFFF;
 static uint32_t ddpMaxChannel = 0;
 
-static uint32_t e131Errors = 0;
-static uint32_t e131SyncPackets = 0;
-static UniverseEntry unknownUniverse;
+// updated from the receive threads as well as the main loop
+static std::atomic_uint32_t e131Errors(0);
+static std::atomic_uint32_t e131SyncPackets(0);
+static std::atomic_uint32_t unknownPackets(0);
+static std::atomic_uint64_t unknownBytes(0);
 
 static bool bridgeDataReceived = false;
 
+// Sync latch.  While the sender is sending sync packets (E1.31 Universe
+// Sync, ArtSync or the DDP push flag), received data is staged here and
+// only handed to the sequence when the sync arrives, which then forces the
+// output immediately.  If the sync doesn't show up within syncLatchTimeout
+// the staged data is released anyway.  Like Art-Net, if no sync has been
+// seen for SYNC_LATCH_IDLE_MS, data goes straight through again.
+#define SYNC_LATCH_IDLE_MS 4000
+static bool syncLatch = false;
+static long long syncLatchTimeout = 50;
+static std::atomic_llong lastSyncTime(-SYNC_LATCH_IDLE_MS);
+static long long stagedTime = 0;
+static uint8_t* stagedData = nullptr;
+static std::map<int, int> stagedRanges;
+static std::mutex stagedLock;
+static std::atomic_uint32_t syncLatchFrames(0);
+static std::atomic_uint32_t syncLatchTimeouts(0);
+
+// Optional receive threads.  Each thread has its own SO_REUSEPORT socket
+// per protocol and a BPF program on the port steers every universe to the
+// same thread (multicast groups are split the same way) so each universe
+// only ever has one writer.  DDP is all received on the first thread as
+// its sequence numbers cover the whole stream.
+class BridgeReceiveThread {
+public:
+    BridgeReceiveThread(int idx);
+    ~BridgeReceiveThread();
+
+    int Receive(int sock, int proto);
+
+    int index;
+    int cpu = -1;
+    int e131Sock = -1;
+    int artnetSock = -1;
+    int ddpSock = -1;
+    std::thread* thread = nullptr;
+
+    struct mmsghdr msgs[MAX_MSG];
+    struct iovec iovecs[MAX_MSG];
+    uint8_t buffers[MAX_MSG][BUFSIZE + 1];
+    char control[MAX_MSG][BRIDGE_CONTROL_LEN];
+    struct iovec slotIovecs[MAX_MSG][2];
+    uint8_t* slots[MAX_MSG];
+
+    std::atomic_uint64_t packets{ 0 };
+    std::atomic_uint64_t bytes{ 0 };
+    std::atomic_uint64_t ignored{ 0 };
+    // SO_RXQ_OVFL, packets the kernel dropped because the socket buffer was
+    // full, cumulative per socket so the base is kept for resets
+    std::atomic_uint32_t overflow[3]{ { 0 }, { 0 }, { 0 } };
+    std::atomic_uint32_t overflowBase[3]{ { 0 }, { 0 }, { 0 } };
+};
+static std::vector<BridgeReceiveThread*> receiveThreads;
+
+// sACN source merging.  Each universe tracks up to E131_MAX_MERGE_SOURCES
+// senders by CID.  The highest priority source wins, sources sharing the
+// top priority are merged HTP (highest value) or LTP (latest change per
+// channel).  With a single live source the data is passed straight through.
+#define E131_MAX_MERGE_SOURCES 4
+enum class BridgeMergeMode {
+    NONE,
+    HTP,
+    LTP
+};
+static BridgeMergeMode mergeMode = BridgeMergeMode::NONE;
+
+class E131MergeSource {
+public:
+    uint8_t cid[E131_CID_LENGTH];
+    int priority = -1; // -1 is an unused slot
+    long long lastSeen = 0;
+    uint32_t lastSequenceNumber = 0;
+    uint8_t data[512];
+};
+class E131UniverseMerge {
+public:
+    E131MergeSource sources[E131_MAX_MERGE_SOURCES];
+    // the single top priority source being passed through, nullptr while
+    // several sources are being merged into merged
+    E131MergeSource* winner = nullptr;
+    uint8_t merged[512];
+};
+// by universe index, created with the first packet for the universe.  A
+// universe is only ever received on one thread so these need no locking
+static std::vector<E131UniverseMerge*> universeMerges;
+static std::atomic_uint64_t mergedPackets(0);
+static std::atomic_uint64_t lowerPriorityPackets(0);
+static std::atomic_uint64_t sourceChanges(0);
+static std::atomic_uint64_t sourceTimeouts(0);
+static std::atomic_uint64_t sourcesTerminated(0);
+static std::atomic_uint64_t sourcesRejected(0);
+
+// Receive timing.  Packets are timestamped by the kernel on arrival
+// (SO_TIMESTAMPNS).  The receive loops note the arrival time of the packet
+// being handled so the store functions and SetBridgeData can use it.
+static thread_local uint64_t packetArrivalNS = 0;
+
+#define BRIDGE_HISTOGRAM_BUCKETS 11
+// upper bounds of the buckets in microseconds, the last is everything slower
+static const int BRIDGE_HISTOGRAM_LIMITS[BRIDGE_HISTOGRAM_BUCKETS - 1] = { 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000 };
+
+class BridgeHistogram {
+public:
+    void Add(uint64_t us) {
+        int b = 0;
+        while (b < (BRIDGE_HISTOGRAM_BUCKETS - 1) && us > BRIDGE_HISTOGRAM_LIMITS[b]) {
+            b++;
+        }
+        buckets[b]++;
+        count++;
+        totalUS += us;
+        uint64_t m = maxUS;
+        while (us > m && !maxUS.compare_exchange_weak(m, us)) {
+        }
+    }
+    void Reset() {
+        for (auto& b : buckets) {
+            b = 0;
+        }
+        count = 0;
+        totalUS = 0;
+        maxUS = 0;
+    }
+    Json::Value ToJson() const {
+        Json::Value result;
+        uint64_t c = count;
+        result["count"] = (Json::UInt64)c;
+        result["avg"] = c ? (double)totalUS / c : 0.0;
+        result["max"] = (Json::UInt64)maxUS;
+        Json::Value b(Json::arrayValue);
+        for (int x = 0; x < BRIDGE_HISTOGRAM_BUCKETS; x++) {
+            Json::Value bucket;
+            if (x < (BRIDGE_HISTOGRAM_BUCKETS - 1)) {
+                bucket["le"] = BRIDGE_HISTOGRAM_LIMITS[x];
+            } else {
+                bucket["le"] = "inf";
+            }
+            bucket["count"] = (Json::UInt64)buckets[x];
+            b.append(bucket);
+        }
+        result["buckets"] = b;
+        return result;
+    }
+
+    std::atomic_uint64_t buckets[BRIDGE_HISTOGRAM_BUCKETS] = {};
+    std::atomic_uint64_t count{ 0 };
+    std::atomic_uint64_t totalUS{ 0 };
+    std::atomic_uint64_t maxUS{ 0 };
+};
+// kernel timestamp to the packet being handled
+static BridgeHistogram receiveDelayHistogram;
+// change in inter-arrival time between consecutive packets of a universe
+static BridgeHistogram jitterHistogram;
+// kernel timestamp of the oldest packet in a frame to the output thread
+// having sent the frame
+static BridgeHistogram outputLatencyHistogram;
+static std::atomic_uint64_t oldestUnsentArrival(0);
+
+class UniverseTiming {
+public:
+    uint64_t lastArrival = 0;
+    int64_t lastInterval = 0;
+    // smoothed inter-arrival time and RFC 3550 style jitter, microseconds
+    double interval = 0;
+    double jitter = 0;
+    // packets missing according to the sequence numbers, packets late or
+    // duplicated
+    uint32_t gaps = 0;
+    uint32_t outOfOrder = 0;
+};
+// by universe index, only written by the thread receiving the universe
+static std::vector<UniverseTiming> universeTiming;
+
+// received counters by universe index.  The E1.31 and ArtNet receive
+// threads update them and the API reads and resets them, so they are
+// relaxed atomics.
+class UniverseCounters {
+public:
+    std::atomic_uint32_t bytes{ 0 };
+    std::atomic_uint32_t packets{ 0 };
+    std::atomic_uint32_t errors{ 0 };
+};
+static std::unique_ptr<UniverseCounters[]> universeCounters;
+
+static inline uint64_t RealtimeNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// pick the kernel arrival timestamp (and socket overflow count if wanted)
+// out of a received message's control data
+static void HandlePacketControl(struct msghdr* hdr, uint64_t now, std::atomic_uint32_t* overflow = nullptr) {
+    packetArrivalNS = now;
+#ifndef PLATFORM_OSX
+    for (struct cmsghdr* cm = CMSG_FIRSTHDR(hdr); cm; cm = CMSG_NXTHDR(hdr, cm)) {
+        if (cm->cmsg_level != SOL_SOCKET) {
+            continue;
+        }
+        if (cm->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(cm), sizeof(ts));
+            packetArrivalNS = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+        } else if (cm->cmsg_type == SO_RXQ_OVFL && overflow) {
+            uint32_t drops;
+            memcpy(&drops, CMSG_DATA(cm), sizeof(drops));
+            *overflow = drops;
+        }
+    }
+#endif
+    if (now > packetArrivalNS) {
+        receiveDelayHistogram.Add((now - packetArrivalNS) / 1000);
+    }
+}
+
+static uint8_t* AllocateSlot() {
+    std::unique_lock<std::mutex> lock(freeSlotsLock);
+    uint8_t* slot = freeSlots.back();
+    freeSlots.pop_back();
+    return slot;
+}
+
+// receive the message's header into buffer and the data into its slot
+static inline void SetupSlotReceive(struct msghdr& hdr, struct iovec* iov, uint8_t* buffer, uint8_t*& slot) {
+    if (!slot) {
+        slot = AllocateSlot();
+    }
+    iov[0].iov_base = buffer;
+    iov[0].iov_len = E131_HEADER_LENGTH;
+    iov[1].iov_base = slot;
+    iov[1].iov_len = BRIDGE_SLOT_SIZE;
+    hdr.msg_iov = iov;
+    hdr.msg_iovlen = 2;
+}
+
+static inline int BridgeReceive(int sock, bool slots = false) {
+    for (int i = 0; i < MAX_MSG; i++) {
+        msgs[i].msg_hdr.msg_control = msgControls[i];
+        msgs[i].msg_hdr.msg_controllen = BRIDGE_CONTROL_LEN;
+        if (slots) {
+            SetupSlotReceive(msgs[i].msg_hdr, slotIovecs[i], buffers[i], msgSlots[i]);
+        } else {
+            msgs[i].msg_hdr.msg_iov = &iovecs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+    return recvmmsg(sock, msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
+}
+
+static void EnableTimestamps(int sock) {
+#ifndef PLATFORM_OSX
+    int enable = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) < 0) {
+        LogDebug(VB_E131BRIDGE, "Could not enable SO_TIMESTAMPNS: %s\n", strerror(errno));
+    }
+#endif
+}
+
+// counts sequence errors for the universe, split into gaps (packets
+// missing) and out of order (late or duplicate) packets
+static void CheckSequence(uint32_t universeIndex, uint32_t last, uint32_t sn) {
+    // some wrap from 255 -> 1 and some from 255 -> 0, spec doesn't say which
+    if ((last == 255) ? (sn == 0 || sn == 1) : ((last + 1) == sn)) {
+        return;
+    }
+    universeCounters[universeIndex].errors.fetch_add(1, std::memory_order_relaxed);
+    UniverseTiming& t = universeTiming[universeIndex];
+    int8_t d = (int8_t)(sn - last);
+    if (d <= 0) {
+        t.outOfOrder++;
+    } else {
+        t.gaps += d - 1;
+    }
+}
+
+static void TrackUniverseArrival(uint32_t universeIndex) {
+    UniverseTiming& t = universeTiming[universeIndex];
+    uint64_t arrival = packetArrivalNS;
+    if (t.lastArrival && arrival > t.lastArrival) {
+        int64_t interval = arrival - t.lastArrival;
+        if (t.lastInterval) {
+            int64_t d = std::llabs(interval - t.lastInterval) / 1000;
+            t.jitter += (d - t.jitter) / 16.0;
+            jitterHistogram.Add(d);
+            t.interval += (interval / 1000.0 - t.interval) / 16.0;
+        } else {
+            t.interval = interval / 1000.0;
+        }
+        t.lastInterval = interval;
+    }
+    t.lastArrival = arrival;
+}
+
+uint64_t Bridge_TakeOldestArrival() {
+    return oldestUnsentArrival.exchange(0);
+}
+void Bridge_FrameSent(uint64_t arrival) {
+    uint64_t now = RealtimeNanos();
+    if (arrival && now > arrival) {
+        outputLatencyHistogram.Add((now - arrival) / 1000);
+    }
+}
+static int receiveThreadCount = 0;
+static volatile bool runReceiveThreads = false;
+
 static std::map<int, std::function<bool(uint8_t* data, long long packetTime)>> ArtNetOpcodeHandlers;
 
 void AddArtNetOpcodeHandler(int opCode, std::function<bool(uint8_t* data, long long packetTime)> handler) {
@@ -91,12 +428,14 @@ void RemoveArtNetOpcodeHandler(int opCode) {
 }
 
 // prototypes for functions below
-bool Bridge_StoreData(uint8_t* bridgeBuffer, long long packetTime);
+bool Bridge_StoreData(uint8_t* bridgeBuffer, long long packetTime, uint8_t** slot = nullptr);
 bool Bridge_StoreDDPData(uint8_t* bridgeBuffer, long long packetTime);
+bool Bridge_StoreArtNetData(uint8_t* bridgeBuffer, long long packetTime);
 
 int Bridge_GetIndexFromUniverseNumber(int universe);
 void InputUniversesPrint();
 inline void SetBridgeData(uint8_t* data, int startChannel, int len, long long packetTime);
+inline void StageBridgeData(uint8_t* data, int startChannel, int len, long long packetTime);
 
 int CreateArtNetSocket() {
     if (artnetSock < 0) {
@@ -108,6 +447,11 @@ int CreateArtNetSocket() {
         int enable = 1;
         //need to be able to send broadcase for ArtPollReply
         setsockopt(artnetSock, SOL_SOCKET, SO_BROADCAST, &enable, sizeof(enable));
+        if (receiveThreadCount > 0) {
+            // the receive threads share the port
+            setsockopt(artnetSock, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+        }
+        EnableTimestamps(artnetSock);
         enable = 1;
 #ifdef PLATFORM_OSX
         setsockopt(artnetSock, IPPROTO_UDP, UDP_NOCKSUM, (void*)&enable, sizeof enable);
@@ -129,29 +473,34 @@ int CreateArtNetSocket() {
     return artnetSock;
 }
 
+// set by tools running the bridge in process instead of ci-universes.json
+static Json::Value bridgeConfig;
+
+void Bridge_SetConfig(const Json::Value& config) {
+    bridgeConfig = config;
+}
+
 /*
  *
  */
 bool LoadInputUniversesFromFile(void) {
-    FILE* fp;
-    char buf[512];
-    char* s;
     InputUniverseCount = 0;
-    char active = 0;
-    std::string filename = FPP_DIR_CONFIG("/ci-universes.json");
+    Json::Value root = bridgeConfig;
+    if (root.isNull()) {
+        std::string filename = FPP_DIR_CONFIG("/ci-universes.json");
 
-    LogDebug(VB_E131BRIDGE, "Opening File Now %s\n", filename.c_str());
+        LogDebug(VB_E131BRIDGE, "Opening File Now %s\n", filename.c_str());
 
-    if (!FileExists(filename)) {
-        LogErr(VB_E131BRIDGE, "Universe file %s does not exist\n",
-               filename.c_str());
-        return false;
-    }
+        if (!FileExists(filename)) {
+            LogErr(VB_E131BRIDGE, "Universe file %s does not exist\n",
+                   filename.c_str());
+            return false;
+        }
 
-    Json::Value root;
-    if (!LoadJsonFromFile(filename, root)) {
-        LogErr(VB_E131BRIDGE, "Error parsing %s\n", filename.c_str());
-        return false;
+        if (!LoadJsonFromFile(filename, root)) {
+            LogErr(VB_E131BRIDGE, "Error parsing %s\n", filename.c_str());
+            return false;
+        }
     }
 
     Json::Value outputs = root["channelInputs"];
@@ -171,6 +520,22 @@ bool LoadInputUniversesFromFile(void) {
         if (outputs[c].isMember("timeout")) {
             expireOffSet = outputs[c]["timeout"].asInt();
         }
+        if (outputs[c].isMember("syncLatch")) {
+            syncLatch = outputs[c]["syncLatch"].asInt() ? true : false;
+        }
+        if (outputs[c].isMember("syncTimeout") && outputs[c]["syncTimeout"].asInt() > 0) {
+            syncLatchTimeout = outputs[c]["syncTimeout"].asInt();
+        }
+        if (outputs[c].isMember("merge")) {
+            std::string m = outputs[c]["merge"].asString();
+            mergeMode = (m == "htp") ? BridgeMergeMode::HTP : (m == "ltp") ? BridgeMergeMode::LTP : BridgeMergeMode::NONE;
+        }
+        if (outputs[c].isMember("receiveThreads")) {
+            receiveThreadCount = std::clamp(outputs[c]["receiveThreads"].asInt(), 0, 16);
+        }
+        if (outputs[c].isMember("zeroCopy")) {
+            zeroCopy = outputs[c]["zeroCopy"].asInt() ? true : false;
+        }
 
         Json::Value univs = outputs[c]["universes"];
         enabled = true;
@@ -217,12 +582,75 @@ bool LoadInputUniversesFromFile(void) {
 }
 
 inline void SetBridgeData(uint8_t* data, int startChannel, int len, long long packetTime) {
+    uint64_t none = 0;
+    oldestUnsentArrival.compare_exchange_strong(none, packetArrivalNS ? packetArrivalNS : RealtimeNanos());
     last_packet_time = packetTime;
     packetTime += expireOffSet;
     bridgeDataReceived = true;
     sequence->SetBridgeData(data, startChannel, len, packetTime);
 }
 
+static inline bool SyncLatchActive(long long packetTime) {
+    return syncLatch && ((packetTime - lastSyncTime) < SYNC_LATCH_IDLE_MS);
+}
+
+inline void StageBridgeData(uint8_t* data, int startChannel, int len, long long packetTime) {
+    if (!SyncLatchActive(packetTime)) {
+        SetBridgeData(data, startChannel, len, packetTime);
+        return;
+    }
+    std::unique_lock<std::mutex> lock(stagedLock);
+    if (!stagedData) {
+        stagedData = (uint8_t*)calloc(1, FPPD_MAX_CHANNEL_NUM);
+    }
+    if (startChannel < 0 || startChannel >= FPPD_MAX_CHANNEL_NUM) {
+        return;
+    }
+    len = std::min(len, FPPD_MAX_CHANNEL_NUM - startChannel);
+    memcpy(&stagedData[startChannel], data, len);
+    int& l = stagedRanges[startChannel];
+    l = std::max(l, len);
+    if (!stagedTime) {
+        stagedTime = packetTime;
+    }
+}
+
+// hand everything staged to the sequence, returns true if there was anything
+static bool CommitStagedData(long long packetTime) {
+    std::unique_lock<std::mutex> lock(stagedLock);
+    if (stagedRanges.empty()) {
+        return false;
+    }
+    for (auto& r : stagedRanges) {
+        SetBridgeData(&stagedData[r.first], r.first, r.second, packetTime);
+    }
+    stagedRanges.clear();
+    stagedTime = 0;
+    return true;
+}
+
+static bool Bridge_Synced(long long packetTime) {
+    if (!syncLatch) {
+        return true;
+    }
+    lastSyncTime = packetTime;
+    if (CommitStagedData(packetTime)) {
+        syncLatchFrames++;
+    }
+    return true;
+}
+
+bool Bridge_CheckSyncLatch() {
+    std::unique_lock<std::mutex> lock(stagedLock);
+    bool expired = stagedTime && ((GetTimeMS() - stagedTime) >= syncLatchTimeout);
+    lock.unlock();
+    if (expired) {
+        syncLatchTimeouts++;
+        return CommitStagedData(GetTimeMS());
+    }
+    return false;
+}
+
 double GetSecondsFromInputPacket() {
     long long t = GetTimeMS();
     double dt = t - last_packet_time;
@@ -236,36 +664,42 @@ double GetSecondsFromInputPacket() {
 bool Bridge_ReceiveE131Data(void) {
     //	LogExcess(VB_E131BRIDGE, "Bridge_ReceiveData()\n");
 
-    int msgcnt = recvmmsg(bridgeSock, msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
-    bool sync = false;
+    int msgcnt = BridgeReceive(bridgeSock, zeroCopy);
+    bool sync = Bridge_CheckSyncLatch();
     long long packetTime = GetTimeMS();
     while (msgcnt > 0) {
+        uint64_t now = RealtimeNanos();
         for (int x = 0; x < msgcnt; x++) {
-            sync |= Bridge_StoreData((uint8_t*)buffers[x], packetTime);
+            HandlePacketControl(&msgs[x].msg_hdr, now);
+            sync |= Bridge_StoreData((uint8_t*)buffers[x], packetTime, zeroCopy ? &msgSlots[x] : nullptr);
         }
-        msgcnt = recvmmsg(bridgeSock, msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
+        msgcnt = BridgeReceive(bridgeSock, zeroCopy);
     }
     return sync;
 }
 bool Bridge_ReceiveDDPData(void) {
     //    LogExcess(VB_E131BRIDGE, "Bridge_ReceiveData()\n");
-    int msgcnt = recvmmsg(ddpSock, msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
-    bool sync = false;
+    int msgcnt = BridgeReceive(ddpSock);
+    bool sync = Bridge_CheckSyncLatch();
     long long packetTime = GetTimeMS();
     while (msgcnt > 0) {
+        uint64_t now = RealtimeNanos();
         for (int x = 0; x < msgcnt; x++) {
+            HandlePacketControl(&msgs[x].msg_hdr, now);
             sync |= Bridge_StoreDDPData((uint8_t*)buffers[x], packetTime);
         }
-        msgcnt = recvmmsg(ddpSock, msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
+        msgcnt = BridgeReceive(ddpSock);
     }
     return sync;
 }
 bool Bridge_ReceiveArtNetData(void) {
-    int msgcnt = recvmmsg(artnetSock, msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
-    bool sync = false;
+    int msgcnt = BridgeReceive(artnetSock);
+    bool sync = Bridge_CheckSyncLatch();
     long long packetTime = GetTimeMS();
     while (msgcnt > 0) {
+        uint64_t now = RealtimeNanos();
         for (int x = 0; x < msgcnt; x++) {
+            HandlePacketControl(&msgs[x].msg_hdr, now);
             uint8_t* bridgeBuffer = (uint8_t*)buffers[x];
             if (bridgeBuffer[0] != 'A' || bridgeBuffer[1] != 'r' || bridgeBuffer[2] != 't' || bridgeBuffer[3] != '-' || bridgeBuffer[4] != 'N' || bridgeBuffer[5] != 'e' || bridgeBuffer[6] != 't' || bridgeBuffer[7] != 0 || bridgeBuffer[11] != 0xE) { //version must be 14
                 continue;
@@ -276,11 +710,330 @@ bool Bridge_ReceiveArtNetData(void) {
                 sync |= cb->second(bridgeBuffer, packetTime);
             }
         }
-        msgcnt = recvmmsg(artnetSock, msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
+        msgcnt = BridgeReceive(artnetSock);
     }
     return sync;
 }
 
+#define RECEIVE_E131 0
+#define RECEIVE_ARTNET 1
+#define RECEIVE_DDP 2
+
+// threads each protocol is actually spread over, 0 if it's on the main loop
+static int e131ReceiveThreads = 0;
+static int artnetReceiveThreads = 0;
+
+BridgeReceiveThread::BridgeReceiveThread(int idx) :
+    index(idx) {
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < MAX_MSG; i++) {
+        iovecs[i].iov_base = buffers[i];
+        iovecs[i].iov_len = BUFSIZE;
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        slots[i] = nullptr;
+    }
+}
+BridgeReceiveThread::~BridgeReceiveThread() {
+    if (e131Sock >= 0)
+        close(e131Sock);
+    if (artnetSock >= 0)
+        close(artnetSock);
+    if (ddpSock >= 0)
+        close(ddpSock);
+}
+
+int BridgeReceiveThread::Receive(int sock, int proto) {
+    bool sync = false;
+    while (true) {
+        bool useSlots = zeroCopy && proto == RECEIVE_E131;
+        for (int i = 0; i < MAX_MSG; i++) {
+            msgs[i].msg_hdr.msg_control = control[i];
+            msgs[i].msg_hdr.msg_controllen = sizeof(control[i]);
+            if (useSlots) {
+                SetupSlotReceive(msgs[i].msg_hdr, slotIovecs[i], buffers[i], slots[i]);
+            } else {
+                msgs[i].msg_hdr.msg_iov = &iovecs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+        }
+        int msgcnt = recvmmsg(sock, msgs, MAX_MSG, MSG_DONTWAIT, nullptr);
+        if (msgcnt <= 0) {
+            break;
+        }
+        long long packetTime = GetTimeMS();
+        uint64_t now = RealtimeNanos();
+        for (int x = 0; x < msgcnt; x++) {
+            uint8_t* bridgeBuffer = buffers[x];
+            packets++;
+            bytes += msgs[x].msg_len;
+            HandlePacketControl(&msgs[x].msg_hdr, now, &overflow[proto]);
+            // broadcasts reach every thread, only the universe's own thread
+            // handles them
+            if (proto == RECEIVE_E131) {
+                if (bridgeBuffer[E131_VECTOR_INDEX] == VECTOR_ROOT_E131_DATA) {
+                    int universe = ((int)bridgeBuffer[E131_UNIVERSE_INDEX] << 8) + bridgeBuffer[E131_UNIVERSE_INDEX + 1];
+                    if ((universe % e131ReceiveThreads) != index) {
+                        ignored++;
+                        continue;
+                    }
+                }
+                sync |= Bridge_StoreData(bridgeBuffer, packetTime, useSlots ? &slots[x] : nullptr);
+            } else if (proto == RECEIVE_ARTNET) {
+                // everything other than ArtDmx is handled on the main ArtNet socket
+                if (memcmp(bridgeBuffer, "Art-Net", 8) || bridgeBuffer[11] != 0xE || bridgeBuffer[8] != 0x00 || bridgeBuffer[9] != 0x50) {
+                    ignored++;
+                    continue;
+                }
+                int universe = ((bridgeBuffer[15] & 0x7F) << 8) | bridgeBuffer[14];
+                if ((universe % artnetReceiveThreads) != index) {
+                    ignored++;
+                    continue;
+                }
+                Bridge_StoreArtNetData(bridgeBuffer, packetTime);
+            } else {
+                sync |= Bridge_StoreDDPData(bridgeBuffer, packetTime);
+            }
+        }
+    }
+    return sync;
+}
+
+static void RunBridgeReceiveThread(BridgeReceiveThread* t) {
+    TraceManager::INSTANCE.SetThreadName("BridgeReceive" + std::to_string(t->index));
+#ifndef PLATFORM_OSX
+    if (t->cpu >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(t->cpu, &cpuset);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset)) {
+            LogDebug(VB_E131BRIDGE, "Could not pin bridge receive thread %d to CPU %d\n", t->index, t->cpu);
+        }
+    }
+#endif
+    struct pollfd fds[3];
+    int protos[3];
+    int count = 0;
+    int socks[3] = { t->e131Sock, t->artnetSock, t->ddpSock };
+    for (int x = 0; x < 3; x++) {
+        if (socks[x] >= 0) {
+            fds[count].fd = socks[x];
+            fds[count].events = POLLIN;
+            protos[count] = x;
+            count++;
+        }
+    }
+    while (runReceiveThreads) {
+        if (poll(fds, count, 100) <= 0) {
+            continue;
+        }
+        bool sync = false;
+        for (int x = 0; x < count; x++) {
+            if (fds[x].revents & POLLIN) {
+                sync |= t->Receive(fds[x].fd, protos[x]);
+            }
+        }
+        if (sync) {
+            ForceChannelOutputNow();
+        }
+    }
+}
+
+static int CreateReceiveSocket(int port, bool reusePort) {
+    int sock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (sock < 0) {
+        LogWarn(VB_E131BRIDGE, "Bridge receive socket failed: %s\n", strerror(errno));
+        return -1;
+    }
+    int enable = 1;
+    if (reusePort) {
+        setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+    }
+    EnableTimestamps(sock);
+#ifndef PLATFORM_OSX
+    setsockopt(sock, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable));
+    // only receive the multicast groups this socket joined, not every
+    // group joined by any socket on the port
+    int disable = 0;
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_ALL, &disable, sizeof(disable));
+#endif
+    struct sockaddr_in address;
+    memset((char*)&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(sock, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        LogWarn(VB_E131BRIDGE, "Bridge receive bind to port %d failed: %s\n", port, strerror(errno));
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+static bool AttachSteeringProgram(int sock, struct sock_filter* code, int len) {
+#ifndef PLATFORM_OSX
+    struct sock_fprog prog = { (unsigned short)len, code };
+    if (setsockopt(sock, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) == 0) {
+        return true;
+    }
+    LogWarn(VB_E131BRIDGE, "Could not attach bridge receive steering program: %s\n", strerror(errno));
+#endif
+    return false;
+}
+
+static void JoinMulticastGroup(int sock, int universe, struct ifaddrs* interfaces) {
+    struct ip_mreq mreq;
+    char strMulticastGroup[16];
+    char address[16];
+    sprintf(strMulticastGroup, "239.255.%d.%d", universe / 256, universe % 256);
+    mreq.imr_multiaddr.s_addr = inet_addr(strMulticastGroup);
+
+    LogInfo(VB_E131BRIDGE, "Adding group %s\n", strMulticastGroup);
+
+    // add group to groups to listen for on eth0 and wlan0 if it exists
+    int multicastJoined = 0;
+    //loop through all the interfaces and subscribe to the group
+    for (struct ifaddrs* tmp = interfaces; tmp; tmp = tmp->ifa_next) {
+        if (tmp->ifa_addr && tmp->ifa_addr->sa_family == AF_INET) {
+            GetInterfaceAddress(tmp->ifa_name, address, NULL, NULL);
+            if (strcmp(address, "127.0.0.1")) {
+                LogDebug(VB_E131BRIDGE, "   Adding interface %s - %s\n", tmp->ifa_name, address);
+                mreq.imr_interface.s_addr = inet_addr(address);
+                if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+                    LogWarn(VB_E131BRIDGE, "   Could not setup Multicast Group for interface %s\n", tmp->ifa_name);
+                }
+                multicastJoined = 1;
+            }
+        } else if (tmp->ifa_addr && tmp->ifa_addr->sa_family == AF_INET6) {
+            //FIXME for ipv6 multicast
+            //LogDebug(VB_E131BRIDGE, "   Inet6 interface %s\n", tmp->ifa_name);
+        }
+    }
+
+    if (!multicastJoined) {
+        LogDebug(VB_E131BRIDGE, "  Binding to default interface\n");
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+            LogWarn(VB_E131BRIDGE, "   Could not setup Multicast Group\n");
+        }
+    }
+}
+
+static void StartReceiveThreads(bool hase131, bool hasArtNet) {
+#ifndef PLATFORM_OSX
+    int count = receiveThreadCount;
+    int cpus = std::thread::hardware_concurrency();
+    for (int x = 0; x < count; x++) {
+        BridgeReceiveThread* t = new BridgeReceiveThread(x);
+        // leave the first core for the main loop if there's more than one
+        t->cpu = cpus > 1 ? (x % (cpus - 1)) + 1 : -1;
+        receiveThreads.push_back(t);
+    }
+
+    // DDP sequence numbers are per stream so it all goes to the first thread
+    receiveThreads[0]->ddpSock = CreateReceiveSocket(DDP_PORT, false);
+
+    if (hase131) {
+        bool ok = true;
+        for (auto t : receiveThreads) {
+            t->e131Sock = CreateReceiveSocket(E131_DEST_PORT, true);
+            ok &= t->e131Sock >= 0;
+        }
+        // universe % threads, packets too short to have a universe (sync)
+        // end up on the first thread
+        struct sock_filter e131Steer[] = {
+            BPF_STMT(BPF_LD | BPF_H | BPF_ABS, E131_UNIVERSE_INDEX),
+            BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, (uint32_t)count),
+            BPF_STMT(BPF_RET | BPF_A, 0),
+        };
+        if (ok && (count == 1 || AttachSteeringProgram(receiveThreads[0]->e131Sock, e131Steer, 3))) {
+            e131ReceiveThreads = count;
+        } else {
+            // everything on one thread rather than universes on the wrong one
+            for (int x = 1; x < count; x++) {
+                if (receiveThreads[x]->e131Sock >= 0) {
+                    close(receiveThreads[x]->e131Sock);
+                    receiveThreads[x]->e131Sock = -1;
+                }
+            }
+            e131ReceiveThreads = receiveThreads[0]->e131Sock >= 0 ? 1 : 0;
+        }
+        if (e131ReceiveThreads) {
+            struct ifaddrs* interfaces;
+            getifaddrs(&interfaces);
+            for (int i = 0; i < InputUniverseCount; i++) {
+                if (InputUniverses[i].type == E131_TYPE_MULTICAST) {
+                    int sock = receiveThreads[InputUniverses[i].universe % e131ReceiveThreads]->e131Sock;
+                    JoinMulticastGroup(sock, InputUniverses[i].universe, interfaces);
+                }
+            }
+            freeifaddrs(interfaces);
+        } else {
+            LogErr(VB_E131BRIDGE, "Could not create E1.31 receive sockets\n");
+        }
+    }
+
+    if (hasArtNet && artnetSock >= 0) {
+        // the main ArtNet socket is first in the reuseport group and keeps
+        // everything but ArtDmx (poll, sync, timecode...), ArtDmx is spread
+        // over the threads by universe
+        bool ok = true;
+        for (auto t : receiveThreads) {
+            t->artnetSock = CreateReceiveSocket(0x1936, true);
+            ok &= t->artnetSock >= 0;
+        }
+        struct sock_filter artnetSteer[] = {
+            BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 8),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x0050, 1, 0),
+            BPF_STMT(BPF_RET | BPF_K, 0),
+            BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 15),
+            BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0x7F),
+            BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 8),
+            BPF_STMT(BPF_MISC | BPF_TAX, 0),
+            BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 14),
+            BPF_STMT(BPF_ALU | BPF_OR | BPF_X, 0),
+            BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, (uint32_t)count),
+            BPF_STMT(BPF_ALU | BPF_ADD | BPF_K, 1),
+            BPF_STMT(BPF_RET | BPF_A, 0),
+        };
+        if (ok && AttachSteeringProgram(artnetSock, artnetSteer, 12)) {
+            artnetReceiveThreads = count;
+        } else {
+            // main socket wasn't created with SO_REUSEPORT or no BPF,
+            // ArtNet stays on the main loop
+            LogWarn(VB_E131BRIDGE, "ArtNet input will be received on the main thread\n");
+            for (auto t : receiveThreads) {
+                if (t->artnetSock >= 0) {
+                    close(t->artnetSock);
+                    t->artnetSock = -1;
+                }
+            }
+        }
+    }
+
+    runReceiveThreads = true;
+    for (auto t : receiveThreads) {
+        t->thread = new std::thread(RunBridgeReceiveThread, t);
+    }
+    LogInfo(VB_E131BRIDGE, "Started %d bridge receive threads, E1.31 on %d, ArtNet on %d\n",
+            count, e131ReceiveThreads, artnetReceiveThreads);
+#endif
+}
+
+static void StopReceiveThreads() {
+    runReceiveThreads = false;
+    for (auto t : receiveThreads) {
+        if (t->thread) {
+            t->thread->join();
+            delete t->thread;
+        }
+        delete t;
+    }
+    receiveThreads.clear();
+    e131ReceiveThreads = 0;
+    artnetReceiveThreads = 0;
+}
+
 bool Bridge_Initialize_Internal() {
     LogExcess(VB_E131BRIDGE, "Bridge_Initialize()\n");
 
@@ -301,6 +1054,20 @@ bool Bridge_Initialize_Internal() {
     }
 
     bool enabled = LoadInputUniversesFromFile();
+    if (mergeMode != BridgeMergeMode::NONE) {
+        universeMerges.resize(InputUniverseCount, nullptr);
+    }
+    universeTiming.assign(InputUniverseCount, UniverseTiming());
+    universeCounters.reset(new UniverseCounters[InputUniverseCount]);
+    if (zeroCopy) {
+        int slots = InputUniverseCount * 2 + MAX_MSG * (1 + receiveThreadCount);
+        slotPool = (uint8_t*)calloc(slots, BRIDGE_SLOT_SIZE);
+        for (int x = 0; x < slots; x++) {
+            freeSlots.push_back(&slotPool[x * BRIDGE_SLOT_SIZE]);
+        }
+        universeSlots.assign(InputUniverseCount, { nullptr, nullptr });
+        memset(msgSlots, 0, sizeof(msgSlots));
+    }
     bool disableFakeBridges = getSettingInt("DisableFakeNetworkBridges");
 
     LogInfo(VB_E131BRIDGE, "Universe Count = %d\n", InputUniverseCount);
@@ -314,12 +1081,19 @@ bool Bridge_Initialize_Internal() {
     int i2 = socket(AF_INET, SOCK_DGRAM, 0);
     int i3 = socket(AF_INET, SOCK_DGRAM, 0);
 
-    if (enabled || !disableFakeBridges) {
+#ifdef PLATFORM_OSX
+    receiveThreadCount = 0;
+#endif
+    // with receive threads, the E1.31 and DDP sockets belong to the threads
+    bool threaded = enabled && receiveThreadCount > 0;
+
+    if ((enabled || !disableFakeBridges) && !threaded) {
         ddpSock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
         if (ddpSock < 0) {
             LogDebug(VB_E131BRIDGE, "e131bridge DDP socket failed: %s", strerror(errno));
             exit(1);
         }
+        EnableTimestamps(ddpSock);
         memset((char*)&addr, 0, sizeof(addr));
         addr.sin_family = AF_INET;
         addr.sin_addr.s_addr = htonl(INADDR_ANY);
@@ -344,16 +1118,14 @@ bool Bridge_Initialize_Internal() {
         }
     }
 
-    if (hase131 || !disableFakeBridges) {
-        int UniverseOctet[2];
-        struct ip_mreq mreq;
-        char strMulticastGroup[16];
+    if ((hase131 || !disableFakeBridges) && !threaded) {
         /* set up socket */
         bridgeSock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
         if (bridgeSock < 0) {
             LogDebug(VB_E131BRIDGE, "e131bridge socket failed: %s", strerror(errno));
             exit(1);
         }
+        EnableTimestamps(bridgeSock);
 
         // FIXME, move this to /etc/sysctl.conf or our startup script
 #ifndef PLATFORM_OSX
@@ -372,52 +1144,13 @@ bool Bridge_Initialize_Internal() {
         }
 
         //get all the addresses
-        struct ifaddrs *interfaces, *tmp;
+        struct ifaddrs* interfaces;
         getifaddrs(&interfaces);
 
-        char address[16];
-        address[0] = 0;
         // Join the multicast groups
         for (int i = 0; i < InputUniverseCount; i++) {
             if (InputUniverses[i].type == E131_TYPE_MULTICAST) {
-                UniverseOctet[0] = InputUniverses[i].universe / 256;
-                UniverseOctet[1] = InputUniverses[i].universe % 256;
-                sprintf(strMulticastGroup, "239.255.%d.%d", UniverseOctet[0], UniverseOctet[1]);
-                mreq.imr_multiaddr.s_addr = inet_addr(strMulticastGroup);
-
-                LogInfo(VB_E131BRIDGE, "Adding group %s\n", strMulticastGroup);
-
-                // add group to groups to listen for on eth0 and wlan0 if it exists
-                int multicastJoined = 0;
-                tmp = interfaces;
-                //loop through all the interfaces and subscribe to the group
-                while (tmp) {
-                    //struct sockaddr_in *sin = (struct sockaddr_in *)tmp->ifa_addr;
-                    //strcpy(address, inet_ntoa(sin->sin_addr));
-                    if (tmp->ifa_addr && tmp->ifa_addr->sa_family == AF_INET) {
-                        GetInterfaceAddress(tmp->ifa_name, address, NULL, NULL);
-                        if (strcmp(address, "127.0.0.1")) {
-                            LogDebug(VB_E131BRIDGE, "   Adding interface %s - %s\n", tmp->ifa_name, address);
-                            mreq.imr_interface.s_addr = inet_addr(address);
-                            if (setsockopt(bridgeSock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
-                                LogWarn(VB_E131BRIDGE, "   Could not setup Multicast Group for interface %s\n", tmp->ifa_name);
-                            }
-                            multicastJoined = 1;
-                        }
-                    } else if (tmp->ifa_addr && tmp->ifa_addr->sa_family == AF_INET6) {
-                        //FIXME for ipv6 multicast
-                        //LogDebug(VB_E131BRIDGE, "   Inet6 interface %s\n", tmp->ifa_name);
-                    }
-                    tmp = tmp->ifa_next;
-                }
-
-                if (!multicastJoined) {
-                    LogDebug(VB_E131BRIDGE, "  Binding to default interface\n");
-                    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
-                    if (setsockopt(bridgeSock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
-                        LogWarn(VB_E131BRIDGE, "   Could not setup Multicast Group\n");
-                    }
-                }
+                JoinMulticastGroup(bridgeSock, InputUniverses[i].universe, interfaces);
             }
         }
         freeifaddrs(interfaces);
@@ -426,6 +1159,9 @@ bool Bridge_Initialize_Internal() {
     if (hasArtNet || getSettingInt("ARTNETTimeCodeSync", 0)) {
         CreateArtNetSocket();
     }
+    if (threaded) {
+        StartReceiveThreads(hase131, hasArtNet);
+    }
 
     StartChannelOutputThread();
 
@@ -439,43 +1175,180 @@ bool Bridge_Initialize_Internal() {
     return enabled;
 }
 
-bool Bridge_StoreData(uint8_t* bridgeBuffer, long long packetTime) {
+// Returns the data to output for the universe after merging in this
+// packet, nullptr if the packet doesn't change the output (lower priority
+// or a terminated stream)
+static uint8_t* MergeE131Source(uint32_t universeIndex, uint8_t* bridgeBuffer, uint8_t* data, int size, long long packetTime) {
+    E131UniverseMerge*& m = universeMerges[universeIndex];
+    if (!m) {
+        m = new E131UniverseMerge();
+    }
+    uint8_t* cid = &bridgeBuffer[E131_CID_INDEX];
+    int priority = bridgeBuffer[E131_PRIORITY_INDEX];
+
+    E131MergeSource* src = nullptr;
+    E131MergeSource* freeSlot = nullptr;
+    int top = -1;
+    for (auto& s : m->sources) {
+        if (s.priority < 0) {
+            if (!freeSlot) {
+                freeSlot = &s;
+            }
+        } else if (!memcmp(s.cid, cid, E131_CID_LENGTH)) {
+            src = &s;
+        } else if ((packetTime - s.lastSeen) > E131_NETWORK_DATA_LOSS_TIMEOUT) {
+            s.priority = -1;
+            sourceTimeouts++;
+            if (!freeSlot) {
+                freeSlot = &s;
+            }
+        } else {
+            top = std::max(top, s.priority);
+        }
+    }
+    if (bridgeBuffer[E131_OPTIONS_INDEX] & E131_OPTION_STREAM_TERMINATED) {
+        if (src) {
+            src->priority = -1;
+            sourcesTerminated++;
+        }
+        return nullptr;
+    }
+    uint32_t sn = bridgeBuffer[E131_SEQUENCE_INDEX];
+    if (!src) {
+        if (!freeSlot) {
+            sourcesRejected++;
+            return nullptr;
+        }
+        src = freeSlot;
+        memcpy(src->cid, cid, E131_CID_LENGTH);
+        // start from what is being output so, for LTP, anything the new
+        // source sends that differs counts as a change
+        memcpy(src->data, m->winner ? m->winner->data : (top >= 0 ? m->merged : data), size);
+    } else {
+        CheckSequence(universeIndex, src->lastSequenceNumber, sn);
+    }
+    src->lastSequenceNumber = sn;
+    src->priority = priority;
+    src->lastSeen = packetTime;
+
+    if (priority < top) {
+        memcpy(src->data, data, size);
+        lowerPriorityPackets++;
+        return nullptr;
+    }
+    if (priority > top) {
+        // only source at this priority, pass it through
+        if (m->winner != src) {
+            m->winner = src;
+            sourceChanges++;
+        }
+        memcpy(src->data, data, size);
+        return src->data;
+    }
+
+    mergedPackets++;
+    if (mergeMode == BridgeMergeMode::LTP) {
+        if (m->winner) {
+            // just started merging, carry on from what was being output
+            memcpy(m->merged, m->winner->data, size);
+            m->winner = nullptr;
+            sourceChanges++;
+        }
+        for (int x = 0; x < size; x++) {
+            if (data[x] != src->data[x]) {
+                m->merged[x] = data[x];
+            }
+        }
+        memcpy(src->data, data, size);
+    } else {
+        if (m->winner) {
+            m->winner = nullptr;
+            sourceChanges++;
+        }
+        memcpy(src->data, data, size);
+        memcpy(m->merged, data, size);
+        for (auto& s : m->sources) {
+            if (&s != src && s.priority == top) {
+                for (int x = 0; x < size; x++) {
+                    m->merged[x] = std::max(m->merged[x], s.data[x]);
+                }
+            }
+        }
+    }
+    return m->merged;
+}
+
+// hands the slot holding a universe's data to the sequence, returns the slot
+// to receive the next packet into
+static uint8_t* PublishBridgeSlot(uint32_t universeIndex, uint8_t* slot, int len, long long packetTime) {
+    uint64_t none = 0;
+    oldestUnsentArrival.compare_exchange_strong(none, packetArrivalNS ? packetArrivalNS : RealtimeNanos());
+    last_packet_time = packetTime;
+    bridgeDataReceived = true;
+    if (!sequence->SetBridgeSlot(slot, InputUniverses[universeIndex].startAddress - 1, len, packetTime + expireOffSet)) {
+        return slot;
+    }
+    std::array<uint8_t*, 2>& published = universeSlots[universeIndex];
+    uint8_t* prev = published[1];
+    published[1] = published[0];
+    published[0] = slot;
+    return prev ? prev : AllocateSlot();
+}
+
+bool Bridge_StoreData(uint8_t* bridgeBuffer, long long packetTime, uint8_t** slot) {
     if ((bridgeBuffer[E131_VECTOR_INDEX] == VECTOR_ROOT_E131_DATA) &&
         (bridgeBuffer[E131_START_CODE] == 0x00)) {
         uint32_t universe = ((int)bridgeBuffer[E131_UNIVERSE_INDEX] << 8) + bridgeBuffer[E131_UNIVERSE_INDEX + 1];
         uint32_t universeIndex = Bridge_GetIndexFromUniverseNumber(universe);
         if (universeIndex != BRIDGE_INVALID_UNIVERSE_INDEX) {
             uint32_t sn = bridgeBuffer[E131_SEQUENCE_INDEX];
-            if (InputUniverses[universeIndex].packetsReceived != 0) {
-                if (InputUniverses[universeIndex].lastSequenceNumber == 255) {
-                    // some wrap from 255 -> 1 and some from 255 -> 0, spec doesn't say which
-                    if (sn != 0 && sn != 1) {
-                        ++InputUniverses[universeIndex].errorPackets;
-                    }
-                } else if ((InputUniverses[universeIndex].lastSequenceNumber + 1) != sn) {
-                    ++InputUniverses[universeIndex].errorPackets;
+            uint8_t* data = slot ? *slot : &bridgeBuffer[E131_HEADER_LENGTH];
+            int len = InputUniverses[universeIndex].size;
+            if (slot) {
+                len = std::min(len, BRIDGE_SLOT_SIZE);
+            }
+            TrackUniverseArrival(universeIndex);
+            if (mergeMode != BridgeMergeMode::NONE) {
+                // sequence numbers are checked per source
+                len = std::min(len, 512);
+                data = MergeE131Source(universeIndex, bridgeBuffer, data, len, packetTime);
+            } else {
+                if (universeCounters[universeIndex].packets.load(std::memory_order_relaxed) != 0) {
+                    CheckSequence(universeIndex, InputUniverses[universeIndex].lastSequenceNumber, sn);
                 }
             }
             InputUniverses[universeIndex].lastSequenceNumber = sn;
 
-            SetBridgeData(&bridgeBuffer[E131_HEADER_LENGTH],
-                          InputUniverses[universeIndex].startAddress - 1,
-                          InputUniverses[universeIndex].size,
-                          packetTime);
-            InputUniverses[universeIndex].bytesReceived += InputUniverses[universeIndex].size;
-            InputUniverses[universeIndex].packetsReceived++;
+            if (data == nullptr) {
+                // lower priority source, nothing to output
+            } else if (bridgeBuffer[E131_SYNC_ADDRESS_INDEX] || bridgeBuffer[E131_SYNC_ADDRESS_INDEX + 1]) {
+                // only data that names a sync universe waits for the sync
+                StageBridgeData(data,
+                                InputUniverses[universeIndex].startAddress - 1,
+                                len,
+                                packetTime);
+            } else if (slot && data == *slot) {
+                *slot = PublishBridgeSlot(universeIndex, *slot, len, packetTime);
+            } else {
+                SetBridgeData(data,
+                              InputUniverses[universeIndex].startAddress - 1,
+                              len,
+                              packetTime);
+            }
+            universeCounters[universeIndex].bytes.fetch_add(InputUniverses[universeIndex].size, std::memory_order_relaxed);
+            universeCounters[universeIndex].packets.fetch_add(1, std::memory_order_relaxed);
         } else {
-            unknownUniverse.packetsReceived++;
+            unknownPackets++;
             uint32_t len = bridgeBuffer[16] & 0xF;
             len <<= 8;
             len += bridgeBuffer[17];
-            unknownUniverse.bytesReceived += len;
+            unknownBytes += len;
             LogDebug(VB_E131BRIDGE, "Received e1.31 data packet for unconfigured universe %d\n", universe);
         }
     } else if (bridgeBuffer[E131_VECTOR_INDEX] == VECTOR_ROOT_E131_EXTENDED) {
         if (bridgeBuffer[E131_EXTENDED_PACKET_TYPE_INDEX] == VECTOR_E131_EXTENDED_SYNCHRONIZATION) {
             e131SyncPackets++;
-            return true;
+            return Bridge_Synced(packetTime);
         }
         e131Errors++;
         LogDebug(VB_E131BRIDGE, "Unknown e1.31 extended packet type %d\n", (int)bridgeBuffer[E131_EXTENDED_PACKET_TYPE_INDEX]);
@@ -488,7 +1361,7 @@ bool Bridge_StoreData(uint8_t* bridgeBuffer, long long packetTime) {
 
 bool Bridge_HandleArtNetSync(uint8_t* bridgeBuffer, long long packetTime) {
     //sync packet
-    return true;
+    return Bridge_Synced(packetTime);
 }
 bool Bridge_StoreArtNetData(uint8_t* bridgeBuffer, long long packetTime) {
     if (bridgeBuffer[9] == 0x50 && bridgeBuffer[8] == 0x00) {
@@ -506,31 +1379,25 @@ bool Bridge_StoreArtNetData(uint8_t* bridgeBuffer, long long packetTime) {
         len += bridgeBuffer[17];
         uint32_t universeIndex = Bridge_GetIndexFromUniverseNumber(univ);
         if (universeIndex != BRIDGE_INVALID_UNIVERSE_INDEX) {
-            if (InputUniverses[universeIndex].packetsReceived != 0) {
-                if (InputUniverses[universeIndex].lastSequenceNumber == 255) {
-                    // some wrap from 255 -> 1 and some from 255 -> 0
-                    if (sn != 0 && sn != 1) {
-                        ++InputUniverses[universeIndex].errorPackets;
-                    }
-                } else if ((InputUniverses[universeIndex].lastSequenceNumber + 1) != sn) {
-                    ++InputUniverses[universeIndex].errorPackets;
-                }
+            TrackUniverseArrival(universeIndex);
+            if (universeCounters[universeIndex].packets.load(std::memory_order_relaxed) != 0) {
+                CheckSequence(universeIndex, InputUniverses[universeIndex].lastSequenceNumber, sn);
             }
             InputUniverses[universeIndex].lastSequenceNumber = sn;
-            InputUniverses[universeIndex].bytesReceived += std::min(InputUniverses[universeIndex].size, len);
-            InputUniverses[universeIndex].packetsReceived++;
+            universeCounters[universeIndex].bytes.fetch_add(std::min(InputUniverses[universeIndex].size, len), std::memory_order_relaxed);
+            universeCounters[universeIndex].packets.fetch_add(1, std::memory_order_relaxed);
 
-            SetBridgeData(&bridgeBuffer[18],
-                          InputUniverses[universeIndex].startAddress - 1,
-                          std::min(InputUniverses[universeIndex].size, len),
-                          packetTime);
+            StageBridgeData(&bridgeBuffer[18],
+                            InputUniverses[universeIndex].startAddress - 1,
+                            std::min(InputUniverses[universeIndex].size, len),
+                            packetTime);
 
         } else {
-            unknownUniverse.packetsReceived++;
+            unknownPackets++;
             uint32_t len = bridgeBuffer[16] & 0xF;
             len <<= 8;
             len += bridgeBuffer[17];
-            unknownUniverse.bytesReceived += len;
+            unknownBytes += len;
             LogDebug(VB_E131BRIDGE, "Received ArtNet data packet for unconfigured universe %d\n", univ);
         }
     }
@@ -660,11 +1527,14 @@ bool Bridge_StoreDDPData(uint8_t* bridgeBuffer, long long packetTime) {
         ddpMaxChannel = std::max(ddpMaxChannel, chan + len);
 
         int offset = tc ? 14 : 10;
-        SetBridgeData(&bridgeBuffer[offset],
-                      chan,
-                      len,
-                      packetTime);
+        StageBridgeData(&bridgeBuffer[offset],
+                        chan,
+                        len,
+                        packetTime);
         ddpBytesReceived += len;
+        if (push) {
+            Bridge_Synced(packetTime);
+        }
     } else if (bridgeBuffer[0] & 0x02 && bridgeBuffer[3] == 250) {
         printf("Query config packet: %d \n", (int)bridgeBuffer[3]);
     } else if (bridgeBuffer[0] & 0x02 && bridgeBuffer[3] == 251) {
@@ -692,6 +1562,18 @@ inline int Bridge_GetIndexFromUniverseNumber(int universe) {
 }
 
 void Bridge_Shutdown(void) {
+    StopReceiveThreads();
+    if (slotPool) {
+        sequence->ClearBridgeSlots();
+        free(slotPool);
+        slotPool = nullptr;
+        freeSlots.clear();
+        universeSlots.clear();
+    }
+    for (auto m : universeMerges) {
+        delete m;
+    }
+    universeMerges.clear();
     if (bridgeSock >= 0)
         close(bridgeSock);
     if (ddpSock >= 0)
@@ -707,15 +1589,40 @@ void Bridge_Shutdown(void) {
 
 void ResetBytesReceived() {
     for (int i = 0; i < InputUniverseCount; i++) {
-        InputUniverses[i].bytesReceived = 0;
-        InputUniverses[i].packetsReceived = 0;
-        InputUniverses[i].errorPackets = 0;
+        if (universeCounters) {
+            universeCounters[i].bytes.store(0, std::memory_order_relaxed);
+            universeCounters[i].packets.store(0, std::memory_order_relaxed);
+            universeCounters[i].errors.store(0, std::memory_order_relaxed);
+        }
         InputUniverses[i].lastSequenceNumber = 0;
+        if (i < universeTiming.size()) {
+            universeTiming[i].gaps = 0;
+            universeTiming[i].outOfOrder = 0;
+        }
     }
+    receiveDelayHistogram.Reset();
+    jitterHistogram.Reset();
+    outputLatencyHistogram.Reset();
     ddpBytesReceived = 0;
     ddpPacketsReceived = 0;
     ddpErrors = 0;
     e131Errors = 0;
+    syncLatchFrames = 0;
+    syncLatchTimeouts = 0;
+    mergedPackets = 0;
+    lowerPriorityPackets = 0;
+    sourceChanges = 0;
+    sourceTimeouts = 0;
+    sourcesTerminated = 0;
+    sourcesRejected = 0;
+    for (auto t : receiveThreads) {
+        t->packets = 0;
+        t->bytes = 0;
+        t->ignored = 0;
+        for (int x = 0; x < 3; x++) {
+            t->overflowBase[x] = (uint32_t)t->overflow[x];
+        }
+    }
 }
 
 Json::Value GetE131UniverseBytesReceived() {
@@ -760,9 +1667,28 @@ Json::Value GetE131UniverseBytesReceived() {
         universe["id"] = InputUniverses[i].universe;
         universe["startChannel"] = InputUniverses[i].startAddress;
 
-        universe["bytesReceived"] = std::to_string(InputUniverses[i].bytesReceived);
-        universe["packetsReceived"] = std::to_string(InputUniverses[i].packetsReceived);
-        universe["errors"] = std::to_string(InputUniverses[i].errorPackets);
+        if (universeCounters) {
+            universe["bytesReceived"] = std::to_string(universeCounters[i].bytes.load(std::memory_order_relaxed));
+            universe["packetsReceived"] = std::to_string(universeCounters[i].packets.load(std::memory_order_relaxed));
+            universe["errors"] = std::to_string(universeCounters[i].errors.load(std::memory_order_relaxed));
+        }
+        if (i < universeMerges.size() && universeMerges[i]) {
+            long long now = GetTimeMS();
+            int sources = 0;
+            for (auto& s : universeMerges[i]->sources) {
+                if (s.priority >= 0 && (now - s.lastSeen) <= E131_NETWORK_DATA_LOSS_TIMEOUT) {
+                    sources++;
+                }
+            }
+            universe["sources"] = sources;
+        }
+        if (i < universeTiming.size() && universeTiming[i].lastArrival) {
+            // microseconds
+            universe["interval"] = (int)universeTiming[i].interval;
+            universe["jitter"] = (int)universeTiming[i].jitter;
+            universe["gaps"] = universeTiming[i].gaps;
+            universe["outOfOrder"] = universeTiming[i].outOfOrder;
+        }
 
         universes.append(universe);
     }
@@ -781,7 +1707,7 @@ Json::Value GetE131UniverseBytesReceived() {
 
         universes.append(universe);
     }
-    if (unknownUniverse.packetsReceived) {
+    if (unknownPackets) {
         Json::Value universe;
 
         universe["id"] = "Ignored";
@@ -792,12 +1718,12 @@ Json::Value GetE131UniverseBytesReceived() {
         std::string errors = er.str();
 
         std::stringstream ss;
-        ss << unknownUniverse.bytesReceived;
+        ss << unknownBytes;
         std::string bytesReceived = ss.str();
         universe["bytesReceived"] = bytesReceived;
 
         std::stringstream pr;
-        pr << unknownUniverse.packetsReceived;
+        pr << unknownPackets;
         std::string packetsReceived = pr.str();
         universe["packetsReceived"] = packetsReceived;
 
@@ -821,9 +1747,69 @@ Json::Value GetE131UniverseBytesReceived() {
 
         universes.append(universe);
     }
+    if (syncLatch && (syncLatchFrames || syncLatchTimeouts)) {
+        Json::Value universe;
+
+        universe["id"] = "Sync Latch";
+        universe["startChannel"] = "-";
+        universe["bytesReceived"] = "-";
+        // frames released by a sync, errors are frames released by the timeout
+        universe["packetsReceived"] = std::to_string(syncLatchFrames);
+        universe["errors"] = std::to_string(syncLatchTimeouts);
+
+        universes.append(universe);
+    }
 
     result["universes"] = universes;
 
+    if (mergeMode != BridgeMergeMode::NONE) {
+        Json::Value merge;
+        merge["mode"] = mergeMode == BridgeMergeMode::HTP ? "htp" : "ltp";
+        // packets that had to be merged with another source at the same priority
+        merge["mergedPackets"] = (Json::UInt64)mergedPackets;
+        // packets ignored as a higher priority source is live
+        merge["lowerPriorityPackets"] = (Json::UInt64)lowerPriorityPackets;
+        merge["sourceChanges"] = (Json::UInt64)sourceChanges;
+        merge["sourceTimeouts"] = (Json::UInt64)sourceTimeouts;
+        merge["sourcesTerminated"] = (Json::UInt64)sourcesTerminated;
+        // new sources that didn't fit in a universe's source slots
+        merge["sourcesRejected"] = (Json::UInt64)sourcesRejected;
+        result["merge"] = merge;
+    }
+
+    if (receiveDelayHistogram.count) {
+        // histograms in microseconds
+        Json::Value timing;
+        // kernel arrival timestamp to the packet being processed
+        timing["receiveDelay"] = receiveDelayHistogram.ToJson();
+        // change in time between packets of a universe
+        timing["jitter"] = jitterHistogram.ToJson();
+        // oldest packet of a frame arriving to the frame being sent
+        timing["outputLatency"] = outputLatencyHistogram.ToJson();
+        result["timing"] = timing;
+    }
+
+    if (!receiveThreads.empty()) {
+        Json::Value threads(Json::arrayValue);
+        for (auto t : receiveThreads) {
+            Json::Value th;
+            th["thread"] = t->index;
+            th["cpu"] = t->cpu;
+            th["packets"] = (Json::UInt64)t->packets;
+            th["bytes"] = (Json::UInt64)t->bytes;
+            // broadcasts for other threads' universes and non data packets
+            th["ignored"] = (Json::UInt64)t->ignored;
+            uint32_t ovfl = 0;
+            for (int x = 0; x < 3; x++) {
+                ovfl += t->overflow[x] - t->overflowBase[x];
+            }
+            // dropped by the kernel, socket receive buffer full
+            th["overflow"] = ovfl;
+            threads.append(th);
+        }
+        result["receiveThreads"] = threads;
+    }
+
     return result;
 }
 
@@ -903,7 +1889,9 @@ void Bridge_Initialize(std::map<int, std::function<bool(int)>>& callbacks) {
     }
     if (artnetSock > 0) {
         if (enabled) {
-            AddArtNetOpcodeHandler(0x5000, Bridge_StoreArtNetData);  // ArtOutput
+            if (!artnetReceiveThreads) {
+                AddArtNetOpcodeHandler(0x5000, Bridge_StoreArtNetData); // ArtOutput
+            }
             AddArtNetOpcodeHandler(0x5200, Bridge_HandleArtNetSync); // ArtSync
             AddArtNetOpcodeHandler(0x2000, Bridge_HandleArtNetPoll); // ArtPoll
 
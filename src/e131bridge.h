@@ -11,6 +11,7 @@
  * included LICENSE.LGPL file.
  */
 
+#include <cstdint>
 #include <functional>
 #include <map>
 
@@ -18,6 +19,9 @@ double GetSecondsFromInputPacket();
 void Fake_Bridge_Initialize(std::map<int, std::function<bool(int)>>& callbacks);
 
 void Bridge_Initialize(std::map<int, std::function<bool(int)>>& callbacks);
+// use config (ci-universes.json format) instead of the file, for tools
+// running the bridge in process.  Must be called before Bridge_Initialize.
+void Bridge_SetConfig(const Json::Value& config);
 void Bridge_Shutdown(void);
 
 int CreateArtNetSocket();
@@ -25,6 +29,16 @@ bool Bridge_ReceiveArtNetData();
 void AddArtNetOpcodeHandler(int opCode, std::function<bool(uint8_t *data, long long packetTime)> handler);
 void RemoveArtNetOpcodeHandler(int opCode);
 
+// releases staged sync latch data that has waited too long for its sync,
+// returns true if the output should be pushed now
+bool Bridge_CheckSyncLatch();
+
+// receive to wire latency tracking for the output thread, take the arrival
+// time of the oldest bridged packet before processing the frame and pass it
+// back once the frame has been sent
+uint64_t Bridge_TakeOldestArrival();
+void Bridge_FrameSent(uint64_t arrival);
+
 void ResetBytesReceived();
 bool HasBridgeData();
 Json::Value GetE131UniverseBytesReceived();
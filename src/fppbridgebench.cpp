@@ -0,0 +1,724 @@
+/*
+ * This file is part of the Falcon Player (FPP) and is Copyright (C)
+ * 2013-2022 by the Falcon Player Developers.
+ *
+ * The Falcon Player (FPP) is free software, and is covered under
+ * multiple Open Source licenses.  Please see the included 'LICENSES'
+ * file for descriptions of what files are covered by each license.
+ *
+ * This source file is covered under the GPL v2 as described in the
+ * included LICENSE.GPL file.
+ */
+
+/*
+ * E1.31/ArtNet/DDP load generator and bridge benchmark.
+ *
+ * With -H the tool only generates traffic, for loading a remote FPP or
+ * the UDP outputs of another tool.  Otherwise the fppd bridge code is
+ * started in process with a matching input configuration, the generator
+ * is forked off to send to localhost and the bridge's throughput, drops,
+ * sequence errors, latency and CPU per packet are reported.
+ */
+
+#include "fpp-pch.h"
+
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "channeloutput/channeloutputthread.h"
+#include "e131bridge.h"
+#include "e131defs.h"
+#include "fppversion.h"
+
+#define ARTNET_PORT 0x1936
+#define DDP_PORT 4048
+#define DDP_PUSH_FLAG 0x01
+#define DDP_HEADER_LENGTH 10
+#define DDP_CHANNELS_PER_PACKET 1440
+#define SEND_BATCH 64
+
+enum class Protocol {
+    E131,
+    ARTNET,
+    DDP
+};
+
+static Protocol protocol = Protocol::E131;
+static int universeCount = 32;
+static int firstUniverse = 1;
+static int channelCount = 512;
+static int frameRate = 40;
+static int duration = 10;
+static double lossPercent = 0.0;
+static double reorderPercent = 0.0;
+static int sourceCount = 1;
+static int priority = 100;
+static bool multicast = false;
+static int syncUniverse = 0;
+static std::string host;
+
+static int receiveThreads = 0;
+static std::string mergeMode;
+static bool zeroCopy = false;
+static bool syncLatch = false;
+static bool jsonOutput = false;
+
+class GeneratorResults {
+public:
+    uint64_t frames = 0;
+    // data packets, sync packets are counted separately as the bridge
+    // doesn't count them against any universe
+    uint64_t packets = 0;
+    uint64_t syncPackets = 0;
+    uint64_t bytes = 0;
+    uint64_t dropped = 0;
+    uint64_t reordered = 0;
+    uint64_t sendErrors = 0;
+    uint64_t lateFrames = 0;
+};
+
+void usage(char* appname) {
+    printf("Usage: %s [OPTIONS]\n", appname);
+    printf("\n");
+    printf("  Generator Options:\n");
+    printf("   -p PROTOCOL       - e131, artnet or ddp (default e131)\n");
+    printf("   -u #              - Universe count (default 32)\n");
+    printf("   -s #              - First universe (default 1)\n");
+    printf("   -c #              - Channels per universe (default 512)\n");
+    printf("   -r #              - Frames per second (default 40)\n");
+    printf("   -d #              - Duration in seconds (default 10)\n");
+    printf("   -l #              - Percent of packets to drop\n");
+    printf("   -o #              - Percent of packets to send out of order\n");
+    printf("   -S #              - Number of E1.31 sources (CIDs) sending every universe\n");
+    printf("   -P #              - E1.31 source priority (default 100)\n");
+    printf("   -m                - Send E1.31 multicast instead of unicast\n");
+    printf("   -y #              - Send syncs, E1.31 sync universe # / ArtSync / DDP push\n");
+    printf("   -H HOST           - Only generate, sending to HOST\n");
+    printf("\n");
+    printf("  Bridge Options:\n");
+    printf("   -t #              - Bridge receive threads\n");
+    printf("   -M (htp|ltp)      - sACN merge mode\n");
+    printf("   -z                - Zero copy E1.31 receive\n");
+    printf("   -L                - Sync latch\n");
+    printf("   -j                - Output the results as json\n");
+    printf("   -V                - Print version information\n");
+    printf("   -h                - This help output\n");
+}
+
+int parseArguments(int argc, char** argv) {
+    int c;
+    while ((c = getopt(argc, argv, "p:u:s:c:r:d:l:o:S:P:my:H:t:M:zLjVh")) != -1) {
+        switch (c) {
+        case 'p':
+            if (!strcmp(optarg, "artnet")) {
+                protocol = Protocol::ARTNET;
+            } else if (!strcmp(optarg, "ddp")) {
+                protocol = Protocol::DDP;
+            } else {
+                protocol = Protocol::E131;
+            }
+            break;
+        case 'u':
+            universeCount = std::clamp(atoi(optarg), 1, 32000);
+            break;
+        case 's':
+            firstUniverse = std::clamp(atoi(optarg), 0, 63999);
+            break;
+        case 'c':
+            channelCount = std::clamp(atoi(optarg), 1, 512);
+            break;
+        case 'r':
+            frameRate = std::clamp(atoi(optarg), 1, 1000);
+            break;
+        case 'd':
+            duration = std::max(atoi(optarg), 1);
+            break;
+        case 'l':
+            lossPercent = atof(optarg);
+            break;
+        case 'o':
+            reorderPercent = atof(optarg);
+            break;
+        case 'S':
+            sourceCount = std::clamp(atoi(optarg), 1, 16);
+            break;
+        case 'P':
+            priority = std::clamp(atoi(optarg), 0, 200);
+            break;
+        case 'm':
+            multicast = true;
+            break;
+        case 'y':
+            syncUniverse = std::clamp(atoi(optarg), 1, 63999);
+            break;
+        case 'H':
+            host = optarg;
+            break;
+        case 't':
+            receiveThreads = std::clamp(atoi(optarg), 0, 16);
+            break;
+        case 'M':
+            mergeMode = optarg;
+            break;
+        case 'z':
+            zeroCopy = true;
+            break;
+        case 'L':
+            syncLatch = true;
+            break;
+        case 'j':
+            jsonOutput = true;
+            break;
+        case 'V':
+            printVersionInfo();
+            exit(0);
+        case 'h':
+            usage(argv[0]);
+            exit(EXIT_SUCCESS);
+        default:
+            usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (protocol != Protocol::E131) {
+        sourceCount = 1;
+        multicast = false;
+    }
+    return optind;
+}
+
+static long long NowNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+class Packet {
+public:
+    std::vector<uint8_t> data;
+    struct sockaddr_in addr;
+    int seqIndex = -1;
+    int dataOffset = 0;
+    int dataLen = 0;
+};
+
+static void BuildE131Packet(Packet& p, int universe, int source) {
+    p.data.assign(E131_HEADER_LENGTH + channelCount, 0);
+    uint8_t* b = &p.data[0];
+    // root layer
+    b[1] = 0x10;
+    memcpy(&b[4], "ASC-E1.17", 9);
+    int count = p.data.size() - 16;
+    b[E131_RLP_COUNT_INDEX] = (count / 256) + 0x70;
+    b[E131_RLP_COUNT_INDEX + 1] = count % 256;
+    b[E131_VECTOR_INDEX] = VECTOR_ROOT_E131_DATA;
+    memcpy(&b[E131_CID_INDEX], "FPPBRIDGEBENCH", 14);
+    b[E131_CID_INDEX + 15] = source;
+    // framing layer
+    count = p.data.size() - 38;
+    b[E131_FRAMING_COUNT_INDEX] = (count / 256) + 0x70;
+    b[E131_FRAMING_COUNT_INDEX + 1] = count % 256;
+    b[43] = 0x02;
+    snprintf((char*)&b[44], 64, "fppbridgebench %d", source);
+    b[E131_PRIORITY_INDEX] = priority;
+    b[E131_SYNC_ADDRESS_INDEX] = syncUniverse / 256;
+    b[E131_SYNC_ADDRESS_INDEX + 1] = syncUniverse % 256;
+    b[E131_UNIVERSE_INDEX] = universe / 256;
+    b[E131_UNIVERSE_INDEX + 1] = universe % 256;
+    // DMP layer
+    count = p.data.size() - 115;
+    b[E131_DMP_COUNT_INDEX] = (count / 256) + 0x70;
+    b[E131_DMP_COUNT_INDEX + 1] = count % 256;
+    b[117] = 0x02;
+    b[118] = 0xa1;
+    b[122] = 0x01;
+    b[E131_COUNT_INDEX] = (channelCount + 1) / 256;
+    b[E131_COUNT_INDEX + 1] = (channelCount + 1) % 256;
+
+    p.seqIndex = E131_SEQUENCE_INDEX;
+    p.dataOffset = E131_HEADER_LENGTH;
+    p.dataLen = channelCount;
+}
+
+static void BuildArtNetPacket(Packet& p, int universe) {
+    p.data.assign(18 + channelCount, 0);
+    uint8_t* b = &p.data[0];
+    memcpy(b, "Art-Net", 8);
+    b[9] = 0x50;
+    b[11] = 14;
+    b[14] = universe & 0xFF;
+    b[15] = (universe >> 8) & 0x7F;
+    b[16] = channelCount / 256;
+    b[17] = channelCount % 256;
+    p.seqIndex = 12;
+    p.dataOffset = 18;
+    p.dataLen = channelCount;
+}
+
+static void BuildDDPPacket(Packet& p, uint32_t offset, int len) {
+    p.data.assign(DDP_HEADER_LENGTH + len, 0);
+    uint8_t* b = &p.data[0];
+    b[0] = 0x40;
+    b[2] = 0x01;
+    b[3] = 0x01;
+    b[4] = (offset >> 24) & 0xFF;
+    b[5] = (offset >> 16) & 0xFF;
+    b[6] = (offset >> 8) & 0xFF;
+    b[7] = offset & 0xFF;
+    b[8] = len / 256;
+    b[9] = len % 256;
+    p.seqIndex = 1;
+    p.dataOffset = DDP_HEADER_LENGTH;
+    p.dataLen = len;
+}
+
+static void SetAddress(Packet& p, const std::string& target, int port, int universe = -1) {
+    memset(&p.addr, 0, sizeof(p.addr));
+    p.addr.sin_family = AF_INET;
+    p.addr.sin_port = htons(port);
+    if (universe >= 0 && multicast) {
+        char addr[32];
+        snprintf(addr, sizeof(addr), "239.255.%d.%d", universe / 256, universe % 256);
+        p.addr.sin_addr.s_addr = inet_addr(addr);
+    } else {
+        p.addr.sin_addr.s_addr = inet_addr(target.c_str());
+    }
+}
+
+static std::vector<Packet> BuildPackets(const std::string& target) {
+    std::vector<Packet> packets;
+    if (protocol == Protocol::DDP) {
+        uint32_t total = universeCount * channelCount;
+        for (uint32_t o = 0; o < total; o += DDP_CHANNELS_PER_PACKET) {
+            Packet p;
+            BuildDDPPacket(p, o, std::min((uint32_t)DDP_CHANNELS_PER_PACKET, total - o));
+            SetAddress(p, target, DDP_PORT);
+            packets.push_back(p);
+        }
+        return packets;
+    }
+    for (int s = 0; s < sourceCount; s++) {
+        for (int u = 0; u < universeCount; u++) {
+            Packet p;
+            int universe = firstUniverse + u;
+            if (protocol == Protocol::E131) {
+                BuildE131Packet(p, universe, s);
+                SetAddress(p, target, E131_DEST_PORT, universe);
+            } else {
+                BuildArtNetPacket(p, universe);
+                SetAddress(p, target, ARTNET_PORT);
+            }
+            packets.push_back(p);
+        }
+    }
+    return packets;
+}
+
+static Packet BuildSyncPacket(const std::string& target) {
+    Packet p;
+    if (protocol == Protocol::E131) {
+        p.data.assign(E131_SYNC_PACKET_LENGTH, 0);
+        uint8_t* b = &p.data[0];
+        b[1] = 0x10;
+        memcpy(&b[4], "ASC-E1.17", 9);
+        int count = E131_SYNC_PACKET_LENGTH - 16;
+        b[E131_RLP_COUNT_INDEX] = (count / 256) + 0x70;
+        b[E131_RLP_COUNT_INDEX + 1] = count % 256;
+        b[E131_VECTOR_INDEX] = VECTOR_ROOT_E131_EXTENDED;
+        memcpy(&b[E131_CID_INDEX], "FPPBRIDGEBENCH", 14);
+        count = E131_SYNC_PACKET_LENGTH - 38;
+        b[E131_FRAMING_COUNT_INDEX] = (count / 256) + 0x70;
+        b[E131_FRAMING_COUNT_INDEX + 1] = count % 256;
+        b[E131_EXTENDED_PACKET_TYPE_INDEX] = VECTOR_E131_EXTENDED_SYNCHRONIZATION;
+        b[E131_SYNC_UNIVERSE_INDEX] = syncUniverse / 256;
+        b[E131_SYNC_UNIVERSE_INDEX + 1] = syncUniverse % 256;
+        p.seqIndex = E131_SYNC_SEQUENCE_INDEX;
+        SetAddress(p, target, E131_DEST_PORT, syncUniverse);
+    } else {
+        // ArtSync
+        p.data.assign(14, 0);
+        memcpy(&p.data[0], "Art-Net", 8);
+        p.data[9] = 0x52;
+        p.data[11] = 14;
+        SetAddress(p, target, ARTNET_PORT);
+    }
+    return p;
+}
+
+static GeneratorResults RunGenerator(const std::string& target, volatile bool* running = nullptr) {
+    GeneratorResults results;
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        fprintf(stderr, "Could not create socket: %s\n", strerror(errno));
+        return results;
+    }
+    int bufSize = 4 * 1024 * 1024;
+    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &bufSize, sizeof(bufSize));
+    int enable = 1;
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &enable, sizeof(enable));
+    setsockopt(sock, SOL_SOCKET, SO_BROADCAST, &enable, sizeof(enable));
+
+    std::vector<Packet> packets = BuildPackets(target);
+    bool sendSync = syncUniverse && protocol != Protocol::DDP;
+    Packet syncPacket;
+    if (sendSync) {
+        syncPacket = BuildSyncPacket(target);
+    }
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<double> percent(0.0, 100.0);
+    std::vector<int> order;
+    std::vector<struct mmsghdr> msgs;
+    std::vector<struct iovec> iovecs(packets.size() + 1);
+    uint8_t frameSequence = 0;
+    // DDP numbers every packet rather than every frame, so the sequence
+    // carries across frames like it does from a real sender
+    uint8_t ddpSequence = 0;
+
+    long long frameNanos = 1000000000LL / frameRate;
+    long long start = NowNanos();
+    long long frames = (long long)duration * frameRate;
+    for (long long f = 0; f < frames && (!running || *running); f++) {
+        frameSequence++;
+        uint8_t artSequence = (frameSequence % 255) + 1;
+        order.clear();
+        for (int x = 0; x < packets.size(); x++) {
+            Packet& p = packets[x];
+            uint8_t* b = &p.data[0];
+            // channel values change every frame, sources differ so HTP/LTP
+            // merging has work to do
+            memset(&b[p.dataOffset], (f + x / universeCount) & 0xFF, p.dataLen);
+            if (protocol == Protocol::E131) {
+                b[p.seqIndex] = frameSequence;
+            } else if (protocol == Protocol::ARTNET) {
+                b[p.seqIndex] = artSequence;
+            } else {
+                ddpSequence = (ddpSequence % 15) + 1;
+                b[p.seqIndex] = ddpSequence;
+                b[0] = 0x40 | ((syncUniverse && x == packets.size() - 1) ? DDP_PUSH_FLAG : 0);
+            }
+            if (lossPercent > 0 && percent(rng) < lossPercent) {
+                results.dropped++;
+                continue;
+            }
+            order.push_back(x);
+        }
+        if (reorderPercent > 0) {
+            for (int x = 0; x + 1 < order.size(); x++) {
+                if (percent(rng) < reorderPercent) {
+                    std::swap(order[x], order[x + 1]);
+                    results.reordered++;
+                    x++;
+                }
+            }
+        }
+
+        msgs.clear();
+        for (int x : order) {
+            Packet& p = packets[x];
+            struct mmsghdr m;
+            memset(&m, 0, sizeof(m));
+            iovecs[x].iov_base = &p.data[0];
+            iovecs[x].iov_len = p.data.size();
+            m.msg_hdr.msg_iov = &iovecs[x];
+            m.msg_hdr.msg_iovlen = 1;
+            m.msg_hdr.msg_name = &p.addr;
+            m.msg_hdr.msg_namelen = sizeof(p.addr);
+            msgs.push_back(m);
+            results.bytes += p.data.size();
+        }
+        if (sendSync) {
+            if (syncPacket.seqIndex >= 0) {
+                syncPacket.data[syncPacket.seqIndex] = frameSequence;
+            }
+            struct mmsghdr m;
+            memset(&m, 0, sizeof(m));
+            iovecs[packets.size()].iov_base = &syncPacket.data[0];
+            iovecs[packets.size()].iov_len = syncPacket.data.size();
+            m.msg_hdr.msg_iov = &iovecs[packets.size()];
+            m.msg_hdr.msg_iovlen = 1;
+            m.msg_hdr.msg_name = &syncPacket.addr;
+            m.msg_hdr.msg_namelen = sizeof(syncPacket.addr);
+            msgs.push_back(m);
+        }
+        for (int x = 0; x < msgs.size();) {
+            int cnt = sendmmsg(sock, &msgs[x], std::min((int)msgs.size() - x, SEND_BATCH), 0);
+            if (cnt <= 0) {
+                results.sendErrors++;
+                x++;
+            } else {
+                // the sync packet, if any, is the last message
+                int data = std::max(0, std::min(x + cnt, (int)order.size()) - x);
+                results.packets += data;
+                results.syncPackets += cnt - data;
+                x += cnt;
+            }
+        }
+        results.frames++;
+
+        long long next = start + (f + 1) * frameNanos;
+        long long now = NowNanos();
+        if (now > next) {
+            results.lateFrames++;
+        } else {
+            struct timespec ts;
+            ts.tv_sec = (next - now) / 1000000000LL;
+            ts.tv_nsec = (next - now) % 1000000000LL;
+            nanosleep(&ts, nullptr);
+        }
+    }
+    close(sock);
+    return results;
+}
+
+static Json::Value BuildBridgeConfig() {
+    Json::Value input;
+    input["type"] = "universes";
+    input["enabled"] = 1;
+    input["timeout"] = 1000;
+    input["receiveThreads"] = receiveThreads;
+    input["zeroCopy"] = zeroCopy ? 1 : 0;
+    input["syncLatch"] = syncLatch ? 1 : 0;
+    input["merge"] = mergeMode;
+
+    Json::Value universes(Json::arrayValue);
+    if (protocol != Protocol::DDP) {
+        Json::Value u;
+        u["active"] = 1;
+        u["id"] = firstUniverse;
+        u["universeCount"] = universeCount;
+        u["startChannel"] = 1;
+        u["channelCount"] = channelCount;
+        u["priority"] = 0;
+        if (protocol == Protocol::ARTNET) {
+            u["type"] = 2;
+        } else if (multicast) {
+            u["type"] = 0;
+        } else {
+            u["type"] = 1;
+            u["address"] = "127.0.0.1";
+        }
+        universes.append(u);
+    }
+    input["universes"] = universes;
+
+    Json::Value config;
+    config["channelInputs"].append(input);
+    return config;
+}
+
+static uint64_t ToUInt(const Json::Value& v) {
+    if (v.isString()) {
+        return strtoull(v.asString().c_str(), nullptr, 10);
+    }
+    return v.isNumeric() ? v.asUInt64() : 0;
+}
+
+static double CPUSeconds() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1000000.0 +
+           ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1000000.0;
+}
+
+int main(int argc, char* argv[]) {
+    parseArguments(argc, argv);
+    SetLogFile("stderr", false);
+
+    if (!host.empty()) {
+        GeneratorResults r = RunGenerator(host);
+        printf("Sent %" PRIu64 " packets + %" PRIu64 " sync (%" PRIu64 " bytes) in %" PRIu64 " frames, %" PRIu64 " dropped, %" PRIu64 " reordered, %" PRIu64 " late frames, %" PRIu64 " send errors\n",
+               r.packets, r.syncPackets, r.bytes, r.frames, r.dropped, r.reordered, r.lateFrames, r.sendErrors);
+        return 0;
+    }
+
+    // fork the generator before the bridge starts any threads, it waits
+    // for a byte on startFds before sending and reports back on fds
+    int fds[2];
+    int startFds[2];
+    if (pipe(fds) < 0 || pipe(startFds) < 0) {
+        fprintf(stderr, "Could not create pipe: %s\n", strerror(errno));
+        return 1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "Could not fork the generator: %s\n", strerror(errno));
+        return 1;
+    }
+    if (pid == 0) {
+        // generator, sends to the in process bridge
+        close(fds[0]);
+        close(startFds[1]);
+        char go;
+        if (read(startFds[0], &go, 1) != 1) {
+            _exit(1);
+        }
+        GeneratorResults r = RunGenerator("127.0.0.1");
+        if (write(fds[1], &r, sizeof(r)) != sizeof(r)) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+    close(startFds[0]);
+
+    LoadSettings(argv[0]);
+    Bridge_SetConfig(BuildBridgeConfig());
+    sequence = new Sequence();
+    std::map<int, std::function<bool(int)>> callbacks;
+    Bridge_Initialize(callbacks);
+
+    // Bridge_Initialize starts the real channel output thread, the thread
+    // below stands in for it so the numbers don't depend on the outputs
+    if (StopChannelOutputThread() < 0) {
+        fprintf(stderr, "Could not stop the channel output thread\n");
+        kill(pid, SIGTERM);
+        return 1;
+    }
+    char go = 1;
+    if (write(startFds[1], &go, 1) != 1) {
+        fprintf(stderr, "Could not start the generator: %s\n", strerror(errno));
+        kill(pid, SIGTERM);
+        return 1;
+    }
+    close(startFds[1]);
+
+    double cpuStart = CPUSeconds();
+    long long wallStart = NowNanos();
+
+    // stands in for the channel output thread, merges the bridge data into
+    // a frame at the frame rate
+    volatile bool running = true;
+    std::thread output([&running]() {
+        while (running) {
+            std::this_thread::sleep_for(std::chrono::microseconds(1000000 / frameRate));
+            uint64_t arrival = Bridge_TakeOldestArrival();
+            if (sequence->hasBridgeData()) {
+                sequence->ProcessSequenceData(0, 0);
+            }
+            if (arrival) {
+                Bridge_FrameSent(arrival);
+            }
+        }
+    });
+
+    std::vector<struct pollfd> pfds;
+    for (auto& cb : callbacks) {
+        struct pollfd p;
+        p.fd = cb.first;
+        p.events = POLLIN;
+        pfds.push_back(p);
+    }
+    long long drainUntil = 0;
+    while (true) {
+        if (!drainUntil && waitpid(pid, nullptr, WNOHANG) == pid) {
+            // let the bridge catch up with whatever is still queued
+            drainUntil = NowNanos() + 250000000LL;
+        }
+        if (drainUntil && NowNanos() > drainUntil) {
+            break;
+        }
+        Bridge_CheckSyncLatch();
+        if (poll(pfds.data(), pfds.size(), 10) > 0) {
+            for (auto& p : pfds) {
+                if (p.revents & POLLIN) {
+                    callbacks[p.fd](p.fd);
+                }
+            }
+        }
+    }
+    running = false;
+    output.join();
+
+    double cpu = CPUSeconds() - cpuStart;
+    double wall = (NowNanos() - wallStart) / 1000000000.0;
+    GeneratorResults sent;
+    if (read(fds[0], &sent, sizeof(sent)) != sizeof(sent)) {
+        fprintf(stderr, "Generator did not report its results\n");
+    }
+    close(fds[0]);
+
+    Json::Value stats = GetE131UniverseBytesReceived();
+    uint64_t received = 0;
+    uint64_t bytes = 0;
+    uint64_t errors = 0;
+    uint64_t gaps = 0;
+    uint64_t outOfOrder = 0;
+    for (auto& u : stats["universes"]) {
+        if (u["id"].isNumeric() || u["id"].asString() == "DDP") {
+            received += ToUInt(u["packetsReceived"]);
+            bytes += ToUInt(u["bytesReceived"]);
+            errors += ToUInt(u["errors"]);
+            gaps += ToUInt(u["gaps"]);
+            outOfOrder += ToUInt(u["outOfOrder"]);
+        }
+    }
+    uint64_t lost = sent.packets > received ? sent.packets - received : 0;
+
+    Json::Value result;
+    result["sent"]["packets"] = (Json::UInt64)sent.packets;
+    result["sent"]["syncPackets"] = (Json::UInt64)sent.syncPackets;
+    result["sent"]["bytes"] = (Json::UInt64)sent.bytes;
+    result["sent"]["frames"] = (Json::UInt64)sent.frames;
+    result["sent"]["dropped"] = (Json::UInt64)sent.dropped;
+    result["sent"]["reordered"] = (Json::UInt64)sent.reordered;
+    result["sent"]["lateFrames"] = (Json::UInt64)sent.lateFrames;
+    result["received"]["packets"] = (Json::UInt64)received;
+    result["received"]["bytes"] = (Json::UInt64)bytes;
+    result["received"]["lost"] = (Json::UInt64)lost;
+    result["received"]["sequenceErrors"] = (Json::UInt64)errors;
+    result["received"]["gaps"] = (Json::UInt64)gaps;
+    result["received"]["outOfOrder"] = (Json::UInt64)outOfOrder;
+    result["seconds"] = wall;
+    result["packetsPerSecond"] = received / wall;
+    result["cpuSeconds"] = cpu;
+    result["cpuPerPacketUS"] = received ? cpu * 1000000.0 / received : 0.0;
+    result["bridge"] = stats;
+
+    if (jsonOutput) {
+        printf("%s\n", SaveJsonToString(result, "  ").c_str());
+    } else {
+        printf("Sent:     %" PRIu64 " packets + %" PRIu64 " sync, %" PRIu64 " frames, %" PRIu64 " dropped on purpose, %" PRIu64 " reordered, %" PRIu64 " late frames\n",
+               sent.packets, sent.syncPackets, sent.frames, sent.dropped, sent.reordered, sent.lateFrames);
+        printf("Received: %" PRIu64 " packets (%.0f/s, %.1f Mbit/s), %" PRIu64 " lost\n",
+               received, received / wall, bytes * 8 / wall / 1000000.0, lost);
+        printf("Sequence: %" PRIu64 " errors, %" PRIu64 " gaps, %" PRIu64 " out of order\n",
+               errors, gaps, outOfOrder);
+        printf("CPU:      %.3f s, %.2f us per packet\n", cpu, result["cpuPerPacketUS"].asDouble());
+        if (stats.isMember("timing")) {
+            for (auto& name : stats["timing"].getMemberNames()) {
+                const Json::Value& h = stats["timing"][name];
+                printf("%-14s avg %.0f us, max %" PRIu64 " us (%" PRIu64 " samples)\n",
+                       (name + ":").c_str(), h["avg"].asDouble(), ToUInt(h["max"]), ToUInt(h["count"]));
+            }
+        }
+        if (stats.isMember("receiveThreads")) {
+            for (auto& t : stats["receiveThreads"]) {
+                printf("Thread %d: %" PRIu64 " packets, %" PRIu64 " ignored, %" PRIu64 " kernel drops\n",
+                       t["thread"].asInt(), ToUInt(t["packets"]), ToUInt(t["ignored"]), ToUInt(t["overflow"]));
+            }
+        }
+    }
+
+    Bridge_Shutdown();
+    delete sequence;
+    return 0;
+}
@@ -13,6 +13,7 @@
 #include "fpp-pch.h"
 
 #include "MultiSync.h"
+#include "MultiSyncStream.h"
 #include "Player.h"
 #include "Plugins.h"
 #include "Scheduler.h"
@@ -56,6 +57,7 @@
 #include "sensors/Sensors.h"
 #include "util/GPIOUtils.h"
 #include "Timers.h"
+#include "Trace.h"
 #include <getopt.h>
 
 #include <curl/curl.h>
@@ -605,6 +607,7 @@ int main(int argc, char* argv[]) {
     std::srand(std::time(nullptr));
 
     CommandManager::INSTANCE.Init();
+    TraceManager::INSTANCE.Initialize();
     if (getSetting("MQTTHost") != "") {
         LogInfo(VB_GENERAL, "Creating MQTT\n");
         mqtt = new MosquittoClient(getSetting("MQTTHost").c_str(), getSettingInt("MQTTPort"), getSetting("MQTTPrefix").c_str());
@@ -641,6 +644,7 @@ int main(int argc, char* argv[]) {
     InitMediaOutput();
     PixelOverlayManager::INSTANCE.Initialize();
     InitializeChannelOutputs();
+    MultiSyncStream::INSTANCE.Init();
     PluginManager::INSTANCE.loadUserPlugins();
 
     if (!getSettingInt("restarted")) {
@@ -667,6 +671,7 @@ int main(int argc, char* argv[]) {
     }
 
     CleanupMediaOutput();
+    MultiSyncStream::INSTANCE.Shutdown();
     CloseEffects();
     CloseChannelOutputs();
     CommandManager::INSTANCE.Cleanup();
@@ -839,6 +844,7 @@ void MainLoop(void) {
 #endif
             }
         }
+        pushBridgeData |= Bridge_CheckSyncLatch();
         // Check to see if we need to start up the output thread.
         if ((!ChannelOutputThreadIsRunning()) &&
             ((PixelOverlayManager::INSTANCE.hasActiveOverlays()) ||
@@ -19,6 +19,7 @@
 #include "MultiSync.h"
 #include "Player.h"
 #include "Scheduler.h"
+#include "Trace.h"
 #include "e131bridge.h"
 #include "effects.h"
 #include "fpp.h"
@@ -153,6 +154,24 @@ const std::shared_ptr<httpserver::http_response> PlayerResource::render_GET(cons
             reset = true;
 
         GetMultiSyncStats(result, reset);
+    } else if (url == "frameClockStats") {
+        if (req.get_arg("reset") == "1")
+            ResetFrameClockStats();
+
+        GetFrameClockStats(result);
+        SetOKResult(result, "");
+    } else if (url == "outputStats") {
+        if (req.get_arg("reset") == "1")
+            ResetChannelOutputStats();
+
+        GetChannelOutputStats(result);
+        SetOKResult(result, "");
+    } else if (url == "frameDropStats") {
+        if (req.get_arg("reset") == "1")
+            ResetFrameDropStats();
+
+        GetFrameDropStats(result);
+        SetOKResult(result, "");
     } else if (url == "playlists") {
         GetCurrentPlaylists(result);
     } else if (url == "playlist/filetime") {
@@ -183,6 +202,8 @@ const std::shared_ptr<httpserver::http_response> PlayerResource::render_GET(cons
         SetOKResult(result, "");
     } else if (url == "sequence") {
         LogDebug(VB_HTTP, "API - Getting list of running sequences\n");
+    } else if (url == "trace") {
+        return std::shared_ptr<httpserver::http_response>(new httpserver::string_response(TraceManager::INSTANCE.GetTraceJSON(), 200, "application/json"));
     } else {
         LogErr(VB_HTTP, "API - Error unknown GET request: %s\n", url.c_str());
 
@@ -768,9 +789,13 @@ void PlayerResource::PostOutputsRemap(const Json::Value& data, Json::Value& resu
     }
 
     if (data["command"].asString() == "reload") {
-        // FIXME, need to fix this function to lock the remap array
-        //LoadChannelRemapData();
-        SetOKResult(result, "channel remaps reloaded");
+        if (ReloadOutputProcessors()) {
+            result["restartRequired"] = false;
+            SetOKResult(result, "channel remaps reloaded");
+        } else {
+            result["restartRequired"] = true;
+            SetOKResult(result, "channel remaps reloaded, restart required for new channel ranges");
+        }
     }
 }
 
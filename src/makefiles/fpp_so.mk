@@ -1,6 +1,7 @@
 
 
 OBJECTS_fpp_so += \
+	channeloutput/ChannelChangeMap.o \
 	channeloutput/ChannelOutput.o \
 	channeloutput/ThreadedChannelOutput.o \
 	channeloutput/ChannelOutputSetup.o \
@@ -13,6 +14,8 @@ OBJECTS_fpp_so += \
 	channeloutput/serialutil.o \
 	channeloutput/VirtualDisplayBase.o \
     channeloutput/processors/OutputProcessor.o \
+    channeloutput/processors/OutputProcessorKernels.o \
+    channeloutput/processors/OutputProcessorPlan.o \
     channeloutput/processors/RemapOutputProcessor.o \
     channeloutput/processors/HoldValueOutputProcessor.o \
     channeloutput/processors/SetValueOutputProcessor.o \
@@ -44,6 +47,7 @@ OBJECTS_fpp_so += \
 	log.o \
 	FPPLocale.o \
 	MultiSync.o \
+	MultiSyncStream.o \
 	mediadetails.o \
 	mediaoutput/MediaOutputBase.o \
 	mediaoutput/mediaoutput.o \
@@ -91,6 +95,7 @@ OBJECTS_fpp_so += \
 	settings.o \
 	SunRise.o \
 	Timers.o \
+	Trace.o \
 	Warnings.o \
     util/GPIOUtils.o \
     util/I2CUtils.o \
@@ -0,0 +1,14 @@
+OBJECTS_fppbridgebench = fppbridgebench.o
+LIBS_fppbridgebench = $(NULL)
+
+LDFLAGS_fppbridgebench += -rdynamic $(shell curl-config --libs) \
+	$(shell GraphicsMagick++-config --ldflags --libs) \
+	$(shell GraphicsMagickWand-config --ldflags --libs) \
+	$(LIBS_GPIO_EXE_ADDITIONS) \
+	$(NULL)
+
+TARGETS += fppbridgebench
+OBJECTS_ALL+=$(OBJECTS_fppbridgebench)
+
+fppbridgebench: $(OBJECTS_fppbridgebench) libfpp.$(SHLIB_EXT) $(DEPENDENCIES_GPIO_ADDITIONS)
+	$(CCACHE) $(CC) $(CFLAGS_$@) $(OBJECTS_$@) $(LIBS_$@) $(LDFLAGS) $(LDFLAGS_$@) -L . -l fpp $(LIBS_fpp_so) -o $@
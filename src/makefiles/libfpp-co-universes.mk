@@ -1,5 +1,5 @@
 
-OBJECTS_fpp_co_UDPOutput_so += channeloutput/UDPOutput.o  channeloutput/DDP.o channeloutput/E131.o channeloutput/ArtNet.o channeloutput/KiNet.o channeloutput/Twinkly.o
+OBJECTS_fpp_co_UDPOutput_so += channeloutput/UDPOutput.o  channeloutput/DDP.o channeloutput/E131.o channeloutput/ArtNet.o channeloutput/KiNet.o channeloutput/Twinkly.o channeloutput/UDPPacketRing.o
 LIBS_fpp_co_UDPOutput_so += -L. -lfpp -ljsoncpp -lcurl
 
 TARGETS += libfpp-co-UDPOutput.$(SHLIB_EXT)
@@ -29,6 +29,7 @@ extern "C" {
 
 #include "MultiSync.h"
 #include "SDLOut.h"
+#include "Trace.h"
 #include "channeloutput/channeloutputthread.h"
 #include "overlays/PixelOverlay.h"
 #include "overlays/PixelOverlayModel.h"
@@ -251,6 +252,7 @@ public:
         }
         if (AudioHasStalled)
             LogWarn(VB_MEDIAOUT, "Stalled audio, buffers still filling.\n");
+        FPP_TRACE_SPAN("SDL::maybeFillBuffer");
         int orig = outBufferPos;
         bool vidPacket = false;
         while (av_read_frame(formatContext, &readingPacket) == 0) {
@@ -538,6 +540,7 @@ bool SDL::initSDL() {
 }
 
 void SDL::runDecode() {
+    TraceManager::INSTANCE.SetThreadName("SDLDecode");
     while (_state != SDLSTATE::SDLUNINITIALISED) {
         decoding = true;
         SDLInternalData* data = this->data;
@@ -810,6 +813,7 @@ bool SDLOutput::IsOverlayingVideo() {
     return data && data->video_stream_idx != -1 && !data->stopped;
 }
 bool SDLOutput::ProcessVideoOverlay(unsigned int msTimestamp) {
+    FPP_TRACE_SPAN_ARG("SDLOutput::ProcessVideoOverlay", msTimestamp);
     SDLInternalData* data = sdlManager.data;
     if (data && !data->stopped && data->video_stream_idx != -1 && data->curVideoFrame && data->videoOverlayModel) {
         while (data->curVideoFrame->next && data->curVideoFrame->next->timestamp <= msTimestamp) {
@@ -14,6 +14,7 @@
 #include "fppd.h"
 
 #include "Player.h"
+#include "channeloutput/ChannelOutputSetup.h"
 #include "effects.h"
 #include <cassert>
 
@@ -607,6 +608,13 @@ void MosquittoClient::PublishStatus() {
     std::stringstream buffer;
     buffer << json << std::endl;
     Publish("playlist_details", buffer.str());
+
+    // per output send counters (UDP destinations, etc...)
+    Json::Value stats;
+    GetChannelOutputStats(stats);
+    if (stats["outputs"].size()) {
+        Publish("output_stats", SaveJsonToString(stats));
+    }
 }
 
 void MosquittoClient::CacheSetMessage(std::string& topic, std::string& message) {
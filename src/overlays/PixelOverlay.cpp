@@ -19,6 +19,7 @@
 
 #include <magick/type.h>
 
+#include "Trace.h"
 #include "effects.h"
 #include "channeloutput/channeloutputthread.h"
 
@@ -271,6 +272,7 @@ void PixelOverlayManager::doOverlays(uint8_t* channels) {
     if (numActive == 0) {
         return;
     }
+    FPP_TRACE_SPAN_ARG("PixelOverlayManager::doOverlays", numActive);
     std::unique_lock<std::mutex> lock(activeModelsLock);
     // First, flush any buffers
     for (auto m : activeModels) {
@@ -941,6 +943,7 @@ void PixelOverlayManager::addAutoOverlayModel(const std::string& name,
 }
 
 void PixelOverlayManager::doOverlayModelEffects() {
+    TraceManager::INSTANCE.SetThreadName("OverlayEffects");
     std::unique_lock<std::mutex> l(threadLock);
     while (threadKeepRunning) {
         uint32_t waitTime = 1000;
@@ -953,6 +956,7 @@ void PixelOverlayManager::doOverlayModelEffects() {
                 l.unlock();
 
                 for (auto m : models) {
+                    FPP_TRACE_SPAN("PixelOverlayModel::updateRunningEffects");
                     int32_t ms = m->updateRunningEffects();
                     if (ms != 0) {
                         l.lock();
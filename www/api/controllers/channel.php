@@ -186,7 +186,20 @@ function channel_save_output_processors()
 
     file_put_contents($settings['outputProcessorsFile'], $data);
 
-    return channel_get_output_processors();
+    // Ask fppd to swap in the new processors without a restart
+    $ch = curl_init('http://127.0.0.1:32322/fppd/outputs/remap');
+    curl_setopt($ch, CURLOPT_RETURNTRANSFER, true);
+    curl_setopt($ch, CURLOPT_HTTPHEADER, array('Content-Type:application/json'));
+    curl_setopt($ch, CURLOPT_POSTFIELDS, json_encode(array("command" => "reload")));
+    curl_setopt($ch, CURLOPT_CONNECTTIMEOUT_MS, 400);
+    curl_setopt($ch, CURLOPT_TIMEOUT_MS, 3000);
+    $reload = json_decode(curl_exec($ch), true);
+    curl_close($ch);
+
+    $rc = json_decode(channel_get_output_processors(), true);
+    $rc["reloaded"] = is_array($reload) && isset($reload["status"]) && $reload["status"] == "OK" && !$reload["restartRequired"];
+
+    return json($rc);
 }
 
 function channel_get_output()
@@ -242,6 +242,35 @@ $(document).ready(function(){
                                 <div ><input id="bridgeTimeoutMS" type="number" min="0" max="9999" size="4" maxlength="4">
                                         <img id="timeout_img" title="Blank Timeout" src="images/redesign/help-icon.svg" width=22 height=22>
                                         <span id="timeout_tip" class="tooltip" style="display: none">Timeout for input channel data (in MS).  If no new data is received for this time, the input data is cleared.</span></div>
+                            </div>
+                            <div class="col-md-auto form-inline">
+                                <div><b>Sync Latch:</b></div>
+                                <div ><input id="bridgeSyncLatch" type="checkbox">
+                                    <input id="bridgeSyncTimeoutMS" type="number" min="1" max="1000" size="4" maxlength="4">
+                                        <img id="synclatch_img" title="Sync Latch" src="images/redesign/help-icon.svg" width=22 height=22>
+                                        <span id="synclatch_tip" class="tooltip" style="display: none">Hold received data until the sender's sync packet (E1.31 Sync, ArtSync or DDP Push) and output it immediately when it arrives.  Data waiting longer than the given time (in MS) is output without the sync.</span></div>
+                            </div>
+                            <div class="col-md-auto form-inline" <? if ($uiLevel < 1) { ?> style="display:none;" <? } ?>>
+                                <div><i class="fas fa-fw fa-graduation-cap ui-level-1"></i><b> sACN Merge:</b></div>
+                                <div ><select id="bridgeMergeMode">
+                                        <option value="">None (Last Received)</option>
+                                        <option value="htp">Priority + HTP</option>
+                                        <option value="ltp">Priority + LTP</option>
+                                    </select>
+                                        <img id="mergemode_img" title="sACN Merge" src="images/redesign/help-icon.svg" width=22 height=22>
+                                        <span id="mergemode_tip" class="tooltip" style="display: none">How multiple E1.31 sources sending the same universe are combined.  The highest priority source wins, sources with the same priority are merged using Highest Takes Precedence or Latest Takes Precedence.</span></div>
+                            </div>
+                            <div class="col-md-auto form-inline" <? if ($uiLevel < 2) { ?> style="display:none;" <? } ?>>
+                                <div><i class="fas fa-fw fa-flask ui-level-2"></i><b> Receive Threads:</b></div>
+                                <div ><input id="bridgeReceiveThreads" type="number" min="0" max="16" size="2" maxlength="2">
+                                        <img id="receivethreads_img" title="Receive Threads" src="images/redesign/help-icon.svg" width=22 height=22>
+                                        <span id="receivethreads_tip" class="tooltip" style="display: none">Number of dedicated threads receiving E1.31/ArtNet/DDP data, 0 to receive on the main thread.  Useful for very large universe counts.  Requires an FPPD restart.</span></div>
+                            </div>
+                            <div class="col-md-auto form-inline" <? if ($uiLevel < 2) { ?> style="display:none;" <? } ?>>
+                                <div><i class="fas fa-fw fa-flask ui-level-2"></i><b> Zero Copy:</b></div>
+                                <div ><input id="bridgeZeroCopy" type="checkbox">
+                                        <img id="zerocopy_img" title="Zero Copy" src="images/redesign/help-icon.svg" width=22 height=22>
+                                        <span id="zerocopy_tip" class="tooltip" style="display: none">Receive E1.31 data directly into per universe buffers that are read by the output instead of copying each packet.  Requires an FPPD restart.</span></div>
                             </div>
 							<div class="col-md-auto form-inline">
 								<div><b>Inputs Count: </b></div>
@@ -162,6 +162,34 @@ function PopulateInterfaces()
 										<input id="E131ThreadedOutput" type="checkbox" checked />
 									</div>
 								</div>
+								<div class="col-md-auto form-inline" <? if ($uiLevel < 2) { ?> style="display:none;" <? } ?>>
+									<div><i class="fas fa-fw fa-flask ui-level-2"></i><b> UDP GSO:</b></div>
+									<div>
+										<input id="E131GSOOutput" type="checkbox" />
+									</div>
+								</div>
+								<div class="col-md-auto form-inline" <? if ($uiLevel < 2) { ?> style="display:none;" <? } ?>>
+									<div><i class="fas fa-fw fa-flask ui-level-2"></i><b> Transmit:</b></div>
+									<div>
+										<select id="E131TxBackend">
+											<option value="">Sockets</option>
+											<option value="packet_mmap">PACKET_MMAP Ring</option>
+										</select>
+									</div>
+								</div>
+								<div class="col-md-auto form-inline" <? if ($uiLevel < 1) { ?> style="display:none;" <? } ?>>
+									<div><i class="fas fa-fw fa-graduation-cap ui-level-1"></i><b> E1.31 Sync Universe:</b></div>
+									<div>
+										<input id="E131SyncUniverse" type="number" min="0" max="63999" value="0" style="width: 6em;" />
+										<input id="E131SyncAddresses" type="text" size="20" placeholder="Multicast" title="Comma separated list of IPs to send E1.31 Sync to, multicast if empty" />
+									</div>
+								</div>
+								<div class="col-md-auto form-inline" <? if ($uiLevel < 1) { ?> style="display:none;" <? } ?>>
+									<div><i class="fas fa-fw fa-graduation-cap ui-level-1"></i><b> ArtSync Targets:</b></div>
+									<div>
+										<input id="ArtSyncTargets" type="text" size="20" placeholder="255.255.255.255" title="Comma separated list of IPs and/or interface names (sent to the interface broadcast address)" />
+									</div>
+								</div>
 								<div class="col-md-auto form-inline">
 									<div><b>Outputs Count: </b></div>
 									<div ><input id="txtUniverseCount" class="default-value" type="text" value="Enter Universe Count" size="3" maxlength="3" /></div>
@@ -2653,6 +2653,21 @@ function populateUniverseData(data, reload, input) {
         if (channelData.hasOwnProperty("threaded")) {
             $("#E131ThreadedOutput").prop("checked", channelData.threaded);
         }
+        if (channelData.hasOwnProperty("gso")) {
+            $("#E131GSOOutput").prop("checked", channelData.gso);
+        }
+        if (channelData.hasOwnProperty("txBackend")) {
+            $("#E131TxBackend").val(channelData.txBackend);
+        }
+        if (channelData.hasOwnProperty("e131SyncUniverse")) {
+            $("#E131SyncUniverse").val(channelData.e131SyncUniverse);
+        }
+        if (channelData.hasOwnProperty("e131SyncAddresses")) {
+            $("#E131SyncAddresses").val(channelData.e131SyncAddresses);
+        }
+        if (channelData.hasOwnProperty("artSyncTargets")) {
+            $("#ArtSyncTargets").val(channelData.artSyncTargets);
+        }
     }
     UniverseCount = channelData.universes.length;
     for (var i = 0; i < channelData.universes.length; i++) {
@@ -2779,6 +2794,15 @@ function populateUniverseData(data, reload, input) {
         } else {
             $('#bridgeTimeoutMS').val(1000);
         }
+        $('#bridgeSyncLatch').prop('checked', channelData.syncLatch == 1);
+        if (channelData.syncTimeout != null) {
+            $('#bridgeSyncTimeoutMS').val(channelData.syncTimeout);
+        } else {
+            $('#bridgeSyncTimeoutMS').val(50);
+        }
+        $('#bridgeReceiveThreads').val(channelData.receiveThreads != null ? channelData.receiveThreads : 0);
+        $('#bridgeZeroCopy').prop('checked', channelData.zeroCopy == 1);
+        $('#bridgeMergeMode').val(channelData.merge != null ? channelData.merge : "");
     }
     $('#tblUniversesBody').html(bodyHTML);
 
@@ -2983,9 +3007,19 @@ function postUniverseJSON(input) {
         // output only properties
         output.interface = document.getElementById("selE131interfaces").value;
         output.threaded = document.getElementById("E131ThreadedOutput").checked ? 1 : 0;
+        output.gso = document.getElementById("E131GSOOutput").checked ? 1 : 0;
+        output.txBackend = document.getElementById("E131TxBackend").value;
+        output.e131SyncUniverse = parseInt(document.getElementById("E131SyncUniverse").value) || 0;
+        output.e131SyncAddresses = document.getElementById("E131SyncAddresses").value.trim();
+        output.artSyncTargets = document.getElementById("ArtSyncTargets").value.trim();
     } else {
         // input only properties
         output.timeout = parseInt(document.getElementById("bridgeTimeoutMS").value);
+        output.syncLatch = document.getElementById("bridgeSyncLatch").checked ? 1 : 0;
+        output.syncTimeout = parseInt(document.getElementById("bridgeSyncTimeoutMS").value);
+        output.receiveThreads = parseInt(document.getElementById("bridgeReceiveThreads").value) || 0;
+        output.zeroCopy = document.getElementById("bridgeZeroCopy").checked ? 1 : 0;
+        output.merge = document.getElementById("bridgeMergeMode").value;
     }
     output.startChannel = 1;
     output.channelCount = -1;
@@ -1932,6 +1932,8 @@ PrintSetting('MultiSyncEnabled');
 PrintSetting('MultiSyncExternalIPAddress');
 PrintSetting('MultiSyncMulticast', 'syncModeUpdated');
 PrintSetting('MultiSyncBroadcast', 'syncModeUpdated');
+PrintSetting('MultiSyncStreamFrames');
+PrintSetting('MultiSyncStreamFEC');
 PrintSetting('MultiSyncExtraRemotes');
 PrintSetting('MultiSyncHTTPSubnets');
 PrintSetting('MultiSyncHide10', 'getFPPSystems');
@@ -277,7 +277,9 @@ function SetOutputProcessors() {
         ).done(function(data) {
 		    $.jGrowl("Output Processors Table saved",{themeState:'success'});
 		    PopulateOutputProcessorTable(data);
-		    SetRestartFlag(2);
+		    if (!data.reloaded) {
+		        SetRestartFlag(2);
+		    }
 	    }).fail(function() {
 		    DialogError("Save Output Processors Table", "Save Failed");
 	    });